@@ -0,0 +1,78 @@
+// Replacement global allocation functions counting every heap allocation in
+// allocationcount and allocationbytes (see stats.hpp).
+// Only linked into the programs that report allocations, never into a library.
+
+#include <cstdlib>
+#include <new>
+
+#include "stats.hpp"
+
+extern bool allocationhooks;
+
+namespace
+{
+struct AllocationHooks
+{
+  AllocationHooks()
+  {
+    allocationhooks = true;
+  }
+} hooks;
+
+void *allocate(std::size_t size)
+{
+  allocationcount.fetch_add(1, std::memory_order_relaxed);
+  allocationbytes.fetch_add(size, std::memory_order_relaxed);
+
+  void *p = std::malloc(size ? size : 1);
+  if (p == nullptr)
+  {
+    throw std::bad_alloc();
+  }
+  return p;
+}
+} // namespace
+
+void *operator new(std::size_t size)
+{
+  return allocate(size);
+}
+
+void *operator new[](std::size_t size)
+{
+  return allocate(size);
+}
+
+void *operator new(std::size_t size, const std::nothrow_t &) noexcept
+{
+  try
+  {
+    return allocate(size);
+  }
+  catch (const std::bad_alloc &)
+  {
+    return nullptr;
+  }
+}
+
+void *operator new[](std::size_t size, const std::nothrow_t &) noexcept
+{
+  try
+  {
+    return allocate(size);
+  }
+  catch (const std::bad_alloc &)
+  {
+    return nullptr;
+  }
+}
+
+void operator delete(void *p) noexcept
+{
+  std::free(p);
+}
+
+void operator delete[](void *p) noexcept
+{
+  std::free(p);
+}
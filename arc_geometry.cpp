@@ -0,0 +1,136 @@
+#include "arc_geometry.hpp"
+
+// system includes
+#include <algorithm>
+#include <cmath>
+#include <functional>
+
+// module includes
+#include "simd_kernels.hpp"
+
+// most segments used for any arc
+#define ARC_MAX_SEGMENTS 256
+// zoom buckets per doubling of the scale
+#define ZOOM_BUCKETS_PER_OCTAVE 4
+
+ArcGeometry arcgeometry(const Arc &a)
+{
+  ArcGeometry g;
+  g.center = a.center;
+  g.radius = std::hypot(a.start.x - a.center.x, a.start.y - a.center.y);
+  g.start = std::atan2(a.start.y - a.center.y, a.start.x - a.center.x);
+  g.span = a.span;
+  return g;
+}
+
+Point arcpoint(const ArcGeometry &g, double t)
+{
+  double angle = g.start - g.span * t;
+  return Point{g.center.x + g.radius * std::cos(angle), g.center.y + g.radius * std::sin(angle)};
+}
+
+int arcsegments(double radius, double span, double tolerance)
+{
+  if (!(radius > tolerance)) // tiny (or invalid) arcs are a single chord
+  {
+    return 1;
+  }
+
+  // a chord spanning angle t is at most r (1 - cos(t / 2)) away from the arc
+  double step = 2 * std::acos(1 - tolerance / radius);
+  double segments = std::ceil(std::fabs(span) / step);
+
+  if (!(segments < ARC_MAX_SEGMENTS)) // also catches an infinite or NaN span
+  {
+    return ARC_MAX_SEGMENTS;
+  }
+  return std::max(1, static_cast<int>(segments));
+}
+
+// the points of the arc at t = i / segments for i = 0 ... segments, with their
+// sines and cosines computed in a batch (see simd_kernels.hpp)
+static void arcpoints(const ArcGeometry &g, int segments, std::vector<Point> &polyline)
+{
+  std::vector<double> angles(segments + 1), sines(segments + 1), cosines(segments + 1);
+  for (int i = 0; i <= segments; i++)
+  {
+    angles[i] = g.start - g.span * (static_cast<double>(i) / segments);
+  }
+  batchsincos(angles.data(), sines.data(), cosines.data(), angles.size());
+
+  polyline.resize(segments + 1);
+  for (int i = 0; i <= segments; i++)
+  {
+    polyline[i] = Point{g.center.x + g.radius * cosines[i], g.center.y + g.radius * sines[i]};
+  }
+}
+
+std::vector<Point> flattenarc(const Arc &a, double tolerance)
+{
+  ArcGeometry g = arcgeometry(a);
+  int segments = arcsegments(g.radius, g.span, tolerance);
+
+  std::vector<Point> polyline;
+  arcpoints(g, segments, polyline);
+
+  // the start is exact, the end point is only known through its sine and cosine
+  polyline.front() = a.start;
+  return polyline;
+}
+
+bool ArcTessellationCache::Key::operator==(const Key &k) const
+{
+  return radius == k.radius && start == k.start && span == k.span && zoom == k.zoom;
+}
+
+std::size_t ArcTessellationCache::KeyHash::operator()(const Key &k) const
+{
+  std::hash<double> h;
+  std::size_t seed = h(k.radius);
+  seed ^= h(k.start) + 0x9e3779b9 + (seed << 6) + (seed >> 2);
+  seed ^= h(k.span) + 0x9e3779b9 + (seed << 6) + (seed >> 2);
+  seed ^= std::hash<int>()(k.zoom) + 0x9e3779b9 + (seed << 6) + (seed >> 2);
+  return seed;
+}
+
+ArcTessellationCache::ArcTessellationCache(std::size_t capacity) : capacity(std::max<std::size_t>(1, capacity))
+{
+}
+
+void ArcTessellationCache::clear()
+{
+  entries.clear();
+}
+
+const std::vector<Point> &ArcTessellationCache::tessellate(const Arc &a, double scale, double tolerance)
+{
+  ArcGeometry g = arcgeometry(a);
+
+  // Scales are grouped in buckets of a quarter octave, every scale of a bucket
+  // shares the polyline computed for the largest scale of the bucket
+  int zoom = static_cast<int>(std::floor(std::log2(scale) * ZOOM_BUCKETS_PER_OCTAVE));
+  Key key = {g.radius, g.start, g.span, zoom};
+
+  std::unordered_map<Key, std::vector<Point>, KeyHash>::iterator it = entries.find(key);
+  if (it != entries.end())
+  {
+    hitcount++;
+    return it->second;
+  }
+  misscount++;
+
+  if (entries.size() >= capacity)
+  {
+    entries.clear();
+  }
+
+  double bucketscale = std::exp2(static_cast<double>(zoom + 1) / ZOOM_BUCKETS_PER_OCTAVE);
+  int segments = arcsegments(g.radius * bucketscale, g.span, tolerance);
+
+  ArcGeometry relative = g;
+  relative.center = Point{0, 0};
+
+  std::vector<Point> &polyline = entries[key];
+  arcpoints(relative, segments, polyline);
+  return polyline;
+}
@@ -0,0 +1,89 @@
+#ifndef ARC_GEOMETRY_HPP
+#define ARC_GEOMETRY_HPP
+
+// system includes
+#include <cstddef>
+#include <unordered_map>
+#include <vector>
+
+// module includes
+#include "expression.hpp"
+
+// An Arc in polar form. Angles are in radians, measured in the drawing's
+// y-down coordinates; a positive span runs counter-clockwise on screen
+// (the QPainter::drawArc convention used by sldraw), i.e. towards smaller angles.
+struct ArcGeometry
+{
+  Point center;
+  Number radius;
+  Number start;
+  Number span;
+};
+
+// computes the polar form of an arc
+ArcGeometry arcgeometry(const Arc &a);
+
+// point of the arc at angle (start - t * span) for t in [0, 1]
+Point arcpoint(const ArcGeometry &g, double t);
+
+// number of segments whose chords stay within tolerance of an arc of the given radius and span
+int arcsegments(double radius, double span, double tolerance);
+
+// polyline approximating the arc with chords within tolerance of it (in drawing units),
+// the first point is exactly the start point of the arc and the last one its end
+// point computed from the end angle, within rounding
+std::vector<Point> flattenarc(const Arc &a, double tolerance);
+
+// Cache of flattened arcs. Entries are keyed by radius, start angle, span and
+// a zoom bucket, and hold polylines relative to the arc center, so identical
+// arcs drawn at different places (wheels, fillets, ...) share one entry.
+class ArcTessellationCache
+{
+public:
+  // holds at most capacity polylines, all of them are dropped when it is full
+  ArcTessellationCache(std::size_t capacity = 4096);
+
+  // Polyline relative to the arc center, within tolerance device units of the arc
+  // when drawn at scale device units per drawing unit. The reference stays valid
+  // until the next call.
+  const std::vector<Point> &tessellate(const Arc &a, double scale, double tolerance);
+
+  void clear();
+
+  std::size_t size() const
+  {
+    return entries.size();
+  }
+
+  std::size_t hits() const
+  {
+    return hitcount;
+  }
+
+  std::size_t misses() const
+  {
+    return misscount;
+  }
+
+private:
+  struct Key
+  {
+    Number radius;
+    Number start;
+    Number span;
+    int zoom;
+    bool operator==(const Key &k) const;
+  };
+
+  struct KeyHash
+  {
+    std::size_t operator()(const Key &k) const;
+  };
+
+  std::unordered_map<Key, std::vector<Point>, KeyHash> entries;
+  std::size_t capacity;
+  std::size_t hitcount = 0;
+  std::size_t misscount = 0;
+};
+
+#endif
@@ -0,0 +1,79 @@
+#include "canvas_view.hpp"
+
+#include <cmath>
+
+#include <QElapsedTimer>
+#include <QKeyEvent>
+#include <QPaintEvent>
+#include <QWheelEvent>
+
+// zoom factor for one step (1/8 of a degree) of the mouse wheel
+#define ZOOM_PER_STEP 1.0015
+
+CanvasView::CanvasView(QGraphicsScene *scene, QWidget *parent) : QGraphicsView(scene, parent), overlay(false), frametime(0)
+{
+  // Items are painted straight through the scene index, so only the exposed ones are visited,
+  // and they restore any painter state they change themselves
+  setOptimizationFlags(QGraphicsView::DontSavePainterState | QGraphicsView::DontAdjustForAntialiasing);
+  setViewportUpdateMode(QGraphicsView::SmartViewportUpdate);
+
+  setTransformationAnchor(QGraphicsView::AnchorUnderMouse);
+  setDragMode(QGraphicsView::ScrollHandDrag);
+}
+
+void CanvasView::setFrameTimeOverlay(bool enabled)
+{
+  overlay = enabled;
+  viewport()->update();
+}
+
+LodCoverage *CanvasView::coverage(QWidget *viewport)
+{
+  CanvasView *view = viewport ? qobject_cast<CanvasView *>(viewport->parentWidget()) : nullptr;
+  return view ? &view->framecoverage : nullptr;
+}
+
+void CanvasView::paintEvent(QPaintEvent *event)
+{
+  QElapsedTimer timer;
+  timer.start();
+
+  framecoverage.reset(viewport()->size());
+  QGraphicsView::paintEvent(event);
+
+  frametime = timer.nsecsElapsed() / 1e6;
+}
+
+void CanvasView::drawForeground(QPainter *painter, const QRectF &rect)
+{
+  QGraphicsView::drawForeground(painter, rect);
+
+  if (!overlay)
+  {
+    return;
+  }
+
+  // the overlay shows the previous frame, in viewport coordinates
+  painter->save();
+  painter->resetTransform();
+  painter->setPen(Qt::darkGray);
+  painter->drawText(8, 16, QString("frame %1 ms").arg(frametime, 0, 'f', 2));
+  painter->restore();
+}
+
+void CanvasView::wheelEvent(QWheelEvent *event)
+{
+  double factor = std::pow(ZOOM_PER_STEP, event->angleDelta().y());
+  scale(factor, factor);
+  event->accept();
+}
+
+void CanvasView::keyPressEvent(QKeyEvent *event)
+{
+  if (event->key() == Qt::Key_F)
+  {
+    setFrameTimeOverlay(!overlay);
+    return;
+  }
+  QGraphicsView::keyPressEvent(event);
+}
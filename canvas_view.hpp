@@ -0,0 +1,38 @@
+#ifndef CANVAS_VIEW_HPP
+#define CANVAS_VIEW_HPP
+
+#include <QGraphicsView>
+
+#include "lod_painter.hpp"
+
+class QGraphicsScene;
+
+// The view of the canvas scene: zooms with the mouse wheel, pans by dragging,
+// keeps the per-frame pixel coverage used by level-of-detail painting and
+// can overlay the time taken by the last frame (toggled with the F key)
+class CanvasView : public QGraphicsView
+{
+  Q_OBJECT
+
+public:
+  CanvasView(QGraphicsScene *scene, QWidget *parent = nullptr);
+
+  void setFrameTimeOverlay(bool enabled);
+
+  // the coverage of the frame being painted on viewport, if it belongs to a CanvasView
+  static LodCoverage *coverage(QWidget *viewport);
+
+protected:
+  void paintEvent(QPaintEvent *event);
+  void drawForeground(QPainter *painter, const QRectF &rect);
+  void wheelEvent(QWheelEvent *event);
+  void keyPressEvent(QKeyEvent *event);
+
+private:
+  LodCoverage framecoverage;
+
+  bool overlay;
+  double frametime; // milliseconds taken by the last frame
+};
+
+#endif
@@ -6,12 +6,18 @@
 #include <QGraphicsView>
 #include <QLayout>
 
+#include "canvas_view.hpp"
+#include "display_list.hpp"
+#include "qgraphics_display_list_item.hpp"
+
 CanvasWidget::CanvasWidget(QWidget *parent) : QWidget(parent)
 {
   // TODO: your code here...
   scene = new QGraphicsScene(this);
 
-  QGraphicsView *view = new QGraphicsView(scene);
+  // the scene is shown through a level-of-detail aware view
+  scene->setItemIndexMethod(QGraphicsScene::BspTreeIndex);
+  CanvasView *view = new CanvasView(scene);
 
   QWidget *window = new QWidget;
 
@@ -28,3 +34,19 @@ void CanvasWidget::addGraphic(QGraphicsItem *item)
   // item->paint(painter, this, view);
   scene->addItem(item);
 }
+
+bool CanvasWidget::loadDisplayList(const std::string &filename)
+{
+  // The file stays mapped, the whole list is a single item that paints
+  // the visible primitives straight from the mapped arrays
+  std::unique_ptr<DisplayList> displaylist(new DisplayList);
+
+  if (!displaylist->open(filename))
+  {
+    return false;
+  }
+
+  scene->addItem(new QGraphicsDisplayListItem(std::move(displaylist)));
+
+  return true;
+}
@@ -1,6 +1,8 @@
 #ifndef CANVAS_WIDGET_HPP
 #define CANVAS_WIDGET_HPP
 
+#include <string>
+
 #include <QWidget>
 
 class QGraphicsItem;
@@ -13,6 +15,10 @@ class CanvasWidget : public QWidget
 public:
   CanvasWidget(QWidget *parent = nullptr);
 
+  // adds every primitive of a display-list file (see display_list.hpp) to the scene,
+  // returns false if the file is not a valid display list
+  bool loadDisplayList(const std::string &filename);
+
 public slots:
 
   void addGraphic(QGraphicsItem *item);
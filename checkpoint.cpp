@@ -0,0 +1,341 @@
+#include "checkpoint.hpp"
+
+// system includes
+#include <cmath>
+#include <cstring>
+#include <fstream>
+#include <vector>
+
+// module includes
+#include "mapped_file.hpp"
+
+// Deeper expressions are neither written nor read. The reader and the writer
+// recurse once per level, and defines hold evaluated values, which are rarely
+// nested more than a level or two.
+#define CHECKPOINT_MAX_DEPTH 64
+
+namespace
+{
+const char MAGIC[4] = {'S', 'L', 'C', 'K'};
+
+std::uint64_t align8(std::uint64_t offset)
+{
+  return (offset + 7) & ~std::uint64_t(7);
+}
+
+// Flattens expressions into records and a string pool
+class CheckpointBuilder
+{
+public:
+  void binding(const Symbol &name, const Expression &exp)
+  {
+    std::size_t first = records.size();
+    add(exp, 0);
+    if (failed)
+    {
+      return;
+    }
+    records[first].nameoffset = strings.size();
+    records[first].namelength = name.size();
+    strings += name;
+    bindings++;
+  }
+
+  std::vector<CheckpointRecord> records;
+  std::string strings;
+  std::uint64_t bindings = 0;
+
+  // set when an expression is nested deeper than CHECKPOINT_MAX_DEPTH
+  bool failed = false;
+
+private:
+  void append(const std::vector<Number> &values)
+  {
+    strings.append(reinterpret_cast<const char *>(values.data()), values.size() * sizeof(Number));
+  }
+
+  void add(const Expression &exp, unsigned depth)
+  {
+    if (depth > CHECKPOINT_MAX_DEPTH)
+    {
+      failed = true;
+      return;
+    }
+
+    CheckpointRecord record;
+    std::memset(&record, 0, sizeof(record));
+    record.type = exp.head.type;
+    record.tailcount = static_cast<std::uint32_t>(exp.tail.size());
+
+    const Value &value = exp.head.value;
+    switch (exp.head.type)
+    {
+    case BooleanType:
+      record.values[0] = value.bool_value ? 1 : 0;
+      break;
+    case NumberType:
+      record.values[0] = value.num_value;
+      break;
+    case PointType:
+      record.values[0] = value.point_value.x;
+      record.values[1] = value.point_value.y;
+      break;
+    case LineType:
+      record.values[0] = value.line_value.first.x;
+      record.values[1] = value.line_value.first.y;
+      record.values[2] = value.line_value.second.x;
+      record.values[3] = value.line_value.second.y;
+      break;
+    case ArcType:
+      record.values[0] = value.arc_value.center.x;
+      record.values[1] = value.arc_value.center.y;
+      record.values[2] = value.arc_value.start.x;
+      record.values[3] = value.arc_value.start.y;
+      record.values[4] = value.arc_value.span;
+      break;
+    case NumberArrayType:
+    case PointArrayType:
+      record.values[0] = value.array_value.size();
+      record.values[1] = value.array_value.path;
+      break;
+    default:
+      break;
+    }
+
+    record.symoffset = strings.size();
+    if (exp.head.type == NumberArrayType || exp.head.type == PointArrayType)
+    {
+      // the elements take the place of the symbol in the string pool
+      std::size_t before = strings.size();
+      if (value.array_value.data)
+      {
+        append(value.array_value.data->x);
+        append(value.array_value.data->y);
+      }
+      record.symlength = strings.size() - before;
+    }
+    else
+    {
+      record.symlength = value.sym_value.size();
+      strings += value.sym_value;
+    }
+
+    records.push_back(record);
+    for (const Expression &e : exp.tail)
+    {
+      add(e, depth + 1);
+    }
+  }
+};
+
+// Rebuilds expressions from the records of a mapped checkpoint
+class CheckpointReader
+{
+public:
+  CheckpointReader(const CheckpointRecord *records, std::uint64_t count, const char *strings, std::uint64_t stringsize)
+      : records(records), count(count), strings(strings), stringsize(stringsize), next(0)
+  {
+  }
+
+  // reads the next binding, returns false if the records are malformed
+  bool binding(Symbol &name, Expression &exp)
+  {
+    if (next >= count || records[next].namelength == 0 ||
+        !readstring(records[next].nameoffset, records[next].namelength, name))
+    {
+      return false;
+    }
+    return expression(exp, 0);
+  }
+
+  bool done() const
+  {
+    return next == count;
+  }
+
+private:
+  bool readstring(std::uint64_t offset, std::uint64_t length, std::string &text) const
+  {
+    if (offset > stringsize || length > stringsize - offset)
+    {
+      return false;
+    }
+    text.assign(strings + offset, length);
+    return true;
+  }
+
+  // rebuilds an array from the elements read as the symbol value of atom
+  bool array(Atom &atom, const double *v) const
+  {
+    std::size_t columns = atom.type == PointArrayType ? 2 : 1;
+    const std::string &bytes = atom.value.sym_value;
+    if (!(v[0] >= 0) || v[0] != std::floor(v[0]) || bytes.size() != v[0] * columns * sizeof(Number) ||
+        !(v[1] == PathPoints || v[1] == PathOpen || v[1] == PathClosed))
+    {
+      return false;
+    }
+
+    std::size_t n = static_cast<std::size_t>(v[0]);
+    std::vector<Number> x(n), y(columns == 2 ? n : 0);
+    if (n)
+    {
+      std::memcpy(x.data(), bytes.data(), n * sizeof(Number));
+    }
+    if (!y.empty())
+    {
+      std::memcpy(y.data(), bytes.data() + n * sizeof(Number), n * sizeof(Number));
+    }
+    atom = (columns == 2 ? pointarray(std::move(x), std::move(y), static_cast<PathKind>(v[1]))
+                         : numberarray(std::move(x))).head;
+    return true;
+  }
+
+  bool expression(Expression &exp, unsigned depth)
+  {
+    if (next >= count || depth > CHECKPOINT_MAX_DEPTH)
+    {
+      return false;
+    }
+    const CheckpointRecord &record = records[next++];
+    if (record.type > NullType || record.tailcount > count - next ||
+        !readstring(record.symoffset, record.symlength, exp.head.value.sym_value))
+    {
+      return false;
+    }
+
+    exp.head.type = static_cast<Type>(record.type);
+    Value &value = exp.head.value;
+    const double *v = record.values;
+    switch (exp.head.type)
+    {
+    case BooleanType:
+      value.bool_value = v[0] != 0;
+      break;
+    case NumberType:
+      value.num_value = v[0];
+      break;
+    case PointType:
+      value.point_value = Point{v[0], v[1]};
+      break;
+    case LineType:
+      value.line_value = Line{Point{v[0], v[1]}, Point{v[2], v[3]}};
+      break;
+    case ArcType:
+      value.arc_value = Arc{Point{v[0], v[1]}, Point{v[2], v[3]}, v[4]};
+      break;
+    case NumberArrayType:
+    case PointArrayType:
+      if (!array(exp.head, v))
+      {
+        return false;
+      }
+      break;
+    default:
+      break;
+    }
+
+    exp.tail.resize(record.tailcount);
+    for (Expression &e : exp.tail)
+    {
+      if (!expression(e, depth + 1))
+      {
+        return false;
+      }
+    }
+    return true;
+  }
+
+  const CheckpointRecord *records;
+  std::uint64_t count;
+  const char *strings;
+  std::uint64_t stringsize;
+  std::uint64_t next;
+};
+} // namespace
+
+bool writecheckpoint(const Environment &env, const std::string &path)
+{
+  std::ofstream ofs(path, std::ios::binary);
+  if (!ofs)
+  {
+    return false;
+  }
+  return writecheckpoint(env, ofs);
+}
+
+bool writecheckpoint(const Environment &env, std::ostream &out)
+{
+  CheckpointBuilder builder;
+  env.foreachexp([&](const Symbol &name, const Expression &exp) { builder.binding(name, exp); });
+  if (builder.failed)
+  {
+    return false;
+  }
+
+  CheckpointHeader header;
+  std::memset(&header, 0, sizeof(header));
+  std::memcpy(header.magic, MAGIC, sizeof(MAGIC));
+  header.version = CHECKPOINT_VERSION;
+  header.bindingcount = builder.bindings;
+  header.recordcount = builder.records.size();
+  header.recordoffset = align8(sizeof(CheckpointHeader));
+  header.stringoffset = align8(header.recordoffset + header.recordcount * sizeof(CheckpointRecord));
+  header.stringsize = builder.strings.size();
+
+  out.write(reinterpret_cast<const char *>(&header), sizeof(header));
+  out.write(std::string(header.recordoffset - sizeof(header), '\0').data(), header.recordoffset - sizeof(header));
+  out.write(reinterpret_cast<const char *>(builder.records.data()), builder.records.size() * sizeof(CheckpointRecord));
+  out.write(builder.strings.data(), builder.strings.size());
+
+  out.flush();
+  return static_cast<bool>(out);
+}
+
+bool readcheckpoint(const std::string &path, Environment &env)
+{
+  MappedFile file;
+  if (!file.open(path) || file.size() < sizeof(CheckpointHeader))
+  {
+    return false;
+  }
+
+  const CheckpointHeader *h = reinterpret_cast<const CheckpointHeader *>(file.data());
+  if (std::memcmp(h->magic, MAGIC, sizeof(MAGIC)) != 0 || h->version != CHECKPOINT_VERSION)
+  {
+    return false;
+  }
+
+  // every section must lie within the file
+  std::uint64_t size = file.size();
+  if (h->recordoffset % 8 || h->recordoffset > size ||
+      h->recordcount > (size - h->recordoffset) / sizeof(CheckpointRecord) ||
+      h->stringoffset > size || h->stringsize > size - h->stringoffset ||
+      h->bindingcount > h->recordcount)
+  {
+    return false;
+  }
+
+  CheckpointReader reader(reinterpret_cast<const CheckpointRecord *>(file.data() + h->recordoffset), h->recordcount,
+                          file.data() + h->stringoffset, h->stringsize);
+
+  // the mappings go to a snapshot first, so env is untouched when the file is invalid
+  Environment restored = env.snapshot();
+  for (std::uint64_t i = 0; i < h->bindingcount; i++)
+  {
+    Symbol name;
+    Expression exp;
+    if (!reader.binding(name, exp) || restored.check(name))
+    {
+      return false;
+    }
+    restored.insertexp(name, exp);
+  }
+
+  if (!reader.done())
+  {
+    return false;
+  }
+
+  env = restored;
+  return true;
+}
@@ -0,0 +1,60 @@
+#ifndef CHECKPOINT_HPP
+#define CHECKPOINT_HPP
+
+// system includes
+#include <cstdint>
+#include <ostream>
+#include <string>
+
+// module includes
+#include "environment.hpp"
+
+// Binary checkpoint file (.slck) holding the user mappings of an environment,
+// the results of every define, so a prelude can be evaluated once and
+// restored at start-up instead of being evaluated again.
+//
+// Layout (native byte order, every section 8-byte aligned):
+//   CheckpointHeader
+//   records: recordcount CheckpointRecords, the expressions of every binding
+//            in preorder; the first record of a binding carries its name
+//   strings: the names and symbol values, referenced by offset and length,
+//            and the elements of arrays (the x doubles, then the y doubles)
+
+const std::uint32_t CHECKPOINT_VERSION = 2;
+
+struct CheckpointHeader
+{
+  char magic[4]; // "SLCK"
+  std::uint32_t version;
+  std::uint64_t bindingcount;
+  std::uint64_t recordcount;
+  std::uint64_t recordoffset;
+  std::uint64_t stringoffset;
+  std::uint64_t stringsize;
+};
+
+// one Expression node, followed by the records of its tail
+struct CheckpointRecord
+{
+  std::uint32_t type;      // the Type of the head atom
+  std::uint32_t tailcount; // number of tail expressions
+  std::uint64_t nameoffset; // the bound symbol, only on the first record of a binding
+  std::uint64_t namelength;
+  std::uint64_t symoffset; // the symbol value of the head, or its array elements
+  std::uint64_t symlength;
+  double values[5]; // boolean, number, point (x y), line (x1 y1 x2 y2), arc (cx cy sx sy span) or array (size path)
+};
+
+// writes the user mappings of env, returns false if the stream failed or, writing
+// nothing, if a mapping is nested too deeply to be read back
+bool writecheckpoint(const Environment &env, std::ostream &out);
+
+// writes the user mappings of env to the file at path
+bool writecheckpoint(const Environment &env, const std::string &path);
+
+// Maps the file at path and adds its mappings to env. Returns false, leaving
+// env unchanged, if the file is not a valid checkpoint or one of its symbols
+// is already mapped in env.
+bool readcheckpoint(const std::string &path, Environment &env);
+
+#endif
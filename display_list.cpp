@@ -0,0 +1,549 @@
+#include "display_list.hpp"
+
+// system includes
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <fstream>
+
+// module includes
+#include "arc_geometry.hpp"
+
+// the grid of the spatial index holds about this many primitives per cell
+#define INDEX_PRIMITIVES_PER_CELL 8
+// and is never wider or taller than this many cells
+#define INDEX_MAX_SIDE 1024
+
+namespace
+{
+const char MAGIC[4] = {'S', 'L', 'D', 'L'};
+
+std::uint64_t align8(std::uint64_t offset)
+{
+  return (offset + 7) & ~std::uint64_t(7);
+}
+
+bool intersects(const Bounds &a, const Bounds &b)
+{
+  return a.minx <= b.maxx && b.minx <= a.maxx && a.miny <= b.maxy && b.miny <= a.maxy;
+}
+
+void grow(Bounds &total, const Bounds &b, bool &empty)
+{
+  if (empty)
+  {
+    total = b;
+    empty = false;
+    return;
+  }
+  total.minx = std::min(total.minx, b.minx);
+  total.miny = std::min(total.miny, b.miny);
+  total.maxx = std::max(total.maxx, b.maxx);
+  total.maxy = std::max(total.maxy, b.maxy);
+}
+
+// maps coordinates to the cells of a uniform grid over the bounds
+struct Grid
+{
+  Bounds bounds;
+  std::uint32_t columns;
+  std::uint32_t rows;
+
+  std::uint32_t column(double x) const
+  {
+    return cell(x, bounds.minx, bounds.maxx, columns);
+  }
+
+  std::uint32_t row(double y) const
+  {
+    return cell(y, bounds.miny, bounds.maxy, rows);
+  }
+
+  static std::uint32_t cell(double v, double lo, double hi, std::uint32_t count)
+  {
+    if (!(hi > lo) || !(v > lo)) // also maps NaN to the first cell
+    {
+      return 0;
+    }
+    double c = (v - lo) / (hi - lo) * count;
+    return c >= count ? count - 1 : static_cast<std::uint32_t>(c);
+  }
+};
+
+// calls f(ref, bounds) for every primitive stored in the packed arrays
+template <typename F>
+void eachprimitive(const std::vector<double> &points, std::size_t npoints,
+                   const std::vector<double> &lines, std::size_t nlines,
+                   const std::vector<double> &arcs, std::size_t narcs, F f)
+{
+  for (std::size_t i = 0; i < npoints; i++)
+  {
+    const double *v = &points[2 * i];
+    f(DISPLAY_LIST_POINT_REF | i, primitivebounds(Point{v[0], v[1]}));
+  }
+  for (std::size_t i = 0; i < nlines; i++)
+  {
+    const double *v = &lines[4 * i];
+    f(DISPLAY_LIST_LINE_REF | i, primitivebounds(Line{Point{v[0], v[1]}, Point{v[2], v[3]}}));
+  }
+  for (std::size_t i = 0; i < narcs; i++)
+  {
+    const double *v = &arcs[5 * i];
+    f(DISPLAY_LIST_ARC_REF | i, primitivebounds(Arc{Point{v[0], v[1]}, Point{v[2], v[3]}, v[4]}));
+  }
+}
+
+void writepadding(std::ostream &out, std::uint64_t &position, std::uint64_t offset)
+{
+  static const char zeros[8] = {0};
+  out.write(zeros, offset - position);
+  position = offset;
+}
+
+void writecoordinates(std::ostream &out, std::uint64_t &position, const std::vector<double> &values, std::size_t count, bool asfloat)
+{
+  if (asfloat)
+  {
+    for (std::size_t i = 0; i < count; i++)
+    {
+      float f = static_cast<float>(values[i]);
+      out.write(reinterpret_cast<const char *>(&f), sizeof(f));
+    }
+    position += count * sizeof(float);
+  }
+  else
+  {
+    out.write(reinterpret_cast<const char *>(values.data()), count * sizeof(double));
+    position += count * sizeof(double);
+  }
+}
+} // namespace
+
+Bounds primitivebounds(const Point &p)
+{
+  return Bounds{p.x, p.y, p.x, p.y};
+}
+
+Bounds primitivebounds(const Line &l)
+{
+  return Bounds{std::min(l.first.x, l.second.x), std::min(l.first.y, l.second.y),
+                std::max(l.first.x, l.second.x), std::max(l.first.y, l.second.y)};
+}
+
+Bounds primitivebounds(const Arc &a)
+{
+  double radius = arcgeometry(a).radius;
+  return Bounds{a.center.x - radius, a.center.y - radius, a.center.x + radius, a.center.y + radius};
+}
+
+DisplayListWriter::DisplayListWriter(std::uint32_t flags) : flags(flags)
+{
+}
+
+double DisplayListWriter::stored(double v) const
+{
+  // Coordinates are rounded as they will be stored, so that the bounds and the
+  // spatial index are computed from exactly the values a reader will see
+  if (flags & DISPLAY_LIST_FLOAT)
+  {
+    return static_cast<float>(v);
+  }
+  return v;
+}
+
+void DisplayListWriter::point(const Point &p)
+{
+  points.push_back(stored(p.x));
+  points.push_back(stored(p.y));
+}
+
+void DisplayListWriter::line(const Line &l)
+{
+  lines.push_back(stored(l.first.x));
+  lines.push_back(stored(l.first.y));
+  lines.push_back(stored(l.second.x));
+  lines.push_back(stored(l.second.y));
+}
+
+void DisplayListWriter::arc(const Arc &a)
+{
+  arcs.push_back(stored(a.center.x));
+  arcs.push_back(stored(a.center.y));
+  arcs.push_back(stored(a.start.x));
+  arcs.push_back(stored(a.start.y));
+  arcs.push_back(stored(a.span));
+}
+
+void DisplayListWriter::commit()
+{
+  committedpoints = points.size() / 2;
+  committedlines = lines.size() / 4;
+  committedarcs = arcs.size() / 5;
+}
+
+void DisplayListWriter::discard()
+{
+  points.resize(committedpoints * 2);
+  lines.resize(committedlines * 4);
+  arcs.resize(committedarcs * 5);
+}
+
+bool DisplayListWriter::write(const std::string &path) const
+{
+  std::ofstream ofs(path, std::ios::binary);
+  if (!ofs)
+  {
+    return false;
+  }
+  return write(ofs);
+}
+
+bool DisplayListWriter::write(std::ostream &out) const
+{
+  DisplayListHeader header;
+  std::memset(&header, 0, sizeof(header));
+  std::memcpy(header.magic, MAGIC, sizeof(MAGIC));
+  header.version = DISPLAY_LIST_VERSION;
+  header.flags = flags;
+  header.pointcount = committedpoints;
+  header.linecount = committedlines;
+  header.arccount = committedarcs;
+
+  // bounding box of the scene
+  Bounds total = {0, 0, 0, 0};
+  bool empty = true;
+  eachprimitive(points, committedpoints, lines, committedlines, arcs, committedarcs,
+                [&](std::uint32_t, const Bounds &b) { grow(total, b, empty); });
+  header.bounds[0] = total.minx;
+  header.bounds[1] = total.miny;
+  header.bounds[2] = total.maxx;
+  header.bounds[3] = total.maxy;
+
+  bool asfloat = (flags & DISPLAY_LIST_FLOAT) != 0;
+  std::uint64_t coordinatesize = asfloat ? sizeof(float) : sizeof(double);
+  header.pointoffset = sizeof(DisplayListHeader);
+  header.lineoffset = align8(header.pointoffset + committedpoints * 2 * coordinatesize);
+  header.arcoffset = align8(header.lineoffset + committedlines * 4 * coordinatesize);
+  std::uint64_t end = align8(header.arcoffset + committedarcs * 5 * coordinatesize);
+
+  // Spatial index: a uniform grid over the bounds, each cell listing the primitives
+  // overlapping it. References only have 30 bits per kind, larger lists are not indexed.
+  std::uint64_t largest = std::max(committedpoints, std::max(committedlines, committedarcs));
+  bool indexed = (flags & DISPLAY_LIST_INDEXED) != 0 && largest <= DISPLAY_LIST_REF_MASK;
+  Grid grid = {total, 1, 1};
+  std::vector<std::uint32_t> celloffsets;
+  std::vector<std::uint32_t> refs;
+
+  if (indexed)
+  {
+    std::uint64_t cells = (committedpoints + committedlines + committedarcs) / INDEX_PRIMITIVES_PER_CELL;
+    std::uint32_t side = static_cast<std::uint32_t>(std::ceil(std::sqrt(static_cast<double>(cells))));
+    side = std::max(1u, std::min(side, static_cast<std::uint32_t>(INDEX_MAX_SIDE)));
+    grid.columns = side;
+    grid.rows = side;
+
+    // first pass counts the references of every cell, second pass fills them in
+    std::vector<std::uint64_t> counts(side * side + 1, 0);
+    eachprimitive(points, committedpoints, lines, committedlines, arcs, committedarcs,
+                  [&](std::uint32_t, const Bounds &b) {
+                    for (std::uint32_t r = grid.row(b.miny); r <= grid.row(b.maxy); r++)
+                    {
+                      for (std::uint32_t c = grid.column(b.minx); c <= grid.column(b.maxx); c++)
+                      {
+                        counts[r * side + c + 1]++;
+                      }
+                    }
+                  });
+    for (std::size_t i = 1; i < counts.size(); i++)
+    {
+      counts[i] += counts[i - 1];
+    }
+
+    if (counts.back() > 0xFFFFFFFFu)
+    {
+      indexed = false;
+    }
+    else
+    {
+      celloffsets.assign(counts.begin(), counts.end());
+      refs.resize(counts.back());
+      eachprimitive(points, committedpoints, lines, committedlines, arcs, committedarcs,
+                    [&](std::uint32_t ref, const Bounds &b) {
+                      for (std::uint32_t r = grid.row(b.miny); r <= grid.row(b.maxy); r++)
+                      {
+                        for (std::uint32_t c = grid.column(b.minx); c <= grid.column(b.maxx); c++)
+                        {
+                          refs[counts[r * side + c]++] = ref;
+                        }
+                      }
+                    });
+    }
+  }
+
+  if (indexed)
+  {
+    header.indexoffset = end;
+  }
+  else
+  {
+    header.flags &= ~DISPLAY_LIST_INDEXED;
+  }
+
+  std::uint64_t position = 0;
+  out.write(reinterpret_cast<const char *>(&header), sizeof(header));
+  position += sizeof(header);
+
+  writecoordinates(out, position, points, committedpoints * 2, asfloat);
+  writepadding(out, position, header.lineoffset);
+  writecoordinates(out, position, lines, committedlines * 4, asfloat);
+  writepadding(out, position, header.arcoffset);
+  writecoordinates(out, position, arcs, committedarcs * 5, asfloat);
+  writepadding(out, position, end);
+
+  if (indexed)
+  {
+    DisplayListIndexHeader index = {grid.columns, grid.rows, refs.size()};
+    out.write(reinterpret_cast<const char *>(&index), sizeof(index));
+    out.write(reinterpret_cast<const char *>(celloffsets.data()), celloffsets.size() * sizeof(std::uint32_t));
+    out.write(reinterpret_cast<const char *>(refs.data()), refs.size() * sizeof(std::uint32_t));
+  }
+
+  out.flush();
+  return static_cast<bool>(out);
+}
+
+bool DisplayList::open(const std::string &path)
+{
+  header = nullptr;
+
+  if (!file.open(path) || file.size() < sizeof(DisplayListHeader))
+  {
+    return false;
+  }
+
+  const DisplayListHeader *h = reinterpret_cast<const DisplayListHeader *>(file.data());
+  if (std::memcmp(h->magic, MAGIC, sizeof(MAGIC)) != 0 || h->version != DISPLAY_LIST_VERSION)
+  {
+    return false;
+  }
+
+  // every section must lie within the file, so accessors never read past the mapping
+  std::uint64_t coordinatesize = (h->flags & DISPLAY_LIST_FLOAT) ? sizeof(float) : sizeof(double);
+  std::uint64_t size = file.size();
+  std::uint64_t limit = size / (5 * coordinatesize);
+  if (h->pointcount > limit || h->linecount > limit || h->arccount > limit ||
+      h->pointoffset > size || h->pointcount * 2 * coordinatesize > size - h->pointoffset ||
+      h->lineoffset > size || h->linecount * 4 * coordinatesize > size - h->lineoffset ||
+      h->arcoffset > size || h->arccount * 5 * coordinatesize > size - h->arcoffset ||
+      h->pointoffset % 8 || h->lineoffset % 8 || h->arcoffset % 8)
+  {
+    return false;
+  }
+
+  if (h->flags & DISPLAY_LIST_INDEXED)
+  {
+    if (h->indexoffset % 8 || h->indexoffset > size || size - h->indexoffset < sizeof(DisplayListIndexHeader))
+    {
+      return false;
+    }
+    const DisplayListIndexHeader *index = reinterpret_cast<const DisplayListIndexHeader *>(file.data() + h->indexoffset);
+    std::uint64_t cells = std::uint64_t(index->columns) * index->rows;
+    std::uint64_t available = (size - h->indexoffset - sizeof(DisplayListIndexHeader)) / sizeof(std::uint32_t);
+    if (index->columns == 0 || index->rows == 0 || cells + 1 > available || index->refcount > available - cells - 1)
+    {
+      return false;
+    }
+    const std::uint32_t *offsets = reinterpret_cast<const std::uint32_t *>(index + 1);
+    for (std::uint64_t i = 0; i < cells; i++)
+    {
+      if (offsets[i] > offsets[i + 1] || offsets[i + 1] > index->refcount)
+      {
+        return false;
+      }
+    }
+    const std::uint32_t *refs = offsets + cells + 1;
+    for (std::uint64_t i = 0; i < index->refcount; i++)
+    {
+      std::uint32_t kind = refs[i] & ~DISPLAY_LIST_REF_MASK;
+      std::uint64_t n = refs[i] & DISPLAY_LIST_REF_MASK;
+      if ((kind == DISPLAY_LIST_POINT_REF && n >= h->pointcount) ||
+          (kind == DISPLAY_LIST_LINE_REF && n >= h->linecount) ||
+          (kind == DISPLAY_LIST_ARC_REF && n >= h->arccount) ||
+          kind > DISPLAY_LIST_ARC_REF)
+      {
+        return false;
+      }
+    }
+  }
+
+  header = h;
+  return true;
+}
+
+std::uint64_t DisplayList::pointCount() const
+{
+  return header ? header->pointcount : 0;
+}
+
+std::uint64_t DisplayList::lineCount() const
+{
+  return header ? header->linecount : 0;
+}
+
+std::uint64_t DisplayList::arcCount() const
+{
+  return header ? header->arccount : 0;
+}
+
+bool DisplayList::indexed() const
+{
+  return header && (header->flags & DISPLAY_LIST_INDEXED);
+}
+
+Bounds DisplayList::bounds() const
+{
+  if (!header)
+  {
+    return Bounds{0, 0, 0, 0};
+  }
+  return Bounds{header->bounds[0], header->bounds[1], header->bounds[2], header->bounds[3]};
+}
+
+double DisplayList::coordinate(std::uint64_t offset, std::uint64_t i) const
+{
+  const char *base = file.data() + offset;
+  if (header->flags & DISPLAY_LIST_FLOAT)
+  {
+    return reinterpret_cast<const float *>(base)[i];
+  }
+  return reinterpret_cast<const double *>(base)[i];
+}
+
+Point DisplayList::point(std::uint64_t i) const
+{
+  std::uint64_t o = header->pointoffset;
+  return Point{coordinate(o, 2 * i), coordinate(o, 2 * i + 1)};
+}
+
+Line DisplayList::line(std::uint64_t i) const
+{
+  std::uint64_t o = header->lineoffset;
+  return Line{Point{coordinate(o, 4 * i), coordinate(o, 4 * i + 1)},
+              Point{coordinate(o, 4 * i + 2), coordinate(o, 4 * i + 3)}};
+}
+
+Arc DisplayList::arc(std::uint64_t i) const
+{
+  std::uint64_t o = header->arcoffset;
+  return Arc{Point{coordinate(o, 5 * i), coordinate(o, 5 * i + 1)},
+             Point{coordinate(o, 5 * i + 2), coordinate(o, 5 * i + 3)},
+             coordinate(o, 5 * i + 4)};
+}
+
+void DisplayList::replay(GraphicsSink &sink) const
+{
+  for (std::uint64_t i = 0; i < pointCount(); i++)
+  {
+    sink.point(point(i));
+  }
+  for (std::uint64_t i = 0; i < lineCount(); i++)
+  {
+    sink.line(line(i));
+  }
+  for (std::uint64_t i = 0; i < arcCount(); i++)
+  {
+    sink.arc(arc(i));
+  }
+}
+
+void DisplayList::replayref(GraphicsSink &sink, std::uint32_t ref) const
+{
+  std::uint32_t n = ref & DISPLAY_LIST_REF_MASK;
+  switch (ref & ~DISPLAY_LIST_REF_MASK)
+  {
+  case DISPLAY_LIST_POINT_REF:
+    sink.point(point(n));
+    break;
+  case DISPLAY_LIST_LINE_REF:
+    sink.line(line(n));
+    break;
+  default:
+    sink.arc(arc(n));
+    break;
+  }
+}
+
+void DisplayList::replay(GraphicsSink &sink, const Bounds &area) const
+{
+  if (!header || !intersects(area, bounds()))
+  {
+    return;
+  }
+
+  if (!indexed())
+  {
+    // no index, every primitive is tested
+    for (std::uint64_t i = 0; i < pointCount(); i++)
+    {
+      if (intersects(area, primitivebounds(point(i))))
+      {
+        sink.point(point(i));
+      }
+    }
+    for (std::uint64_t i = 0; i < lineCount(); i++)
+    {
+      if (intersects(area, primitivebounds(line(i))))
+      {
+        sink.line(line(i));
+      }
+    }
+    for (std::uint64_t i = 0; i < arcCount(); i++)
+    {
+      if (intersects(area, primitivebounds(arc(i))))
+      {
+        sink.arc(arc(i));
+      }
+    }
+    return;
+  }
+
+  const DisplayListIndexHeader *index = reinterpret_cast<const DisplayListIndexHeader *>(file.data() + header->indexoffset);
+  const std::uint32_t *offsets = reinterpret_cast<const std::uint32_t *>(index + 1);
+  const std::uint32_t *refs = offsets + std::uint64_t(index->columns) * index->rows + 1;
+  Grid grid = {bounds(), index->columns, index->rows};
+
+  std::uint32_t c0 = grid.column(area.minx), c1 = grid.column(area.maxx);
+  std::uint32_t r0 = grid.row(area.miny), r1 = grid.row(area.maxy);
+
+  for (std::uint32_t r = r0; r <= r1; r++)
+  {
+    for (std::uint32_t c = c0; c <= c1; c++)
+    {
+      std::uint64_t cell = std::uint64_t(r) * grid.columns + c;
+      for (std::uint32_t i = offsets[cell]; i < offsets[cell + 1]; i++)
+      {
+        std::uint32_t ref = refs[i];
+        std::uint32_t n = ref & DISPLAY_LIST_REF_MASK;
+        Bounds b;
+        switch (ref & ~DISPLAY_LIST_REF_MASK)
+        {
+        case DISPLAY_LIST_POINT_REF:
+          b = primitivebounds(point(n));
+          break;
+        case DISPLAY_LIST_LINE_REF:
+          b = primitivebounds(line(n));
+          break;
+        default:
+          b = primitivebounds(arc(n));
+          break;
+        }
+
+        // a primitive spanning several cells is reported only by the first visited cell it overlaps
+        if (intersects(area, b) && c == std::max(grid.column(b.minx), c0) && r == std::max(grid.row(b.miny), r0))
+        {
+          replayref(sink, ref);
+        }
+      }
+    }
+  }
+}
@@ -0,0 +1,147 @@
+#ifndef DISPLAY_LIST_HPP
+#define DISPLAY_LIST_HPP
+
+// system includes
+#include <cstdint>
+#include <ostream>
+#include <string>
+#include <vector>
+
+// module includes
+#include "expression.hpp"
+#include "graphics_sink.hpp"
+#include "mapped_file.hpp"
+
+// Binary display-list file (.sldl) holding the primitives drawn by a program,
+// so a scene can be evaluated once and viewed without the interpreter.
+//
+// Layout (native byte order, every section 8-byte aligned):
+//   DisplayListHeader
+//   points: pointcount * 2 coordinates (x y)
+//   lines:  linecount  * 4 coordinates (x1 y1 x2 y2)
+//   arcs:   arccount   * 5 coordinates (cx cy sx sy span)
+//   optional spatial index (DISPLAY_LIST_INDEXED):
+//     DisplayListIndexHeader, then (columns * rows + 1) uint32 cell offsets,
+//     then the uint32 primitive references of every cell
+// Coordinates are doubles, or floats with DISPLAY_LIST_FLOAT.
+
+const std::uint32_t DISPLAY_LIST_VERSION = 1;
+
+// header flags
+const std::uint32_t DISPLAY_LIST_FLOAT = 1;
+const std::uint32_t DISPLAY_LIST_INDEXED = 2;
+
+// a primitive reference keeps its kind in the two high bits
+const std::uint32_t DISPLAY_LIST_POINT_REF = 0u << 30;
+const std::uint32_t DISPLAY_LIST_LINE_REF = 1u << 30;
+const std::uint32_t DISPLAY_LIST_ARC_REF = 2u << 30;
+const std::uint32_t DISPLAY_LIST_REF_MASK = (1u << 30) - 1;
+
+struct DisplayListHeader
+{
+  char magic[4]; // "SLDL"
+  std::uint32_t version;
+  std::uint32_t flags;
+  std::uint32_t reserved;
+  std::uint64_t pointcount;
+  std::uint64_t linecount;
+  std::uint64_t arccount;
+  double bounds[4]; // min x, min y, max x, max y of everything drawn
+  std::uint64_t pointoffset;
+  std::uint64_t lineoffset;
+  std::uint64_t arcoffset;
+  std::uint64_t indexoffset; // 0 without a spatial index
+};
+
+struct DisplayListIndexHeader
+{
+  std::uint32_t columns;
+  std::uint32_t rows;
+  std::uint64_t refcount;
+};
+
+// An axis-aligned rectangle
+struct Bounds
+{
+  double minx, miny, maxx, maxy;
+};
+
+// A GraphicsSink that packs the drawn primitives into display-list arrays
+// (16 to 40 bytes per primitive instead of an Atom) and writes the file.
+// There is no path record: a drawn path is stored as its segments.
+class DisplayListWriter : public GraphicsSink
+{
+public:
+  // flags is a combination of DISPLAY_LIST_FLOAT and DISPLAY_LIST_INDEXED
+  DisplayListWriter(std::uint32_t flags = DISPLAY_LIST_INDEXED);
+
+  void point(const Point &p);
+  void line(const Line &l);
+  void arc(const Arc &a);
+
+  void commit();
+  void discard();
+
+  // writes the committed primitives, returns false if the stream failed
+  bool write(std::ostream &out) const;
+
+  // writes the committed primitives to the file at path
+  bool write(const std::string &path) const;
+
+private:
+  double stored(double v) const;
+
+  std::uint32_t flags;
+
+  std::vector<double> points;
+  std::vector<double> lines;
+  std::vector<double> arcs;
+
+  // sizes of the arrays at the last commit
+  std::size_t committedpoints = 0;
+  std::size_t committedlines = 0;
+  std::size_t committedarcs = 0;
+};
+
+// A display-list file mapped into memory. Primitives are decoded on access,
+// nothing is copied when the file is opened.
+class DisplayList
+{
+public:
+  // maps and validates the file, returns false if it is not a valid display list
+  bool open(const std::string &path);
+
+  std::uint64_t pointCount() const;
+  std::uint64_t lineCount() const;
+  std::uint64_t arcCount() const;
+
+  Point point(std::uint64_t i) const;
+  Line line(std::uint64_t i) const;
+  Arc arc(std::uint64_t i) const;
+
+  // bounding box of everything in the list
+  Bounds bounds() const;
+
+  bool indexed() const;
+
+  // streams every primitive to sink, points first then lines then arcs
+  void replay(GraphicsSink &sink) const;
+
+  // streams the primitives whose bounding box intersects area,
+  // using the spatial index when the file has one
+  void replay(GraphicsSink &sink, const Bounds &area) const;
+
+private:
+  double coordinate(std::uint64_t offset, std::uint64_t i) const;
+  void replayref(GraphicsSink &sink, std::uint32_t ref) const;
+
+  MappedFile file;
+  const DisplayListHeader *header = nullptr;
+};
+
+// bounding box of a drawn primitive, arcs are bounded by their whole circle
+Bounds primitivebounds(const Point &p);
+Bounds primitivebounds(const Line &l);
+Bounds primitivebounds(const Arc &a);
+
+#endif
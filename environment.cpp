@@ -1,5 +1,6 @@
 #include "environment.hpp"
 
+#include <algorithm>
 #include <cassert>
 #include <cmath>
 #include <math.h>
@@ -7,205 +8,416 @@
 
 #include "interpreter_semantic_error.hpp"
 
-Environment::Environment()
+// the most elements range builds, larger ranges raise an error instead of
+// exhausting the memory
+#define ARRAY_MAX_SIZE (1 << 24)
+
+namespace
+{
+// A builtin mapping: a procedure, or, when proc is null, an expression that
+// is either a keyword (special form) or a constant
+struct Builtin
 {
-  // Implementing environment conditions for three special-form
-  // expression types:
-  // 1. define 2. begin and 3. if
-  // They are of the form:
-  // (define <symbol> <expression>)
-  // (begin <expression> <expression> ...)
-  // (if <expression1> <expression2> <expressions3>)
+  const char *name;
+  Procedure proc;
+  Procedure unchecked; // proc without its arity and type checks
+  const Reducer *reducer;
+  bool memoize;        // proc costs more than looking its result up in a MemoCache
+  bool keyword;
+  double value;
+};
+
+// The unchecked procedures compute exactly what their checked procedure
+// does, for the calls the checked one accepts. The evaluator only calls them
+// for calls the static type checker has proven well-typed (see optimizer.hpp).
+
+Expression booleanresult(bool value)
+{
+  Expression result;
+  result.head.type = BooleanType;
+  result.head.value.bool_value = value;
+  return result;
+}
 
-  keywords();
+Expression numberresult(double value)
+{
+  Expression result;
+  result.head.type = NumberType;
+  result.head.value.num_value = value;
+  return result;
+}
 
-  // Implementing environment conditions for the rest of the
-  // expression forms called: procedures.
-  // Common syntax is: (<symbol> <expression> <expression> ...)
-  // They take one or more arguments and return an expression
-  // according to their name.
-  // These are m-ary based on the number of arguments and thus have
-  // an arity of 1, 2,...m
+Expression not_unchecked(const std::vector<Atom> &args)
+{
+  return booleanresult(!args[1].value.bool_value);
+}
 
-  logicalprocedures();
-  comparisonprocedures();
-  basicarithmeticprocedures();
-  lognpowprocedures();
-  graphicprocedures();
-  trigonometricprocedures();
+Expression and_unchecked(const std::vector<Atom> &args)
+{
+  bool value = true;
+  for (std::size_t i = 1; i < args.size(); i++)
+  {
+    value = value && args[i].value.bool_value;
+  }
+  return booleanresult(value);
+}
+
+Expression or_unchecked(const std::vector<Atom> &args)
+{
+  bool value = false;
+  for (std::size_t i = 1; i < args.size(); i++)
+  {
+    value = value || args[i].value.bool_value;
+  }
+  return booleanresult(value);
+}
+
+Expression lessthan_unchecked(const std::vector<Atom> &args)
+{
+  return booleanresult(args[1].value.num_value < args[2].value.num_value);
+}
+
+Expression lessthaneq_unchecked(const std::vector<Atom> &args)
+{
+  return booleanresult(args[1].value.num_value <= args[2].value.num_value);
+}
 
-  // Special Symbol - Pi which evaluates to atan2(0, -1)
+Expression greaterthan_unchecked(const std::vector<Atom> &args)
+{
+  return booleanresult(args[1].value.num_value > args[2].value.num_value);
+}
+
+Expression greaterthaneq_unchecked(const std::vector<Atom> &args)
+{
+  return booleanresult(args[1].value.num_value >= args[2].value.num_value);
+}
 
-  specialexpressions();
+Expression equal_unchecked(const std::vector<Atom> &args)
+{
+  return booleanresult(args[1].value.num_value == args[2].value.num_value);
 }
 
-void Environment::keywords()
+Expression add_unchecked(const std::vector<Atom> &args)
 {
-  EnvResult Define, Begin, If, Draw;
+  double sum = 0;
+  for (std::size_t i = 1; i < args.size(); i++)
+  {
+    sum = sum + args[i].value.num_value;
+  }
+  return numberresult(sum);
+}
 
-  Define.type = ExpressionType;
-  Begin.type = ExpressionType;
-  If.type = ExpressionType;
-  Draw.type = ExpressionType;
+Expression sub_unchecked(const std::vector<Atom> &args)
+{
+  if (args.size() == 2)
+  {
+    return numberresult(0 - args[1].value.num_value);
+  }
+  return numberresult(args[1].value.num_value - args[2].value.num_value);
+}
 
-  std::pair<Symbol, EnvResult> define_spform("define", Define);
-  std::pair<Symbol, EnvResult> begin_spform("begin", Begin);
-  std::pair<Symbol, EnvResult> if_spform("if", If);
-  std::pair<Symbol, EnvResult> draw_spform("draw", Draw);
+Expression mul_unchecked(const std::vector<Atom> &args)
+{
+  double product = 1;
+  for (std::size_t i = 1; i < args.size(); i++)
+  {
+    product = product * args[i].value.num_value;
+  }
+  return numberresult(product);
+}
 
-  Define.exp.head.type = SymbolType;
-  Begin.exp.head.type = SymbolType;
-  If.exp.head.type = SymbolType;
-  Draw.exp.head.type = SymbolType;
+Expression div_unchecked(const std::vector<Atom> &args)
+{
+  return numberresult(args[1].value.num_value / args[2].value.num_value);
+}
 
-  envmap.insert(define_spform);
-  envmap.insert(begin_spform);
-  envmap.insert(if_spform);
-  envmap.insert(draw_spform);
+Expression log10_unchecked(const std::vector<Atom> &args)
+{
+  return numberresult(log10(args[1].value.num_value));
 }
 
-void Environment::logicalprocedures()
+Expression pow_unchecked(const std::vector<Atom> &args)
 {
-  EnvResult Not, And, Or; //logical procedures
+  return numberresult(pow(args[1].value.num_value, args[2].value.num_value));
+}
 
-  // note: since a vector of atoms is a Procedure which is a function pointer
-  // we reference the address using & (ampersand)
-  Not.type = ProcedureType;
-  Not.proc = (&not_proc); // Here, for example the procedure is layout for a logical not operation
-  And.type = ProcedureType;
-  And.proc = (&and_proc);
-  Or.type = ProcedureType;
-  Or.proc = (&or_proc);
+Expression point_unchecked(const std::vector<Atom> &args)
+{
+  Expression result;
+  result.head.type = PointType;
+  result.head.value.point_value.x = args[1].value.num_value;
+  result.head.value.point_value.y = args[2].value.num_value;
+  return result;
+}
 
-  std::pair<Symbol, EnvResult> not_proce("not", Not);
-  std::pair<Symbol, EnvResult> and_proce("and", And);
-  std::pair<Symbol, EnvResult> or_proce("or", Or);
+Expression line_unchecked(const std::vector<Atom> &args)
+{
+  Expression result;
+  result.head.type = LineType;
+  result.head.value.line_value.first = args[1].value.point_value;
+  result.head.value.line_value.second = args[2].value.point_value;
+  return result;
+}
 
-  // inserting the mappings for these procedures into the map for the environment variable:
+Expression arc_unchecked(const std::vector<Atom> &args)
+{
+  Expression result;
+  result.head.type = ArcType;
+  result.head.value.arc_value.center = args[1].value.point_value;
+  result.head.value.arc_value.start = args[2].value.point_value;
+  result.head.value.arc_value.span = args[3].value.num_value;
+  return result;
+}
 
-  envmap.insert(not_proce);
-  envmap.insert(and_proce);
-  envmap.insert(or_proce);
+// the sines or cosines of the elements of a NumberArray, from the same libm
+// calls as a Number so that element i is bit-identical to (sin i); the batch
+// kernel can differ in the last bit
+Expression sincosarray(const Atom &angles, bool sine)
+{
+  const Array &array = angles.value.array_value;
+  std::vector<Number> values(array.size());
+  for (std::size_t i = 0; i < array.size(); i++)
+  {
+    values[i] = sine ? sin(array.data->x[i]) : cos(array.data->x[i]);
+  }
+  return numberarray(std::move(values));
 }
 
-void Environment::comparisonprocedures()
+Expression sin_unchecked(const std::vector<Atom> &args)
 {
-  EnvResult lessthan, lessthaneq, greaterthan, greaterthaneq, equal; //comparison procedures
+  if (args[1].type == NumberArrayType)
+  {
+    return sincosarray(args[1], true);
+  }
+  return numberresult(sin(args[1].value.num_value));
+}
 
-  lessthan.type = ProcedureType;
-  lessthan.proc = (&lessthan_proc);
-  lessthaneq.type = ProcedureType;
-  lessthaneq.proc = (&lessthaneq_proc);
-  greaterthan.type = ProcedureType;
-  greaterthan.proc = (&greaterthan_proc);
-  greaterthaneq.type = ProcedureType;
-  greaterthaneq.proc = (&greaterthaneq_proc);
-  equal.type = ProcedureType;
-  equal.proc = (&equal_proc);
+Expression cos_unchecked(const std::vector<Atom> &args)
+{
+  if (args[1].type == NumberArrayType)
+  {
+    return sincosarray(args[1], false);
+  }
+  return numberresult(cos(args[1].value.num_value));
+}
 
-  std::pair<Symbol, EnvResult> lessthan_proce("<", lessthan);
-  std::pair<Symbol, EnvResult> lessthanequal_proce("<=", lessthaneq);
-  std::pair<Symbol, EnvResult> greaterthan_proce(">", greaterthan);
-  std::pair<Symbol, EnvResult> greaterthaneq_proce(">=", greaterthaneq);
-  std::pair<Symbol, EnvResult> equal_proce("=", equal);
+// The elements of a NumberArray, or n copies of a Number
+std::vector<Number> column(const Atom &atom, std::size_t n)
+{
+  if (atom.type == NumberType)
+  {
+    return std::vector<Number>(n, atom.value.num_value);
+  }
+  const Array &array = atom.value.array_value;
+  return array.data ? array.data->x : std::vector<Number>();
+}
 
-  envmap.insert(lessthan_proce);
-  envmap.insert(lessthanequal_proce);
-  envmap.insert(greaterthan_proce);
-  envmap.insert(greaterthaneq_proce);
-  envmap.insert(equal_proce);
+// A PointArray of the points f(x, y) of shape, drawn the same way
+template <typename F>
+Expression transform(const Atom &shape, F f)
+{
+  const Array &array = shape.value.array_value;
+  std::vector<Number> x(array.size()), y(array.size());
+  for (std::size_t i = 0; i < array.size(); i++)
+  {
+    Point p = f(array.data->x[i], array.data->y[i]);
+    x[i] = p.x;
+    y[i] = p.y;
+  }
+  return pointarray(std::move(x), std::move(y), array.path);
 }
 
-void Environment::basicarithmeticprocedures()
+// polyline and polygon: a PointArray drawn as path, made of a PointArray or
+// of at least minimum Points
+Expression pathproc(const std::vector<Atom> &args, PathKind path, const std::string &name, std::size_t minimum)
 {
-  EnvResult add, sub, mul, div; //basic arithmetic operational procedures
+  if (args.size() == 2 && args[1].type == PointArrayType)
+  {
+    // the elements are shared, only the way they are drawn changes
+    Expression result(args[1]);
+    result.head.value.array_value.path = path;
+    return result;
+  }
 
-  add.type = ProcedureType;
-  add.proc = (&add_proc);
-  sub.type = ProcedureType;
-  sub.proc = (&sub_proc);
-  mul.type = ProcedureType;
-  mul.proc = (&mul_proc);
-  div.type = ProcedureType;
-  div.proc = (&div_proc);
+  if (args.size() < minimum + 1)
+  {
+    throw InterpreterSemanticError("Error (semantic). " + name + " takes a PointArray or at least " +
+                                   std::to_string(minimum) + " Points");
+  }
+  std::vector<Number> x, y;
+  x.reserve(args.size() - 1);
+  y.reserve(args.size() - 1);
+  for (std::size_t i = 1; i < args.size(); i++)
+  {
+    if (args[i].type != PointType)
+    {
+      throw InterpreterSemanticError("Error (semantic). Invalid Type! " + name +
+                                     " only works on a PointArray or Point arguments/atoms");
+    }
+    x.push_back(args[i].value.point_value.x);
+    y.push_back(args[i].value.point_value.y);
+  }
+  return pointarray(std::move(x), std::move(y), path);
+}
+
+Expression arctan_unchecked(const std::vector<Atom> &args)
+{
+  return numberresult(atan2(args[1].value.num_value, args[2].value.num_value));
+}
 
-  std::pair<Symbol, EnvResult> add_proce("+", add);
-  std::pair<Symbol, EnvResult> sub_proce("-", sub);
-  std::pair<Symbol, EnvResult> mul_proce("*", mul);
-  std::pair<Symbol, EnvResult> div_proce("/", div);
+// The reducers fold exactly as add_proc, mul_proc, and_proc and or_proc do, in
+// the same order and from the same initial value, so their results are
+// bit-identical. and and or stop at the first argument that decides them.
 
-  envmap.insert(add_proce);
-  envmap.insert(sub_proce);
-  envmap.insert(mul_proce);
-  envmap.insert(div_proce);
+Expression addstart()
+{
+  return numberresult(0);
 }
 
-void Environment::lognpowprocedures()
+Expression mulstart()
 {
-  EnvResult LogTen, power; //logarithmic and power procedures
+  return numberresult(1);
+}
 
-  LogTen.type = ProcedureType;
-  LogTen.proc = (&Log10_proc);
-  power.type = ProcedureType;
-  power.proc = (&pow_proc);
+Expression andstart()
+{
+  return booleanresult(true);
+}
 
-  std::pair<Symbol, EnvResult> LogTen_proce("log10", LogTen);
-  std::pair<Symbol, EnvResult> power_proce("pow", power);
+Expression orstart()
+{
+  return booleanresult(false);
+}
 
-  envmap.insert(LogTen_proce);
-  envmap.insert(power_proce);
+bool addstep(Expression &sum, const Atom &argument)
+{
+  if (argument.type != NumberType)
+  {
+    throw InterpreterSemanticError("Invalid Type! + only works on Number arguments/atoms");
+  }
+  sum.head.value.num_value = sum.head.value.num_value + argument.value.num_value;
+  return true;
 }
 
-void Environment::graphicprocedures()
+bool mulstep(Expression &product, const Atom &argument)
 {
-  EnvResult point; // point - procedure
-  EnvResult line;  // line - procedure
-  EnvResult arc;   // arc - procedure
+  if (argument.type != NumberType)
+  {
+    throw InterpreterSemanticError("Invalid Type! * only works on Number arguments/atoms");
+  }
+  product.head.value.num_value = product.head.value.num_value * argument.value.num_value;
+  return true;
+}
 
-  point.type = ProcedureType;
-  point.proc = (&point_proc);
-  line.type = ProcedureType;
-  line.proc = (&line_proc);
-  arc.type = ProcedureType;
-  arc.proc = (&arc_proc);
+bool andstep(Expression &conjunction, const Atom &argument)
+{
+  if (argument.type != BooleanType)
+  {
+    throw InterpreterSemanticError("Invalid Type! AND only works on Boolean arguments/atoms");
+  }
+  conjunction.head.value.bool_value = conjunction.head.value.bool_value && argument.value.bool_value;
+  return conjunction.head.value.bool_value;
+}
 
-  std::pair<Symbol, EnvResult> point_proce("point", point);
-  std::pair<Symbol, EnvResult> line_proce("line", line);
-  std::pair<Symbol, EnvResult> arc_proce("arc", arc);
+bool orstep(Expression &disjunction, const Atom &argument)
+{
+  if (argument.type != BooleanType)
+  {
+    throw InterpreterSemanticError("Invalid Type! OR only works on Boolean arguments/atoms");
+  }
+  disjunction.head.value.bool_value = disjunction.head.value.bool_value || argument.value.bool_value;
+  return !disjunction.head.value.bool_value;
+}
 
-  envmap.insert(point_proce);
-  envmap.insert(line_proce);
-  envmap.insert(arc_proce);
+constexpr Reducer addreducer = {&addstart, &addstep};
+constexpr Reducer mulreducer = {&mulstart, &mulstep};
+constexpr Reducer andreducer = {&andstart, &andstep};
+constexpr Reducer orreducer = {&orstart, &orstep};
+
+// The builtin layer of every environment, sorted by name for binary search.
+// It is constant-initialized, so no environment ever builds it.
+//
+// The special forms are of the form:
+// (define <symbol> <expression>)
+// (begin <expression> <expression> ...)
+// (if <expression1> <expression2> <expressions3>)
+// (draw <expression> ...) and (profile-report).
+// The procedures take one or more arguments, (<symbol> <expression> <expression> ...),
+// and return an expression according to their name.
+// pi evaluates to atan2(0, -1).
+// The array procedures check the sizes of their arrays, which the type checker
+// cannot prove, so they are their own unchecked procedure.
+constexpr Builtin builtins[] = {
+    {"*", &mul_proc, &mul_unchecked, &mulreducer, false, false, 0},
+    {"+", &add_proc, &add_unchecked, &addreducer, false, false, 0},
+    {"-", &sub_proc, &sub_unchecked, nullptr, false, false, 0},
+    {"/", &div_proc, &div_unchecked, nullptr, false, false, 0},
+    {"<", &lessthan_proc, &lessthan_unchecked, nullptr, false, false, 0},
+    {"<=", &lessthaneq_proc, &lessthaneq_unchecked, nullptr, false, false, 0},
+    {"=", &equal_proc, &equal_unchecked, nullptr, false, false, 0},
+    {">", &greaterthan_proc, &greaterthan_unchecked, nullptr, false, false, 0},
+    {">=", &greaterthaneq_proc, &greaterthaneq_unchecked, nullptr, false, false, 0},
+    {"and", &and_proc, &and_unchecked, &andreducer, false, false, 0},
+    {"arc", &arc_proc, &arc_unchecked, nullptr, true, false, 0},
+    {"arctan", &arctan_proc, &arctan_unchecked, nullptr, true, false, 0},
+    {"begin", nullptr, nullptr, nullptr, false, true, 0},
+    {"cos", &cos_proc, &cos_unchecked, nullptr, true, false, 0},
+    {"define", nullptr, nullptr, nullptr, false, true, 0},
+    {"draw", nullptr, nullptr, nullptr, false, true, 0},
+    {"if", nullptr, nullptr, nullptr, false, true, 0},
+    {"line", &line_proc, &line_unchecked, nullptr, true, false, 0},
+    {"log10", &Log10_proc, &log10_unchecked, nullptr, true, false, 0},
+    {"not", &not_proc, &not_unchecked, nullptr, false, false, 0},
+    {"or", &or_proc, &or_unchecked, &orreducer, false, false, 0},
+    {"pi", nullptr, nullptr, nullptr, false, false, 3.14159265358979323846},
+    {"point", &point_proc, &point_unchecked, nullptr, true, false, 0},
+    {"points-from-range", &pointsfromrange_proc, &pointsfromrange_proc, nullptr, false, false, 0},
+    {"polygon", &polygon_proc, &polygon_proc, nullptr, false, false, 0},
+    {"polyline", &polyline_proc, &polyline_proc, nullptr, false, false, 0},
+    {"pow", &pow_proc, &pow_unchecked, nullptr, true, false, 0},
+    {"profile-report", nullptr, nullptr, nullptr, false, true, 0},
+    {"range", &range_proc, &range_proc, nullptr, false, false, 0},
+    {"rotate", &rotate_proc, &rotate_proc, nullptr, false, false, 0},
+    {"scale", &scale_proc, &scale_proc, nullptr, false, false, 0},
+    {"sin", &sin_proc, &sin_unchecked, nullptr, true, false, 0},
+    {"translate", &translate_proc, &translate_proc, nullptr, false, false, 0},
+};
+
+constexpr std::size_t builtincount = sizeof(builtins) / sizeof(builtins[0]);
+
+// strcmp, usable in constant expressions
+constexpr int compare(const char *a, const char *b)
+{
+  return (*a != *b || *a == '\0') ? (static_cast<unsigned char>(*a) - static_cast<unsigned char>(*b))
+                                   : compare(a + 1, b + 1);
 }
 
-void Environment::trigonometricprocedures()
+constexpr bool sortedfrom(std::size_t i)
 {
-  EnvResult sin, cos, arctan; // trigonometric procedures
+  return i + 1 >= builtincount || (compare(builtins[i].name, builtins[i + 1].name) < 0 && sortedfrom(i + 1));
+}
 
-  sin.type = ProcedureType;
-  sin.proc = (&sin_proc);
-  cos.type = ProcedureType;
-  cos.proc = (&cos_proc);
-  arctan.type = ProcedureType;
-  arctan.proc = (&arctan_proc);
+static_assert(sortedfrom(0), "the builtin table must be sorted by name");
 
-  std::pair<Symbol, EnvResult> sin_proce("sin", sin);
-  std::pair<Symbol, EnvResult> cos_proce("cos", cos);
-  std::pair<Symbol, EnvResult> arctan_proce("arctan", arctan);
+bool builtinless(const Builtin &b, const Symbol &x)
+{
+  return x.compare(b.name) > 0;
+}
 
-  envmap.insert(sin_proce);
-  envmap.insert(cos_proce);
-  envmap.insert(arctan_proce);
+// the builtin named x, or nullptr
+const Builtin *findbuiltin(const Symbol &x)
+{
+  const Builtin *it = std::lower_bound(builtins, builtins + builtincount, x, builtinless);
+  if (it != builtins + builtincount && x.compare(it->name) == 0)
+  {
+    return it;
+  }
+  return nullptr;
 }
+} // namespace
 
-void Environment::specialexpressions()
+Environment::Environment()
 {
-  EnvResult pi;
-  Expression PI(atan2(0, -1));
-  pi.type = ExpressionType;
-  pi.exp = PI;
-  std::pair<Symbol, EnvResult> pi_exp("pi", pi);
-  envmap.insert(pi_exp);
 }
 
 Expression not_proc(const std::vector<Atom> &args)
@@ -239,9 +451,12 @@ Expression and_proc(const std::vector<Atom> &args)
     throw InterpreterSemanticError("AND is m-ary. At least 2 arguments are required");
   }
   // Ensure the type is appropriate for the arguments
-  if (args[1].type != BooleanType || args[2].type != BooleanType)
+  for (int i = 1; i < args.size(); i++)
   {
-    throw InterpreterSemanticError("Invalid Type! AND only works on Boolean arguments/atoms");
+    if (args[i].type != BooleanType)
+    {
+      throw InterpreterSemanticError("Invalid Type! AND only works on Boolean arguments/atoms");
+    }
   }
 
   Expression result;
@@ -445,7 +660,7 @@ Expression sub_proc(const std::vector<Atom> &args)
   }
 
   // Ensure the type is appropriate for the arguments
-  if (args[1].type != NumberType && args[2].type != NumberType)
+  if (args[1].type != NumberType && (args.size() == 2 || args[2].type != NumberType))
   {
     throw InterpreterSemanticError("Invalid Type! - only works on Number arguments/atoms");
   }
@@ -656,18 +871,21 @@ Expression sin_proc(const std::vector<Atom> &args)
     throw InterpreterSemanticError("Error (semantic). sin is unary. Only 1 argument is required");
   }
 
+  // a NumberArray is mapped element by element
+  if (args[1].type == NumberArrayType)
+  {
+    return sincosarray(args[1], true);
+  }
+
   // Ensure the type is appropriate for the arguments
   if (args[1].type != NumberType)
   {
     throw InterpreterSemanticError("Error (semantic). Invalid Type! sin only works on Number arguments/atoms");
   }
 
-  Expression Result;
-
-  Result.head.type = NumberType;
-  Result.head.value.num_value = sin(args[1].value.num_value);
-
-  return Result;
+  // returned as a temporary like the array: a named result returned next to
+  // it was moved out, which doubled the cost of the call in unoptimized builds
+  return numberresult(sin(args[1].value.num_value));
 }
 
 Expression cos_proc(const std::vector<Atom> &args)
@@ -678,18 +896,19 @@ Expression cos_proc(const std::vector<Atom> &args)
     throw InterpreterSemanticError("Error (semantic). cos is unary. Only 1 argument is required");
   }
 
+  // a NumberArray is mapped element by element
+  if (args[1].type == NumberArrayType)
+  {
+    return sincosarray(args[1], false);
+  }
+
   // Ensure the type is appropriate for the arguments
   if (args[1].type != NumberType)
   {
     throw InterpreterSemanticError("Error (semantic). Invalid Type! cos only works on Number arguments/atoms");
   }
 
-  Expression Result;
-
-  Result.head.type = NumberType;
-  Result.head.value.num_value = cos(args[1].value.num_value);
-
-  return Result;
+  return numberresult(cos(args[1].value.num_value));
 }
 
 Expression arctan_proc(const std::vector<Atom> &args)
@@ -714,47 +933,296 @@ Expression arctan_proc(const std::vector<Atom> &args)
   return Result;
 }
 
+Expression range_proc(const std::vector<Atom> &args)
+{
+  // Ensure the arity is followed (i.e. binary or tertiary)
+  if (args.size() != 3 && args.size() != 4)
+  {
+    throw InterpreterSemanticError("Error (semantic). range takes 2 or 3 arguments");
+  }
+
+  // Ensure the type is appropriate for the arguments
+  for (std::size_t i = 1; i < args.size(); i++)
+  {
+    if (args[i].type != NumberType)
+    {
+      throw InterpreterSemanticError("Error (semantic). Invalid Type! range only works on Number arguments/atoms");
+    }
+  }
+
+  // start, start + step, ... up to end excluded; a step away from end gives
+  // an empty array, a zero step one too long to build
+  Number start = args[1].value.num_value;
+  Number end = args[2].value.num_value;
+  Number step = args.size() == 4 ? args[3].value.num_value : 1;
+  Number count = std::ceil((end - start) / step);
+  if (count > ARRAY_MAX_SIZE)
+  {
+    throw InterpreterSemanticError("Error (semantic). range has more than " + std::to_string(ARRAY_MAX_SIZE) +
+                                   " elements");
+  }
+
+  std::vector<Number> values(count > 0 ? static_cast<std::size_t>(count) : 0);
+  for (std::size_t i = 0; i < values.size(); i++)
+  {
+    values[i] = start + i * step;
+  }
+  return numberarray(std::move(values));
+}
+
+Expression pointsfromrange_proc(const std::vector<Atom> &args)
+{
+  // Ensure the arity is followed (i.e. binary)
+  if (args.size() != 3)
+  {
+    throw InterpreterSemanticError("Error (semantic). points-from-range is binary. Only 2 arguments are required");
+  }
+
+  // Ensure the type is appropriate for the arguments: the x and y coordinates,
+  // a NumberArray and a NumberArray or a Number used for every point
+  bool xarray = args[1].type == NumberArrayType;
+  bool yarray = args[2].type == NumberArrayType;
+  if (!(xarray || args[1].type == NumberType) || !(yarray || args[2].type == NumberType) || !(xarray || yarray))
+  {
+    throw InterpreterSemanticError(
+        "Error (semantic). Invalid Type! points-from-range only works on NumberArray or Number arguments/atoms");
+  }
+
+  std::size_t n = (xarray ? args[1] : args[2]).value.array_value.size();
+  if (xarray && yarray && args[2].value.array_value.size() != n)
+  {
+    throw InterpreterSemanticError("Error (semantic). points-from-range needs NumberArrays of the same size");
+  }
+  return pointarray(column(args[1], n), column(args[2], n), PathPoints);
+}
+
+Expression polyline_proc(const std::vector<Atom> &args)
+{
+  return pathproc(args, PathOpen, "polyline", 2);
+}
+
+Expression polygon_proc(const std::vector<Atom> &args)
+{
+  return pathproc(args, PathClosed, "polygon", 3);
+}
+
+Expression translate_proc(const std::vector<Atom> &args)
+{
+  // Ensure the arity is followed (i.e. tertiary)
+  if (args.size() != 4)
+  {
+    throw InterpreterSemanticError("Error (semantic). translate is tertiary. Only 3 arguments are required");
+  }
+
+  // Ensure the type is appropriate for the arguments
+  if (args[1].type != PointArrayType || args[2].type != NumberType || args[3].type != NumberType)
+  {
+    throw InterpreterSemanticError(
+        "Error (semantic). Invalid Type! translate only works on a PointArray and Number arguments/atoms");
+  }
+
+  Number dx = args[2].value.num_value;
+  Number dy = args[3].value.num_value;
+  return transform(args[1], [=](Number x, Number y) { return Point{x + dx, y + dy}; });
+}
+
+Expression rotate_proc(const std::vector<Atom> &args)
+{
+  // Ensure the arity is followed (i.e. binary or tertiary)
+  if (args.size() != 3 && args.size() != 4)
+  {
+    throw InterpreterSemanticError("Error (semantic). rotate takes 2 or 3 arguments");
+  }
+
+  // Ensure the type is appropriate for the arguments: the angle in radians
+  // and the center, the origin when it is omitted
+  if (args[1].type != PointArrayType || args[2].type != NumberType || (args.size() == 4 && args[3].type != PointType))
+  {
+    throw InterpreterSemanticError(
+        "Error (semantic). Invalid Type! rotate only works on a PointArray, a Number and a Point arguments/atoms");
+  }
+
+  Point center = args.size() == 4 ? args[3].value.point_value : Point{0, 0};
+  Number c = cos(args[2].value.num_value);
+  Number s = sin(args[2].value.num_value);
+  return transform(args[1], [=](Number x, Number y) {
+    return Point{center.x + (x - center.x) * c - (y - center.y) * s,
+                 center.y + (x - center.x) * s + (y - center.y) * c};
+  });
+}
+
+Expression scale_proc(const std::vector<Atom> &args)
+{
+  // Ensure the arity is followed (i.e. binary or tertiary)
+  if (args.size() != 3 && args.size() != 4)
+  {
+    throw InterpreterSemanticError("Error (semantic). scale takes 2 or 3 arguments");
+  }
+
+  // Ensure the type is appropriate for the arguments: one factor for both
+  // coordinates, or one for x and one for y
+  if (args[1].type != PointArrayType || args[2].type != NumberType || (args.size() == 4 && args[3].type != NumberType))
+  {
+    throw InterpreterSemanticError(
+        "Error (semantic). Invalid Type! scale only works on a PointArray and Number arguments/atoms");
+  }
+
+  Number sx = args[2].value.num_value;
+  Number sy = args.size() == 4 ? args[3].value.num_value : sx;
+  return transform(args[1], [=](Number x, Number y) { return Point{x * sx, y * sy}; });
+}
+
+Procedure Environment::builtinproc(const Symbol &x)
+{
+  const Builtin *builtin = findbuiltin(x);
+  return builtin != nullptr ? builtin->proc : nullptr;
+}
+
+Procedure Environment::uncheckedproc(const Symbol &x)
+{
+  const Builtin *builtin = findbuiltin(x);
+  return builtin != nullptr ? builtin->unchecked : nullptr;
+}
+
+const Reducer *Environment::reducer(const Symbol &x)
+{
+  // only + * and or have one, the other names are not looked up
+  if (x.size() > 3)
+  {
+    return nullptr;
+  }
+  const Builtin *builtin = findbuiltin(x);
+  return builtin != nullptr ? builtin->reducer : nullptr;
+}
+
+bool Environment::memoizable(Procedure proc)
+{
+  // comparing pointers is cheaper than looking the name up again
+  for (const Builtin &builtin : builtins)
+  {
+    if (builtin.memoize && (builtin.proc == proc || builtin.unchecked == proc))
+    {
+      return true;
+    }
+  }
+  return false;
+}
+
 // Returns an existing mapping for a procedure
-Procedure Environment::searchProc(Symbol x)
+Procedure Environment::searchProc(const Symbol &x) const
 {
-  std::map<Symbol, EnvResult>::iterator it;
+  const Builtin *builtin = findbuiltin(x);
+  if (builtin != nullptr && builtin->proc != nullptr)
+  {
+    return builtin->proc;
+  }
 
-  it = envmap.find(x);
+  const EnvResult *result = envmap.find(x);
 
-  if (it == envmap.end())
+  if (builtin != nullptr || result == nullptr)
   {
     throw InterpreterSemanticError("Error (semantic). It exists as you're accessing a procedure that should not exist.");
   }
 
-  return it->second.proc;
+  return result->proc;
 }
 
 // Returns an existing mapping for an expression
-Expression Environment::searchExp(Symbol pi)
+Expression Environment::searchExp(const Symbol &pi) const
 {
-  std::map<Symbol, EnvResult>::iterator it;
+  const Builtin *builtin = findbuiltin(pi);
+  if (builtin != nullptr)
+  {
+    Expression exp;
+    if (builtin->keyword)
+    {
+      exp.head.type = SymbolType;
+    }
+    else if (builtin->proc == nullptr)
+    {
+      exp = Expression(builtin->value);
+    }
+    return exp;
+  }
 
-  it = envmap.find(pi);
+  const EnvResult *result = envmap.find(pi);
 
-  if (it == envmap.end())
+  if (result == nullptr)
   {
     throw InterpreterSemanticError("Error (semantic). It exists as you're accessing a symbol that has no active mapping in the environment!");
   }
-  return it->second.exp;
+  return result->exp;
+}
+
+bool Environment::check(const Symbol &x) const
+{
+  return findbuiltin(x) != nullptr || envmap.find(x) != nullptr;
+}
+
+std::size_t Environment::size() const
+{
+  return builtincount + envmap.size();
 }
 
 void Environment::insertexp(Symbol x, Expression y)
 {
+  if (findbuiltin(x) != nullptr) // builtins are never redefined
+  {
+    return;
+  }
+
   EnvResult X;
+  X.type = ExpressionType;
   X.exp = y;
-  envmap.insert(std::pair<Symbol, EnvResult>(x, X));
+  if (envmap.insert(x, X) && journaling)
+  {
+    journal.push_back(x);
+  }
 }
 
 void Environment::insertproc(Symbol x, Procedure y)
 {
+  if (findbuiltin(x) != nullptr)
+  {
+    return;
+  }
+
   EnvResult X;
   X.proc = y;
   X.type = ProcedureType;
 
-  envmap.insert(std::pair<Symbol, EnvResult>(x, X));
+  if (envmap.insert(x, X) && journaling)
+  {
+    journal.push_back(x);
+  }
+}
+
+Environment Environment::snapshot() const
+{
+  Environment copy;
+  copy.envmap = envmap; // shares every node of the trie
+  return copy;
+}
+
+void Environment::begintransaction()
+{
+  journal.clear();
+  journaling = true;
+}
+
+void Environment::commit()
+{
+  journal.clear();
+  journaling = false;
+}
+
+void Environment::rollback()
+{
+  // undo in the reverse order of the insertions
+  for (std::vector<Symbol>::reverse_iterator it = journal.rbegin(); it != journal.rend(); ++it)
+  {
+    envmap.erase(*it);
+  }
+  journal.clear();
+  journaling = false;
 }
\ No newline at end of file
@@ -2,10 +2,22 @@
 #define ENVIRONMENT_HPP
 
 // system includes
-#include <map>
+#include <vector>
 
 // module includes
 #include "expression.hpp"
+#include "persistent_map.hpp"
+
+// The streaming form of a variadic builtin procedure (+ * and or). Instead of
+// collecting the arguments for the procedure, the evaluator folds each one
+// into an accumulator as soon as it is evaluated. start returns the initial
+// accumulator; step folds an argument, raising the error the procedure would
+// raise for it, and returns false once the result can no longer change.
+struct Reducer
+{
+  Expression (*start)();
+  bool (*step)(Expression &accumulator, const Atom &argument);
+};
 
 class Environment
 {
@@ -23,91 +35,87 @@ private:
     Procedure proc;
   };
 
-  std::map<Symbol, EnvResult> envmap;
+  // The builtin keywords, procedures and pi live in a static table shared by
+  // every environment (see environment.cpp), envmap only holds the mappings
+  // added by define. It is a persistent map, so copies of an environment
+  // share their mappings and copying one is O(1).
+  PersistentMap<EnvResult> envmap;
+
+  // symbols inserted since begintransaction, in insertion order
+  std::vector<Symbol> journal;
+  bool journaling = false;
 
 public:
-  // default constructor that initializes the default environment
+  // default constructor, the builtins need no initialization
   Environment();
 
-  // inserting the mappings for keywords
-  void keywords();
-
-  // inserting the mappings for logical procedures
-  void logicalprocedures();
-
-  // inserting the mappings for comparison procedures
-  void comparisonprocedures();
+  // returns the builtin procedure named x, or nullptr
+  static Procedure builtinproc(const Symbol &x);
 
-  // inserting the mappings for basic arithmetic procedures
-  void basicarithmeticprocedures();
+  // returns the builtin procedure named x without its arity and type checks,
+  // or nullptr; only calls proven well-typed may use it
+  static Procedure uncheckedproc(const Symbol &x);
 
-  // inserting the mappings for logarithmic and power procedures
-  void lognpowprocedures();
+  // returns the streaming form of the builtin procedure named x, or nullptr
+  static const Reducer *reducer(const Symbol &x);
 
-  // inserting the mappings for graphic procedures
-  void graphicprocedures();
-
-  // inserting the mappinds for trigonometric procedures
-  void trigonometricprocedures();
-
-  // inserting the mappings for special expressions like PI
-  void specialexpressions();
+  // true for the builtin procedures worth memoizing (see memo_cache.hpp), the
+  // trigonometric, exponential and geometry ones, checked or not
+  static bool memoizable(Procedure proc);
 
   // returns the procedure (of an EnvResult object in the existing environment) for a given Symbol
-  Procedure searchProc(Symbol x);
+  Procedure searchProc(const Symbol &x) const;
 
   // returns the equivalent expression value (as stored in the default environment) for a given symbol such as "pi"
-  Expression searchExp(Symbol pi);
+  Expression searchExp(const Symbol &pi) const;
 
-  // inserts a mapping into the environment for a given symbol and expression
+  // inserts a mapping into the environment for a given symbol and expression,
+  // existing mappings (builtin or not) are never replaced
   void insertexp(Symbol x, Expression y);
 
   // inserts a mapping into the environment for a given symbol and procedure
   void insertproc(Symbol x, Procedure y);
 
   // checks if there is an existing mapping within the environment for a given symbol
-  bool check(Symbol x)
-  {
-    std::map<Symbol, EnvResult>::iterator it;
-
-    bool flag = false;
-
-    it = envmap.find(x);
-    if (it != envmap.end()) //if found, map is returned
-    {
-      flag = true;
-    }
+  bool check(const Symbol &x) const;
 
-    return flag;
-  }
+  // number of symbols with a mapping, builtins included
+  std::size_t size() const;
 
-  // returns the environment mapping for a given symbol
-  std::map<Symbol, EnvResult> search(Symbol x)
+  // calls f(symbol, expression) for every user mapping to an expression
+  template <typename F>
+  void foreachexp(F f) const
   {
-    std::map<Symbol, EnvResult>::iterator it;
-
-    it = envmap.find(x);
-    if (it != envmap.end()) //if found, map is returned
-    {
-      return envmap;
-    }
+    envmap.foreach([&](const Symbol &x, const EnvResult &result) {
+      if (result.type == ExpressionType)
+      {
+        f(x, result.exp);
+      }
+    });
   }
 
-  // returns the EnvResult (value) from an existing mapping in the environment for a given symbol (key)
-  EnvResult &operator[](const Symbol &x)
-  {
-    std::map<Symbol, EnvResult>::iterator it;
-
-    it = envmap.find(x);
-
-    return it->second;
-  }
+  // An O(1) copy of the mappings, without the pending transaction. Defines
+  // made in the snapshot or in this environment afterwards are not seen by
+  // the other one.
+  Environment snapshot() const;
 
-  // clears the 'envmap' Environment variable
+  // removes every user mapping, leaving the builtins
   void clearmap()
   {
     envmap.clear();
+    journal.clear();
   }
+
+  // Starts journaling the symbols inserted by insertexp and insertproc, so they
+  // can be undone by rollback. Mappings are never overwritten, so undoing an
+  // insertion is erasing its symbol, and a rollback costs only the changes made.
+  void begintransaction();
+
+  // keeps every mapping inserted since begintransaction
+  void commit();
+
+  // erases every mapping inserted since begintransaction
+  void rollback();
 };
 
 // List of functions that find the procedure to be performed on a given vector of Atom type arguments
@@ -134,4 +142,14 @@ Expression sin_proc(const std::vector<Atom> &args);
 Expression cos_proc(const std::vector<Atom> &args);
 Expression arctan_proc(const std::vector<Atom> &args);
 
+// The array procedures, which build NumberArrays and PointArrays and
+// transform whole PointArrays at once (see the README)
+Expression range_proc(const std::vector<Atom> &args);
+Expression pointsfromrange_proc(const std::vector<Atom> &args);
+Expression polyline_proc(const std::vector<Atom> &args);
+Expression polygon_proc(const std::vector<Atom> &args);
+Expression translate_proc(const std::vector<Atom> &args);
+Expression rotate_proc(const std::vector<Atom> &args);
+Expression scale_proc(const std::vector<Atom> &args);
+
 #endif
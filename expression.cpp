@@ -2,12 +2,239 @@
 
 // system includes
 #include <sstream>
+#include <cstdint>
+#include <cstring>
 #include <cmath>
 #include <limits>
 #include <cctype>
 #include <tuple>
 #include <iostream>
 
+namespace
+{
+// the storage of every empty list, never changed
+ExpressionList::Storage &nostorage()
+{
+  static ExpressionList::Storage empty;
+  return empty;
+}
+
+std::size_t combine(std::size_t seed, std::size_t hash)
+{
+  return seed ^ (hash + 0x9e3779b97f4a7c15ULL + (seed << 6) + (seed >> 2));
+}
+
+// Numbers are the same when their bits are: 0 and -0 differ (1 / 0 is not
+// 1 / -0) and a NaN is the same as itself, so caches and shared subtrees
+// never substitute one for the other
+bool samenumber(Number a, Number b)
+{
+  return std::memcmp(&a, &b, sizeof(Number)) == 0;
+}
+
+std::size_t numberhash(Number num)
+{
+  std::uint64_t bits;
+  std::memcpy(&bits, &num, sizeof(bits));
+  return std::hash<std::uint64_t>()(bits);
+}
+
+std::size_t pointhash(const Point &p)
+{
+  return combine(numberhash(p.x), numberhash(p.y));
+}
+
+bool samepoint(const Point &a, const Point &b)
+{
+  return samenumber(a.x, b.x) && samenumber(a.y, b.y);
+}
+
+bool samenumbers(const std::vector<Number> &a, const std::vector<Number> &b)
+{
+  return a.size() == b.size() && (a.empty() || std::memcmp(a.data(), b.data(), a.size() * sizeof(Number)) == 0);
+}
+
+bool samearray(const Array &a, const Array &b)
+{
+  if (a.path != b.path || a.size() != b.size())
+  {
+    return false;
+  }
+  if (a.data == b.data || a.size() == 0)
+  {
+    return true;
+  }
+  return samenumbers(a.data->x, b.data->x) && samenumbers(a.data->y, b.data->y);
+}
+
+std::size_t arrayhash(const Array &array)
+{
+  std::size_t hash = combine(std::hash<int>()(array.path), array.size());
+  for (std::size_t i = 0; i < array.size(); i++)
+  {
+    hash = combine(hash, numberhash(array.data->x[i]));
+  }
+  if (array.data)
+  {
+    for (Number y : array.data->y)
+    {
+      hash = combine(hash, numberhash(y));
+    }
+  }
+  return hash;
+}
+} // namespace
+
+ExpressionList::const_iterator ExpressionList::begin() const
+{
+  return items ? items->cbegin() : nostorage().cbegin();
+}
+
+ExpressionList::const_iterator ExpressionList::end() const
+{
+  return items ? items->cend() : nostorage().cend();
+}
+
+ExpressionList::iterator ExpressionList::begin()
+{
+  return items ? mutate().begin() : nostorage().begin();
+}
+
+ExpressionList::iterator ExpressionList::end()
+{
+  return items ? mutate().end() : nostorage().end();
+}
+
+void ExpressionList::push_back(const Expression &exp)
+{
+  mutate().push_back(exp);
+}
+
+void ExpressionList::push_back(Expression &&exp)
+{
+  mutate().push_back(std::move(exp));
+}
+
+void ExpressionList::resize(std::size_t n)
+{
+  if (n == 0)
+  {
+    items.reset();
+    return;
+  }
+  mutate().resize(n);
+}
+
+void ExpressionList::clear()
+{
+  items.reset();
+}
+
+ExpressionList::Storage &ExpressionList::mutate()
+{
+  if (!items)
+  {
+    items = std::make_shared<Storage>();
+  }
+  else if (items.use_count() > 1)
+  {
+    // the copy shares the storage of the subtrees, one level is copied at a time
+    items = std::make_shared<Storage>(*items);
+  }
+  return *items;
+}
+
+bool sameatom(const Atom &a, const Atom &b) noexcept
+{
+  if (a.type != b.type)
+  {
+    return false;
+  }
+  switch (a.type)
+  {
+  case BooleanType:
+    return a.value.bool_value == b.value.bool_value;
+  case NumberType:
+    return samenumber(a.value.num_value, b.value.num_value);
+  case NoneType:
+  case ListType:
+  case SymbolType:
+    return a.value.sym_value == b.value.sym_value;
+  case PointType:
+    return samepoint(a.value.point_value, b.value.point_value);
+  case LineType:
+    return samepoint(a.value.line_value.first, b.value.line_value.first) &&
+           samepoint(a.value.line_value.second, b.value.line_value.second);
+  case ArcType:
+    return samepoint(a.value.arc_value.center, b.value.arc_value.center) &&
+           samepoint(a.value.arc_value.start, b.value.arc_value.start) &&
+           samenumber(a.value.arc_value.span, b.value.arc_value.span);
+  case NumberArrayType:
+  case PointArrayType:
+    return samearray(a.value.array_value, b.value.array_value);
+  default:
+    return true;
+  }
+}
+
+std::size_t atomhash(const Atom &atom) noexcept
+{
+  std::size_t hash = std::hash<int>()(atom.type);
+  switch (atom.type)
+  {
+  case BooleanType:
+    return combine(hash, atom.value.bool_value);
+  case NumberType:
+    return combine(hash, numberhash(atom.value.num_value));
+  case NoneType:
+  case ListType:
+  case SymbolType:
+    return combine(hash, std::hash<std::string>()(atom.value.sym_value));
+  case PointType:
+    return combine(hash, pointhash(atom.value.point_value));
+  case LineType:
+    return combine(combine(hash, pointhash(atom.value.line_value.first)), pointhash(atom.value.line_value.second));
+  case ArcType:
+    hash = combine(combine(hash, pointhash(atom.value.arc_value.center)), pointhash(atom.value.arc_value.start));
+    return combine(hash, numberhash(atom.value.arc_value.span));
+  case NumberArrayType:
+  case PointArrayType:
+    return combine(hash, arrayhash(atom.value.array_value));
+  default:
+    return hash;
+  }
+}
+
+bool identical(const Expression &a, const Expression &b) noexcept
+{
+  if (!sameatom(a.head, b.head) || a.tail.size() != b.tail.size())
+  {
+    return false;
+  }
+  if (a.tail.shares(b.tail))
+  {
+    return true;
+  }
+  for (std::size_t i = 0; i < a.tail.size(); i++)
+  {
+    if (!identical(a.tail[i], b.tail[i]))
+    {
+      return false;
+    }
+  }
+  return true;
+}
+
+std::size_t std::hash<Expression>::operator()(const Expression &exp) const noexcept
+{
+  std::size_t hash = atomhash(exp.head);
+  for (const Expression &e : exp.tail)
+  {
+    hash = combine(hash, (*this)(e));
+  }
+  return hash;
+}
+
 Expression::Expression(bool tf)
 {
   // HEAD (Atom):
@@ -59,6 +286,51 @@ Expression::Expression(std::tuple<double, double> center,
   head.value.arc_value.span = angle;
 }
 
+Expression numberarray(std::vector<Number> values)
+{
+  std::shared_ptr<ArrayData> data = std::make_shared<ArrayData>();
+  data->x = std::move(values);
+
+  Expression exp;
+  exp.head.type = NumberArrayType;
+  exp.head.value.array_value.data = data;
+  exp.head.value.array_value.path = PathPoints;
+  return exp;
+}
+
+Expression pointarray(std::vector<Number> x, std::vector<Number> y, PathKind path)
+{
+  std::shared_ptr<ArrayData> data = std::make_shared<ArrayData>();
+  data->x = std::move(x);
+  data->y = std::move(y);
+
+  Expression exp;
+  exp.head.type = PointArrayType;
+  exp.head.value.array_value.data = data;
+  exp.head.value.array_value.path = path;
+  return exp;
+}
+
+std::string formatarray(const Atom &atom)
+{
+  const Array &array = atom.value.array_value;
+  std::ostringstream oss;
+  oss << "(";
+  for (std::size_t i = 0; i < array.size(); i++)
+  {
+    if (atom.type == PointArrayType)
+    {
+      oss << "(" << array.data->x[i] << "," << array.data->y[i] << ")";
+    }
+    else
+    {
+      oss << (i ? " " : "") << array.data->x[i];
+    }
+  }
+  oss << ")";
+  return oss.str();
+}
+
 bool Expression::operator==(const Expression &exp) const noexcept
 {
   bool flag = false;
@@ -112,6 +384,15 @@ bool Expression::operator==(const Expression &exp) const noexcept
         flag = true;
       }
       break;
+    case NumberArrayType:
+    case PointArrayType:
+      if (samearray(head.value.array_value, exp.head.value.array_value))
+      {
+        flag = true;
+      }
+      break;
+    default:
+      break;
     };
   }
   return flag;
@@ -170,6 +451,15 @@ bool Expression::operator!=(const Expression &exp) const noexcept
         flag = false;
       }
       break;
+    case NumberArrayType:
+    case PointArrayType:
+      if (samearray(head.value.array_value, exp.head.value.array_value))
+      {
+        flag = false;
+      }
+      break;
+    default:
+      break;
     };
   }
   return flag;
@@ -299,6 +589,14 @@ void checkfunctions(Atom &atom, std::string token, bool &is_none, bool &is_list,
       is_none = true;
       checkrest = false;
     }
+    else if (token == "range" || token == "points-from-range" || token == "polyline" || token == "polygon" ||
+             token == "translate" || token == "rotate" || token == "scale")
+    {
+      atom.type = NoneType;
+      atom.value.sym_value = token;
+      is_none = true;
+      checkrest = false;
+    }
   }
 }
 
@@ -307,7 +605,7 @@ void specialcases(Atom &atom, std::string token, bool &is_none, bool &is_list, b
   if (checkrest)
   {
     // Special forms/keywords:
-    if (token == "define" || token == "if" || token == "begin" || token == "draw")
+    if (token == "define" || token == "if" || token == "begin" || token == "draw" || token == "profile-report")
     {
       atom.type = ListType;
       atom.value.sym_value = token;
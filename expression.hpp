@@ -7,6 +7,8 @@
 #include <tuple>
 #include <cmath>
 #include <limits>
+#include <memory>
+#include <functional>
 
 // A Type is a literal boolean, literal number, or symbol
 enum Type
@@ -19,6 +21,8 @@ enum Type
   PointType,
   LineType,
   ArcType,
+  NumberArrayType,
+  PointArrayType,
   NullType
 };
 
@@ -62,6 +66,36 @@ struct Arc
   Number span;
 };
 
+// How a PointArray is drawn: as separate points, as an open polyline or as
+// a closed polygon
+enum PathKind
+{
+  PathPoints,
+  PathOpen,
+  PathClosed
+};
+
+// The elements of a NumberArray (x only) or a PointArray, stored as one
+// contiguous array per coordinate so the builtins loop over plain doubles
+struct ArrayData
+{
+  std::vector<Number> x;
+  std::vector<Number> y;
+};
+
+// An Array shares its immutable elements with its copies; null data is an
+// empty array
+struct Array
+{
+  std::shared_ptr<const ArrayData> data;
+  PathKind path;
+
+  std::size_t size() const
+  {
+    return data ? data->x.size() : 0;
+  }
+};
+
 // A Value is a boolean, number, or symbol
 // cannot use a union because symbol is non-POD
 // this wastes space but is simple
@@ -73,6 +107,7 @@ struct Value
   Point point_value;
   Line line_value;
   Arc arc_value;
+  Array array_value;
 };
 
 // An Atom has a type and value
@@ -82,13 +117,71 @@ struct Atom
   Value value;
 };
 
+struct Expression;
+
+// The tail of an Expression, a list of expressions whose storage is shared by
+// its copies and reference counted. The storage is immutable while shared:
+// the first change made through a copy gives that copy storage of its own
+// (copy-on-write), so copying an Expression is O(1) and identical subtrees can
+// be stored once (see hash_cons.hpp).
+class ExpressionList
+{
+public:
+  typedef std::vector<Expression> Storage;
+  typedef Storage::iterator iterator;
+  typedef Storage::const_iterator const_iterator;
+
+  std::size_t size() const;
+  bool empty() const;
+
+  const Expression &operator[](std::size_t i) const;
+  const_iterator begin() const;
+  const_iterator end() const;
+
+  // the non-const accessors unshare the storage, even if nothing is changed
+  Expression &operator[](std::size_t i);
+  iterator begin();
+  iterator end();
+
+  void push_back(const Expression &exp);
+  void push_back(Expression &&exp);
+  void resize(std::size_t n);
+  void clear();
+
+  // true if both lists use the same storage (so they are identical)
+  bool shares(const ExpressionList &list) const
+  {
+    return items == list.items;
+  }
+
+  // identifies the storage, null for an empty list
+  const void *storage() const
+  {
+    return items.get();
+  }
+
+private:
+  Storage &mutate();
+
+  std::shared_ptr<Storage> items; // null while empty
+};
+
 // An expression is an atom called the head
 // followed by a (possibly empty) list of expressions
 // called the tail
 struct Expression
 {
   Atom head;
-  std::vector<Expression> tail;
+  ExpressionList tail;
+
+  // set by the static type checker on builtin calls whose arguments are
+  // proven to have the arity and types the builtin accepts
+  bool checked = false;
+
+  // set by the parser on calls to + - * / and the comparisons whose arguments
+  // are numbers, symbols or such arithmetic calls, which the evaluator
+  // computes on doubles directly (see Interpreter::evaluatenumeric)
+  bool numeric = false;
 
   Expression()
   {
@@ -119,6 +212,57 @@ struct Expression
   bool operator!=(const Expression &exp) const noexcept;
 };
 
+inline std::size_t ExpressionList::size() const
+{
+  return items ? items->size() : 0;
+}
+
+inline bool ExpressionList::empty() const
+{
+  return !items || items->empty();
+}
+
+inline const Expression &ExpressionList::operator[](std::size_t i) const
+{
+  return (*items)[i];
+}
+
+inline Expression &ExpressionList::operator[](std::size_t i)
+{
+  return mutate()[i];
+}
+
+// true if a and b have identical heads and tails: the same types and exactly
+// the same values. operator== only compares the heads, numbers within epsilon.
+bool identical(const Expression &a, const Expression &b) noexcept;
+
+namespace std
+{
+// hashes the whole expression, consistently with identical
+template <>
+struct hash<Expression>
+{
+  std::size_t operator()(const Expression &exp) const noexcept;
+};
+} // namespace std
+
+// Construct an Expression with a single NumberArray atom of values
+Expression numberarray(std::vector<Number> values);
+
+// Construct an Expression with a single PointArray atom of the points
+// (x[i], y[i]), x and y of the same size, drawn as path
+Expression pointarray(std::vector<Number> x, std::vector<Number> y, PathKind path);
+
+// formats a NumberArray as (1 2 3) and a PointArray as ((0,0)(1,1))
+std::string formatarray(const Atom &atom);
+
+// hashes an atom, consistently with identical
+std::size_t atomhash(const Atom &atom) noexcept;
+
+// true if a and b have the same type and exactly the same value, numbers
+// compared by their bits (so 0 and -0 differ and a NaN is the same as itself)
+bool sameatom(const Atom &a, const Atom &b) noexcept;
+
 // A Procedure is a C++ function pointer taking
 // a vector of Atoms as arguments
 typedef Expression (*Procedure)(const std::vector<Atom> &args);
@@ -0,0 +1,169 @@
+#include "graphics_sink.hpp"
+
+// system includes
+#include <cmath>
+
+// module includes
+#include "arc_geometry.hpp"
+
+// radius used to render a point, matching sldraw
+#define SVG_POINT_RADIUS 2
+
+void GraphicsSink::draw(const Atom &atom)
+{
+  if (atom.type == PointType)
+  {
+    point(atom.value.point_value);
+  }
+  else if (atom.type == LineType)
+  {
+    line(atom.value.line_value);
+  }
+  else if (atom.type == ArcType)
+  {
+    arc(atom.value.arc_value);
+  }
+  else if (atom.type == PointArrayType && atom.value.array_value.size() > 0)
+  {
+    const Array &array = atom.value.array_value;
+    if (array.path == PathPoints)
+    {
+      for (std::size_t i = 0; i < array.size(); i++)
+      {
+        point(Point{array.data->x[i], array.data->y[i]});
+      }
+    }
+    else
+    {
+      polyline(array.data->x.data(), array.data->y.data(), array.size(), array.path == PathClosed);
+    }
+  }
+}
+
+std::size_t drawnprimitives(const Atom &atom)
+{
+  if (atom.type == PointType || atom.type == LineType || atom.type == ArcType)
+  {
+    return 1;
+  }
+  if (atom.type == PointArrayType && atom.value.array_value.size() > 0)
+  {
+    return atom.value.array_value.path == PathPoints ? atom.value.array_value.size() : 1;
+  }
+  return 0;
+}
+
+void GraphicsSink::polyline(const Number *x, const Number *y, std::size_t n, bool closed)
+{
+  for (std::size_t i = 1; i < n; i++)
+  {
+    line(Line{Point{x[i - 1], y[i - 1]}, Point{x[i], y[i]}});
+  }
+  // a closed path of two points would draw its only segment twice
+  if (closed && n > 2)
+  {
+    line(Line{Point{x[n - 1], y[n - 1]}, Point{x[0], y[0]}});
+  }
+}
+
+void VectorGraphicsSink::draw(const Atom &atom)
+{
+  // every drawn atom is kept, as getGraphicsatoms always returned them
+  graphics.push_back(atom);
+}
+
+void VectorGraphicsSink::point(const Point &p)
+{
+  graphics.push_back(Expression(std::make_tuple(p.x, p.y)).head);
+}
+
+void VectorGraphicsSink::line(const Line &l)
+{
+  graphics.push_back(Expression(std::make_tuple(l.first.x, l.first.y),
+                                std::make_tuple(l.second.x, l.second.y))
+                         .head);
+}
+
+void VectorGraphicsSink::arc(const Arc &a)
+{
+  graphics.push_back(Expression(std::make_tuple(a.center.x, a.center.y),
+                                std::make_tuple(a.start.x, a.start.y),
+                                a.span)
+                         .head);
+}
+
+void VectorGraphicsSink::commit()
+{
+  committed = graphics.size();
+}
+
+void VectorGraphicsSink::discard()
+{
+  // drop the atoms drawn by the failed evaluation
+  graphics.resize(committed);
+}
+
+SvgGraphicsSink::SvgGraphicsSink(std::ostream &out) : out(out), finished(false)
+{
+  // the drawing is not bounded up front, so nothing drawn at negative coordinates is clipped
+  out << "<svg xmlns=\"http://www.w3.org/2000/svg\" overflow=\"visible\">\n";
+}
+
+SvgGraphicsSink::~SvgGraphicsSink()
+{
+  finish();
+}
+
+void SvgGraphicsSink::finish()
+{
+  if (!finished)
+  {
+    out << "</svg>\n";
+    out.flush();
+    finished = true;
+  }
+}
+
+void SvgGraphicsSink::point(const Point &p)
+{
+  out << "<circle cx=\"" << p.x << "\" cy=\"" << p.y << "\" r=\"" << SVG_POINT_RADIUS << "\" fill=\"black\"/>\n";
+}
+
+void SvgGraphicsSink::line(const Line &l)
+{
+  out << "<line x1=\"" << l.first.x << "\" y1=\"" << l.first.y << "\" x2=\"" << l.second.x << "\" y2=\"" << l.second.y << "\" stroke=\"black\"/>\n";
+}
+
+void SvgGraphicsSink::polyline(const Number *x, const Number *y, std::size_t n, bool closed)
+{
+  out << (closed ? "<polygon" : "<polyline") << " points=\"";
+  for (std::size_t i = 0; i < n; i++)
+  {
+    out << (i ? " " : "") << x[i] << "," << y[i];
+  }
+  out << "\" fill=\"none\" stroke=\"black\"/>\n";
+}
+
+void SvgGraphicsSink::arc(const Arc &a)
+{
+  ArcGeometry g = arcgeometry(a);
+
+  // A positive span runs counter-clockwise on screen (as in sldraw), which in the
+  // y-down SVG coordinate system decreases the angle, i.e. sweep-flag 0.
+  // SVG arcs cannot describe a full circle, so the span is split into quarter turns.
+  int segments = static_cast<int>(std::ceil(std::fabs(a.span) / (std::atan2(0, -1) / 2)));
+  if (segments == 0)
+  {
+    return;
+  }
+
+  int sweep = (a.span > 0) ? 0 : 1;
+
+  out << "<path d=\"M " << a.start.x << " " << a.start.y;
+  for (int i = 1; i <= segments; i++)
+  {
+    Point end = arcpoint(g, static_cast<double>(i) / segments);
+    out << " A " << g.radius << " " << g.radius << " 0 0 " << sweep << " " << end.x << " " << end.y;
+  }
+  out << "\" fill=\"none\" stroke=\"black\"/>\n";
+}
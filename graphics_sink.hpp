@@ -0,0 +1,103 @@
+#ifndef GRAPHICS_SINK_HPP
+#define GRAPHICS_SINK_HPP
+
+// system includes
+#include <ostream>
+#include <vector>
+
+// module includes
+#include "expression.hpp"
+
+// A GraphicsSink receives every graphical Atom as soon as a draw
+// special form evaluates it, so drawn primitives are streamed to
+// their destination instead of being accumulated by the Interpreter
+class GraphicsSink
+{
+public:
+  virtual ~GraphicsSink(){};
+
+  // dispatches a drawn atom to point, line or arc, and a PointArray to point
+  // for each of its points or to polyline (other types are ignored)
+  virtual void draw(const Atom &atom);
+
+  // called for each drawn primitive, in evaluation order
+  virtual void point(const Point &p) = 0;
+  virtual void line(const Line &l) = 0;
+  virtual void arc(const Arc &a) = 0;
+
+  // called for a PointArray drawn as a path, the points (x[i], y[i]) for
+  // i < n joined in order, and the last one to the first if closed. Draws
+  // a line per segment unless the sink can draw the path as one primitive.
+  virtual void polyline(const Number *x, const Number *y, std::size_t n, bool closed);
+
+  // called by Interpreter::eval once the evaluation has succeeded
+  virtual void commit(){};
+
+  // called by Interpreter::eval when the evaluation raised a semantic error,
+  // sinks that buffer per evaluation should drop what was drawn since the last commit
+  virtual void discard(){};
+};
+
+// number of primitives draw dispatches atom to: one for a point, a line, an
+// arc or a path, and one for each point of a PointArray drawn as points
+std::size_t drawnprimitives(const Atom &atom);
+
+// In-memory sink that keeps every drawn atom (the default sink of an Interpreter)
+class VectorGraphicsSink : public GraphicsSink
+{
+public:
+  void draw(const Atom &atom);
+
+  void point(const Point &p);
+  void line(const Line &l);
+  void arc(const Arc &a);
+
+  void commit();
+  void discard();
+
+  // returns the atoms drawn so far
+  const std::vector<Atom> &atoms() const
+  {
+    return graphics;
+  }
+
+  void clear()
+  {
+    graphics.clear();
+    committed = 0;
+  }
+
+private:
+  std::vector<Atom> graphics;
+
+  // number of atoms that belong to successful evaluations
+  std::size_t committed = 0;
+};
+
+// Streams every drawn primitive as an SVG element to an output stream,
+// using the same conventions (point radius, arc orientation) as sldraw
+class SvgGraphicsSink : public GraphicsSink
+{
+public:
+  // writes the opening svg tag
+  SvgGraphicsSink(std::ostream &out);
+
+  // writes the closing svg tag, unless finish was already called
+  ~SvgGraphicsSink();
+
+  void point(const Point &p);
+  void line(const Line &l);
+  void arc(const Arc &a);
+
+  // writes a polyline or polygon element
+  void polyline(const Number *x, const Number *y, std::size_t n, bool closed);
+
+  // writes the closing svg tag
+  void finish();
+
+private:
+  std::ostream &out;
+  bool finished;
+};
+
+#endif
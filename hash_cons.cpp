@@ -0,0 +1,64 @@
+#include "hash_cons.hpp"
+
+Expression HashConsTable::intern(Expression exp)
+{
+  if (exp.tail.empty()) // a leaf is only its head, there is nothing to share
+  {
+    return exp;
+  }
+
+  auto inserted = table.insert(exp);
+  if (!inserted.second)
+  {
+    hits++;
+  }
+  return *inserted.first;
+}
+
+Expression HashConsTable::internall(const Expression &exp)
+{
+  if (exp.tail.empty())
+  {
+    return exp;
+  }
+
+  Expression interned;
+  interned.head = exp.head;
+  interned.checked = exp.checked;
+  interned.numeric = exp.numeric;
+  for (const Expression &e : exp.tail)
+  {
+    interned.tail.push_back(internall(e));
+  }
+  return intern(std::move(interned));
+}
+
+std::size_t HashConsTable::ShallowHash::operator()(const Expression &exp) const noexcept
+{
+  std::size_t hash = atomhash(exp.head);
+  for (const Expression &e : exp.tail)
+  {
+    hash = hash * 31 + atomhash(e.head);
+    hash = hash * 31 + std::hash<const void *>()(e.tail.storage());
+  }
+  return hash;
+}
+
+bool HashConsTable::ShallowEqual::operator()(const Expression &a, const Expression &b) const noexcept
+{
+  if (!sameatom(a.head, b.head) || a.checked != b.checked || a.numeric != b.numeric || a.tail.size() != b.tail.size())
+  {
+    return false;
+  }
+  for (std::size_t i = 0; i < a.tail.size(); i++)
+  {
+    // interned children are identical exactly when they share their storage
+    const Expression &x = a.tail[i];
+    const Expression &y = b.tail[i];
+    if (!sameatom(x.head, y.head) || x.checked != y.checked || x.numeric != y.numeric || !x.tail.shares(y.tail))
+    {
+      return false;
+    }
+  }
+  return true;
+}
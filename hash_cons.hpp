@@ -0,0 +1,65 @@
+#ifndef HASH_CONS_HPP
+#define HASH_CONS_HPP
+
+// system includes
+#include <cstddef>
+#include <cstdint>
+#include <unordered_set>
+
+// module includes
+#include "expression.hpp"
+
+// A hash-consing table: the identical expressions interned in the same table
+// share the storage of their tails, so a subtree repeated throughout a program
+// is stored once.
+//
+// Expressions are interned bottom up, by the parser, so the tails of identical
+// children already share their storage. Comparing and hashing an expression
+// then only looks at its head and the heads and storage of its children,
+// instead of whole subtrees. The checked and numeric flags are compared too,
+// as identical subtrees may be checked in one place and not in another.
+class HashConsTable
+{
+public:
+  // returns exp, or the identical expression interned before, sharing its tail
+  // (the expressions in exp's tail must have been interned)
+  Expression intern(Expression exp);
+
+  // interns exp and every subtree of it, bottom up, for a tree built or
+  // changed without the table (such as the result of the optimization passes)
+  Expression internall(const Expression &exp);
+
+  // number of distinct expressions interned
+  std::size_t size() const
+  {
+    return table.size();
+  }
+
+  // number of interned expressions that were replaced by an identical one
+  std::uint64_t shared() const
+  {
+    return hits;
+  }
+
+  void clear()
+  {
+    table.clear();
+    hits = 0;
+  }
+
+private:
+  struct ShallowHash
+  {
+    std::size_t operator()(const Expression &exp) const noexcept;
+  };
+
+  struct ShallowEqual
+  {
+    bool operator()(const Expression &a, const Expression &b) const noexcept;
+  };
+
+  std::unordered_set<Expression, ShallowHash, ShallowEqual> table;
+  std::uint64_t hits = 0;
+};
+
+#endif
@@ -1,28 +1,53 @@
 #include "interpreter.hpp"
 
 // system includes
+#include <algorithm>
+#include <chrono>
 #include <stack>
 #include <stdexcept>
 #include <iostream>
 
 // module includes
+#include "checkpoint.hpp"
 #include "tokenize.hpp"
 #include "expression.hpp"
 #include "environment.hpp"
 #include "interpreter_semantic_error.hpp"
+#include "optimizer.hpp"
+#include "simd_kernels.hpp"
+#include "trace.hpp"
 
 Interpreter::Interpreter(){};
 
 bool Interpreter::parse(std::istream &expression) noexcept
 {
   // Parse and Tokenize the passed expression
-  TokenSequenceType listOfTokens = tokenize(expression);
+  TokenSequenceType listOfTokens;
+  {
+    TraceScope trace("tokenize", "parse");
+    PhaseTimer timer(statsenabled ? &stats.tokenize : nullptr);
+    listOfTokens = tokenize(expression);
+  }
+
+  if (statsenabled)
+  {
+    stats.tokens += listOfTokens.size();
+  }
 
   try
   {
     // Build the AST
+    TraceScope trace("read_from_tokens", "parse");
+    PhaseTimer timer(statsenabled ? &stats.read : nullptr);
+    checkerror.clear();
     ast = read_from_tokens(listOfTokens);
 
+    if (statsenabled)
+    {
+      stats.shared += hashcons.shared();
+    }
+    hashcons.clear();
+
     if (!listOfTokens.empty()) //throw an error in case of extra input tokens
     {
       throw std::invalid_argument("Error. The expression has excess tokens!");
@@ -30,12 +55,71 @@ bool Interpreter::parse(std::istream &expression) noexcept
   }
   catch (const std::invalid_argument &e)
   {
+    hashcons.clear();
     return false;
   }
 
+  if (optlevel >= 1)
+  {
+    optimize();
+  }
+
   return true;
 };
 
+// fewest arguments of a + or * reduced with a SIMD kernel, when vectorizing
+#define VECTORIZE_MIN_ARGUMENTS 32
+
+namespace
+{
+// the arithmetic and comparison operators of the numeric fast path
+bool isarithmetic(const Symbol &op)
+{
+  return op == "+" || op == "-" || op == "*" || op == "/";
+}
+
+bool iscomparison(const Symbol &op)
+{
+  return op == "<" || op == "<=" || op == ">" || op == ">=" || op == "=";
+}
+
+// true if exp can be an operand of the numeric fast path
+bool isnumericoperand(const Expression &exp)
+{
+  if (exp.tail.empty())
+  {
+    return exp.head.type == NumberType || exp.head.type == SymbolType;
+  }
+  return exp.numeric && isarithmetic(exp.head.value.sym_value);
+}
+
+// true if exp is a well-formed call of the numeric fast path, whose operands
+// have already been marked
+bool isnumeric(const Expression &exp)
+{
+  const Symbol &op = exp.head.value.sym_value;
+  std::size_t arguments = exp.tail.size() - 1;
+  if ((exp.head.type != ListType && exp.head.type != NoneType) || exp.tail[0].head.value.sym_value != op ||
+      !exp.tail[0].tail.empty())
+  {
+    return false;
+  }
+  if (!((op == "+" || op == "*") ? arguments >= 2 : op == "-" ? arguments == 1 || arguments == 2
+                                                   : (op == "/" || iscomparison(op)) && arguments == 2))
+  {
+    return false;
+  }
+  for (std::size_t i = 1; i < exp.tail.size(); i++)
+  {
+    if (!isnumericoperand(exp.tail[i]))
+    {
+      return false;
+    }
+  }
+  return true;
+}
+} // namespace
+
 Expression Interpreter::read_from_tokens(TokenSequenceType &listOfTokens)
 {
   if (listOfTokens.empty()) // throw an error if the list of tokens are empty
@@ -48,6 +132,11 @@ Expression Interpreter::read_from_tokens(TokenSequenceType &listOfTokens)
     throw std::invalid_argument("Error. No matching parenthesis at the end.");
   }
 
+  if (statsenabled)
+  {
+    stats.astnodes++;
+  }
+
   Atom atom;
   std::string token = listOfTokens[0];
 
@@ -63,13 +152,17 @@ Expression Interpreter::read_from_tokens(TokenSequenceType &listOfTokens)
 
     bool emptyexp = true; // flag that ensures empty expressions such as () are not valid
 
-    while (listOfTokens[0] != ")")
+    while (!listOfTokens.empty() && listOfTokens[0] != ")")
     {
       emptyexp = false;
-      Expression x;
-      x = read_from_tokens(listOfTokens);
 
-      exp.tail.push_back(x);
+      // the subtree is moved into place, copying it would cost its size at every level
+      exp.tail.push_back(read_from_tokens(listOfTokens));
+    }
+
+    if (listOfTokens.empty()) // the tokens ran out before the closing parenthesis
+    {
+      throw std::invalid_argument("Error. No matching parenthesis at the end.");
     }
 
     if (emptyexp) // required for examples such as: "()"
@@ -77,9 +170,11 @@ Expression Interpreter::read_from_tokens(TokenSequenceType &listOfTokens)
       throw std::invalid_argument("Error due to empty expression.");
     }
 
-    if (!listOfTokens.empty())
+    listOfTokens.pop_front(); // pop the ) token as it has been encountered
+    exp.numeric = isnumeric(exp);
+    if (hashconsing)
     {
-      listOfTokens.pop_front(); // pop the ) token as it has been encountered
+      return hashcons.intern(std::move(exp));
     }
     return exp;
   }
@@ -97,6 +192,41 @@ Expression Interpreter::read_from_tokens(TokenSequenceType &listOfTokens)
   throw std::invalid_argument("Error. Invalid Case");
 }
 
+void Interpreter::optimize()
+{
+  TraceScope trace("optimize", "parse");
+  PhaseTimer timer(statsenabled ? &stats.optimize : nullptr);
+
+  std::uint64_t folded = foldconstants(ast);
+  std::uint64_t eliminated = 0;
+  if (optlevel >= 3)
+  {
+    eliminated = eliminatebranches(ast, folded);
+  }
+
+  // typecheck runs last, on the simplest AST
+  std::uint64_t checked = 0;
+  if (optlevel >= 2)
+  {
+    checked = typecheck(ast, checkerror);
+  }
+
+  // the passes gave every node they visited a tail of its own, the identical
+  // subtrees are shared again
+  if (hashconsing)
+  {
+    ast = hashcons.internall(ast);
+    hashcons.clear();
+  }
+
+  if (statsenabled)
+  {
+    stats.folded += folded;
+    stats.checked += checked;
+    stats.eliminated += eliminated;
+  }
+}
+
 Expression Interpreter::eval()
 {
   // TODO: implement this function
@@ -104,13 +234,94 @@ Expression Interpreter::eval()
   Environment *envp = &env;
   Expression evaluated_exp;
 
-  evaluated_exp = evaluate(ast, envp); // finds out the evaluation of the formed AST
+  // each evaluation is a transaction: the defines of a failed one are undone
+  env.begintransaction();
+
+  try
+  {
+    TraceScope trace("eval", "form");
+    PhaseTimer timer(statsenabled ? &stats.eval : nullptr);
+    depth = 0;
+    numericfailures.clear(); // left over by a failed evaluation
+    if (!checkerror.empty()) // found by typecheck, before any work is done
+    {
+      throw InterpreterSemanticError(checkerror);
+    }
+    evaluated_exp = evaluate(ast, envp); // finds out the evaluation of the formed AST
+  }
+  catch (const InterpreterSemanticError &e)
+  {
+    env.rollback();
+    graphicsSink()->discard(); // nothing drawn by a failed evaluation is kept
+    if (statsenabled)
+    {
+      stats.envsize = env.size();
+    }
+    throw;
+  }
+
+  env.commit();
+  graphicsSink()->commit();
+  if (statsenabled)
+  {
+    stats.envsize = env.size();
+  }
 
   return evaluated_exp;
 }
 
-Expression Interpreter::evaluate(Expression ast, Environment *environ)
+namespace
 {
+// Tracks the recursion depth of evaluate, when given a depth counter
+struct DepthGuard
+{
+  DepthGuard(unsigned *depth, unsigned &maxdepth) : depth(depth)
+  {
+    if (depth != nullptr && ++*depth > maxdepth)
+    {
+      maxdepth = *depth;
+    }
+  }
+
+  ~DepthGuard()
+  {
+    if (depth != nullptr)
+    {
+      --*depth;
+    }
+  }
+
+  unsigned *depth;
+};
+} // namespace
+
+Expression Interpreter::evaluate(const Expression &ast, Environment *environ)
+{
+  DepthGuard guard(statsenabled ? &depth : nullptr, stats.maxdepth);
+
+  // the profile and the trace record every builtin call, so profiling and
+  // tracing take the usual path
+  if (ast.numeric && !profiling && !tracing())
+  {
+    if (!numericfailures.empty() && numericfailures.back() == &ast)
+    {
+      // an operand of the call whose fast path just failed
+      numericfailures.pop_back();
+    }
+    else
+    {
+      Expression result;
+      if (evaluatenumeric(ast, environ, result))
+      {
+        stats.numeric += statsenabled;
+        return result;
+      }
+      if (!numericfailures.empty() && numericfailures.back() == &ast)
+      {
+        numericfailures.pop_back();
+      }
+    }
+  }
 
   Expression exp = evaluateothertypes(ast, environ);
 
@@ -141,10 +352,28 @@ Expression Interpreter::evaluate(Expression ast, Environment *environ)
     evaluate(ast.tail[0], environ); //recursive call to reach the leftmost leaf nodes
   }
 
+  // + * and or take their arguments one at a time, see Reducer; with fewer
+  // than 2 arguments the procedure raises its arity error as usual
+  if (ast.tail.size() >= 3 && ast.tail[0].tail.empty())
+  {
+    const Reducer *reducer = Environment::reducer(ast.tail[0].head.value.sym_value);
+    if (reducer != nullptr)
+    {
+      return reduce(*reducer, ast, environ);
+    }
+  }
+
   // Evaluating a tail of expressions:
 
   std::vector<Atom> args;
 
+  // the inclusive time of a builtin call starts with the evaluation of its arguments
+  std::chrono::steady_clock::time_point start;
+  if (profiling)
+  {
+    start = std::chrono::steady_clock::now();
+  }
+
   // args is a vector of arguments that stores the result of
   // evaluating all the tail members of an expression within the AST.
 
@@ -158,62 +387,263 @@ Expression Interpreter::evaluate(Expression ast, Environment *environ)
 
   if (!args.empty())
   {
-    return environ->searchProc(args[0].value.sym_value)(args);
+    // builtin calls are the most frequent events, they are sampled
+    TraceScope trace(args[0].value.sym_value, "builtin", true);
+    // the checks of a call proven well-typed are skipped
+    Procedure proc = ast.checked ? Environment::uncheckedproc(args[0].value.sym_value)
+                                 : environ->searchProc(args[0].value.sym_value);
+    if (!profiling)
+    {
+      return call(proc, args);
+    }
+
+    Expression result = call(proc, args);
+    profile.call(args[0].value.sym_value, args.size() - 1,
+                 std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count());
+    return result;
   }
 
   return ast;
 }
 
+Expression Interpreter::reduce(const Reducer &reducer, const Expression &ast, Environment *environ)
+{
+  const Symbol &name = ast.tail[0].head.value.sym_value;
+
+  std::chrono::steady_clock::time_point start;
+  if (profiling)
+  {
+    start = std::chrono::steady_clock::now();
+  }
+  TraceScope trace(name, "builtin", true);
+
+  Expression accumulator = reducer.start();
+  std::size_t i = 1;
+  while (i < ast.tail.size() && reducer.step(accumulator, evaluate(ast.tail[i], environ).head))
+  {
+    i++;
+  }
+
+  if (profiling)
+  {
+    // the arguments evaluated, all of them unless and or or stopped early
+    profile.call(name, std::min(i, ast.tail.size() - 1),
+                 std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count());
+  }
+  return accumulator;
+}
+
+bool Interpreter::evaluatenumeric(const Expression &ast, Environment *environ, Expression &result)
+{
+  const Symbol &op = ast.head.value.sym_value;
+  if (!iscomparison(op))
+  {
+    result.head.type = NumberType;
+    return evaluatenumber(ast, environ, result.head.value.num_value);
+  }
+
+  double x, y;
+  if (!evaluatenumber(ast.tail[1], environ, x) || !evaluatenumber(ast.tail[2], environ, y))
+  {
+    return false;
+  }
+  result.head.type = BooleanType;
+  if (op == "<")
+  {
+    result.head.value.bool_value = x < y;
+  }
+  else if (op == "<=")
+  {
+    result.head.value.bool_value = x <= y;
+  }
+  else if (op == ">")
+  {
+    result.head.value.bool_value = x > y;
+  }
+  else if (op == ">=")
+  {
+    result.head.value.bool_value = x >= y;
+  }
+  else
+  {
+    result.head.value.bool_value = x == y;
+  }
+  return true;
+}
+
+bool Interpreter::evaluatenumber(const Expression &ast, Environment *environ, double &value)
+{
+  if (ast.tail.empty())
+  {
+    if (ast.head.type == NumberType)
+    {
+      value = ast.head.value.num_value;
+      return true;
+    }
+    if (ast.head.type != SymbolType || !env.check(ast.head.value.sym_value))
+    {
+      return false;
+    }
+    Expression symbol = environ->searchExp(ast.head.value.sym_value);
+    value = symbol.head.value.num_value;
+    return symbol.head.type == NumberType;
+  }
+
+  if (evaluatearithmetic(ast, environ, value))
+  {
+    return true;
+  }
+  numericfailures.push_back(&ast);
+  return false;
+}
+
+bool Interpreter::evaluatearithmetic(const Expression &ast, Environment *environ, double &value)
+{
+  // the operands are combined in the order, and from the same initial
+  // values, as add_proc, sub_proc, mul_proc and div_proc do, so the results
+  // are bit-identical
+  const Symbol &op = ast.head.value.sym_value;
+  if (!ast.numeric || op.size() != 1)
+  {
+    return false;
+  }
+
+  double x, y;
+  if (vectorize && ast.tail.size() > VECTORIZE_MIN_ARGUMENTS && (op[0] == '+' || op[0] == '*'))
+  {
+    // the arguments of nested wide calls are stacked after these
+    std::size_t first = operands.size(), count = ast.tail.size() - 1;
+    operands.resize(first + count);
+    for (std::size_t i = 0; i < count; i++)
+    {
+      const Expression &argument = ast.tail[i + 1];
+      if (argument.tail.empty() && argument.head.type == NumberType)
+      {
+        x = argument.head.value.num_value;
+      }
+      else if (!evaluatenumber(argument, environ, x))
+      {
+        operands.resize(first);
+        return false;
+      }
+      operands[first + i] = x;
+    }
+    value = op[0] == '+' ? pairwisesum(&operands[first], count) : pairwiseproduct(&operands[first], count);
+    operands.resize(first);
+    return true;
+  }
+
+  switch (op[0])
+  {
+  case '+':
+    value = 0;
+    for (std::size_t i = 1; i < ast.tail.size(); i++)
+    {
+      if (!evaluatenumber(ast.tail[i], environ, x))
+      {
+        return false;
+      }
+      value = value + x;
+    }
+    return true;
+  case '*':
+    value = 1;
+    for (std::size_t i = 1; i < ast.tail.size(); i++)
+    {
+      if (!evaluatenumber(ast.tail[i], environ, x))
+      {
+        return false;
+      }
+      value = value * x;
+    }
+    return true;
+  case '-':
+    if (!evaluatenumber(ast.tail[1], environ, x))
+    {
+      return false;
+    }
+    if (ast.tail.size() == 2)
+    {
+      value = 0 - x;
+      return true;
+    }
+    if (!evaluatenumber(ast.tail[2], environ, y))
+    {
+      return false;
+    }
+    value = x - y;
+    return true;
+  case '/':
+    if (!evaluatenumber(ast.tail[1], environ, x) || !evaluatenumber(ast.tail[2], environ, y))
+    {
+      return false;
+    }
+    value = x / y;
+    return true;
+  default:
+    return false;
+  }
+}
+
+Expression Interpreter::call(Procedure proc, const std::vector<Atom> &args)
+{
+  if (memo.capacity() == 0 || !Environment::memoizable(proc))
+  {
+    return proc(args);
+  }
+
+  std::uint64_t evictions = memo.evictions();
+  const Expression *cached = memo.find(proc, args);
+  if (cached != nullptr)
+  {
+    stats.memohits += statsenabled;
+    return *cached;
+  }
+
+  // a call raising an error is not cached
+  Expression result = proc(args);
+  memo.insert(proc, args, result);
+  if (statsenabled)
+  {
+    stats.memomisses++;
+    stats.memoevictions += memo.evictions() - evictions;
+  }
+  return result;
+}
+
+Interpreter Interpreter::fork() const
+{
+  Interpreter forked;
+  forked.env = env.snapshot();
+  return forked;
+}
+
+bool Interpreter::saveState(const std::string &path) const
+{
+  return writecheckpoint(env, path);
+}
+
+bool Interpreter::loadState(const std::string &path)
+{
+  return readcheckpoint(path, env);
+}
+
 void Interpreter::resetenv()
 {
-  env.clearmap(); //cleared the map
-
-  Environment default_env;
-
-  // env = default_env;
-  // could have also done this ^^^, but I just re-inserted the mappings for the default environment once again.
-
-  // Special Expressions:
-
-  env.insertexp("define", default_env.operator[]("define").exp);
-  env.insertexp("begin", default_env.operator[]("begin").exp);
-  env.insertexp("if", default_env.operator[]("if").exp);
-  env.insertexp("draw", default_env.operator[]("draw").exp);
-
-  // All the Procedures:
-
-  env.insertproc("not", default_env.operator[]("not").proc);
-  env.insertproc("and", default_env.operator[]("and").proc);
-  env.insertproc("or", default_env.operator[]("or").proc);
-  env.insertproc("<", default_env.operator[]("<").proc);
-  env.insertproc("<=", default_env.operator[]("<=").proc);
-  env.insertproc(">", default_env.operator[](">").proc);
-  env.insertproc(">=", default_env.operator[](">=").proc);
-  env.insertproc("=", default_env.operator[]("=").proc);
-  env.insertproc("+", default_env.operator[]("+").proc);
-  env.insertproc("-", default_env.operator[]("-").proc);
-  env.insertproc("*", default_env.operator[]("*").proc);
-  env.insertproc("/", default_env.operator[]("/").proc);
-  env.insertproc("log10", default_env.operator[]("log10").proc);
-  env.insertproc("pow", default_env.operator[]("pow").proc);
-  env.insertproc("point", default_env.operator[]("point").proc);
-  env.insertproc("line", default_env.operator[]("line").proc);
-  env.insertproc("arc", default_env.operator[]("arc").proc);
-  env.insertproc("sin", default_env.operator[]("sin").proc);
-  env.insertproc("cos", default_env.operator[]("cos").proc);
-  env.insertproc("arctan", default_env.operator[]("arctan").proc);
-
-  // PI:
-
-  env.insertexp("pi", default_env.operator[]("pi").exp);
+  // the builtins are shared by every environment, only the user mappings are cleared
+  env.clearmap();
 }
 
-Expression Interpreter::evaluateothertypes(Expression ast, Environment *environ)
+Expression Interpreter::evaluateothertypes(const Expression &ast, Environment *environ)
 {
   if (ast.head.type == SymbolType)
   {
     if (env.check(ast.head.value.sym_value)) // if the environment symbol exists, find the mapping
     {
+      if (profiling)
+      {
+        profile.lookup(ast.head.value.sym_value);
+      }
       return environ->searchExp(ast.head.value.sym_value);
     }
   }
@@ -237,13 +667,25 @@ Expression Interpreter::evaluateothertypes(Expression ast, Environment *environ)
   {
     return ast;
   }
+  if (ast.head.type == NumberArrayType || ast.head.type == PointArrayType)
+  {
+    return ast;
+  }
 
   Expression exp;
   return exp;
 }
 
-Expression Interpreter::evaluatebegin(Expression ast, Environment *environ)
+Expression Interpreter::evaluatebegin(const Expression &ast, Environment *environ)
 {
+  TraceScope trace("begin", "special form");
+
+  // must be an m-ary expression
+  if (ast.tail.size() < 2)
+  {
+    throw InterpreterSemanticError("Error (semantic). begin is m-ary. 0 arguments are not allowed.");
+  }
+
   // All expressions but the last one must be evaluated first.
   for (int i = 1; i < ast.tail.size() - 1; i++)
   {
@@ -254,8 +696,10 @@ Expression Interpreter::evaluatebegin(Expression ast, Environment *environ)
   return evaluate(ast.tail[ast.tail.size() - 1], environ);
 }
 
-Expression Interpreter::evaluatedefine(Expression ast, Environment *environ)
+Expression Interpreter::evaluatedefine(const Expression &ast, Environment *environ)
 {
+  TraceScope trace("define", "special form");
+
   if (ast.tail.size() != 3)
   {
     throw InterpreterSemanticError("Error (semantic). 'if' is ternary. Only 3 arguments are required");
@@ -284,8 +728,10 @@ Expression Interpreter::evaluatedefine(Expression ast, Environment *environ)
   return result;
 }
 
-Expression Interpreter::evaluateif(Expression ast, Environment *environ)
+Expression Interpreter::evaluateif(const Expression &ast, Environment *environ)
 {
+  TraceScope trace("if", "special form");
+
   if (ast.tail.size() != 4)
   {
     throw InterpreterSemanticError("Error (semantic). if is quad-ary. Only 4 arguments are required");
@@ -313,8 +759,9 @@ Expression Interpreter::evaluateif(Expression ast, Environment *environ)
   throw InterpreterSemanticError("Error (semantic). Expression 1 must be a Boolean type");
 }
 
-Expression Interpreter::evaluatedraw(Expression ast, Environment *environ)
+Expression Interpreter::evaluatedraw(const Expression &ast, Environment *environ)
 {
+  TraceScope trace("draw", "special form");
 
   // must be an m-ary expression
   if (ast.tail.size() < 2)
@@ -322,10 +769,15 @@ Expression Interpreter::evaluatedraw(Expression ast, Environment *environ)
     throw InterpreterSemanticError("Error (semantic). draw is m-ary. 0 arguments are not allowed.");
   }
 
-  // evaluate all the following tailed expressions
+  // evaluate all the following tailed expressions, streaming each result to the graphics sink
+  GraphicsSink *sink = graphicsSink();
   for (int i = 1; i < ast.tail.size(); i++)
   {
-    graphics.push_back(evaluate(ast.tail[i], environ).head);
+    Atom atom = evaluate(ast.tail[i], environ).head;
+
+    PhaseTimer timer(statsenabled ? &stats.graphics : nullptr);
+    sink->draw(atom);
+    stats.primitives += statsenabled ? drawnprimitives(atom) : 0;
   }
 
   Expression noneexp;
@@ -334,7 +786,23 @@ Expression Interpreter::evaluatedraw(Expression ast, Environment *environ)
   return noneexp;
 }
 
-Expression Interpreter::evaluatespecialforms(Expression ast, Environment *environ)
+Expression Interpreter::evaluateprofilereport(const Expression &ast)
+{
+  if (ast.tail.size() != 1)
+  {
+    throw InterpreterSemanticError("Error (semantic). profile-report takes no arguments.");
+  }
+
+  // without profiling the report is empty
+  profile.report(profileout ? *profileout : std::cerr);
+
+  Expression noneexp;
+  noneexp.head.type = NoneType;
+
+  return noneexp;
+}
+
+Expression Interpreter::evaluatespecialforms(const Expression &ast, Environment *environ)
 {
   if (ast.head.value.sym_value == "begin") //Syntax: (begin <expression> <expression> ...)
   {
@@ -352,6 +820,10 @@ Expression Interpreter::evaluatespecialforms(Expression ast, Environment *enviro
   {
     return evaluatedraw(ast, environ);
   }
+  if (ast.head.value.sym_value == "profile-report") // Syntax: (profile-report)
+  {
+    return evaluateprofilereport(ast);
+  }
 
   Expression noneexp;
   noneexp.head.type = NullType;
@@ -10,6 +10,11 @@
 #include "expression.hpp"
 #include "environment.hpp"
 #include "tokenize.hpp"
+#include "graphics_sink.hpp"
+#include "hash_cons.hpp"
+#include "memo_cache.hpp"
+#include "profile.hpp"
+#include "stats.hpp"
 
 // Interpreter has
 // Environment, which starts at a default
@@ -27,20 +32,91 @@ public:
   // Evaluates the created AST, and returns a resultant expression
   Expression eval();
 
+  // Selects the optimization passes parse runs over the AST (see optimizer.hpp):
+  // 0 runs none (the default), 1 folds constant builtin calls, 2 also
+  // type checks the program, so eval raises the errors it finds up front and
+  // skips the checks of the builtin calls it proves well-typed, 3 also
+  // propagates defined constants and removes the ifs with constant conditions
+  void setOptLevel(int level)
+  {
+    optlevel = level;
+  }
+
+  // While enabled (disabled by default), parse stores the identical subtrees
+  // of the AST once, sharing them (see hash_cons.hpp)
+  void setHashConsing(bool enabled)
+  {
+    hashconsing = enabled;
+  }
+
+  // Caches the results of the calls to the memoizable builtins (see
+  // Environment::memoizable) in a MemoCache of capacity entries, which lasts
+  // across evaluations. 0 (the default) disables the cache.
+  void setMemoCapacity(std::size_t capacity)
+  {
+    memo = MemoCache(capacity);
+  }
+
+  // While enabled (disabled by default), the arithmetic evaluated on doubles
+  // (see evaluatenumeric) reduces a + or * of at least 32 arguments with
+  // pairwisesum or pairwiseproduct (see simd_kernels.hpp), whose results may
+  // differ in their last bits from adding up the arguments in order
+  void setVectorize(bool enabled)
+  {
+    vectorize = enabled;
+  }
+
+  const MemoCache &getMemoCache() const
+  {
+    return memo;
+  }
+
   // Recursive helper function that creates the AST from the provided list of valid tokens
   Expression read_from_tokens(TokenSequenceType &listOfTokens);
 
-  // Resets the environment variable (env) -- clears, and inserts a default configuration
+  // Returns a new interpreter whose environment is an O(1) snapshot of this
+  // one, so variants of a program can be evaluated from a shared prelude.
+  // Nothing else is inherited: the fork has no AST, draws to its own internal
+  // vector and has statistics and profiling disabled.
+  Interpreter fork() const;
+
+  // Writes every define of the environment to a checkpoint file (see checkpoint.hpp)
+  bool saveState(const std::string &path) const;
+
+  // Adds the defines of a checkpoint file to the environment, returns false
+  // (changing nothing) if the file is invalid or redefines a symbol
+  bool loadState(const std::string &path);
+
+  // Resets the environment variable (env) to the builtins, removing every define
   void resetenv();
 
-  Environment returnenv()
+  const Environment &returnenv() const
   {
     return env;
   }
 
-  std::vector<Atom> getGraphicsatoms()
+  // the AST built by the last parse, after the optimization passes
+  const Expression &returnast() const
+  {
+    return ast;
+  }
+
+  // Routes every drawn primitive to sink instead of the internal vector of atoms.
+  // The sink is not owned, passing nullptr restores the internal vector.
+  void setGraphicsSink(GraphicsSink *sink)
+  {
+    graphicssink = sink;
+  }
+
+  // returns the sink the draw special form currently streams to
+  GraphicsSink *graphicsSink()
   {
-    return graphics;
+    return graphicssink ? graphicssink : &graphics;
+  }
+
+  const std::vector<Atom> &getGraphicsatoms() const
+  {
+    return graphics.atoms();
   }
 
   void clearGraphics()
@@ -48,10 +124,46 @@ public:
     graphics.clear();
   }
 
+  // Collects Stats from parse and eval while enabled (disabled by default)
+  void enableStats(bool enabled)
+  {
+    statsenabled = enabled;
+  }
+
+  // statistics summed over every parse and eval since the last clearStats
+  const Stats &getStats() const
+  {
+    return stats;
+  }
+
+  void clearStats()
+  {
+    stats.clear();
+  }
+
+  // Counts builtin calls and symbol lookups in a Profile while enabled
+  // (disabled by default). (profile-report) writes the profile to out.
+  void enableProfile(bool enabled, std::ostream *out = nullptr)
+  {
+    profiling = enabled;
+    profileout = out;
+  }
+
+  const Profile &getProfile() const
+  {
+    return profile;
+  }
+
+  void clearProfile()
+  {
+    profile.clear();
+  }
+
   void clearAST()
   {
     ast.head.type = NoneType;
     ast.tail.clear();
+    checkerror.clear();
   }
 
 protected:
@@ -60,18 +172,63 @@ protected:
   // Abstract Syntax Tree Expression
   Expression ast;
 
-  // Recursive helper function that evaluates the built AST
-  // Note: the environment is updated with any define statements within the eval
-  Expression evaluate(Expression ast, Environment *environ);
+  // runs the passes of optlevel over the AST
+  void optimize();
+  int optlevel = 0;
+  std::string checkerror; // the error typecheck found in the AST, raised by eval
 
-  Expression evaluateothertypes(Expression ast, Environment *environ);
-  Expression evaluatespecialforms(Expression ast, Environment *environ);
-  Expression evaluatebegin(Expression ast, Environment *environ);
-  Expression evaluatedefine(Expression ast, Environment *environ);
-  Expression evaluateif(Expression ast, Environment *environ);
-  Expression evaluatedraw(Expression ast, Environment *environ);
+  bool hashconsing = false;
+  HashConsTable hashcons; // the subtrees read by the current parse
 
-  std::vector<Atom> graphics;
+  // Recursive helper function that evaluates the built AST
+  // Note: the environment is updated with any define statements within the eval
+  // The AST is taken by reference: copying each subtree at every level made the
+  // evaluation quadratic in the depth of the program
+  Expression evaluate(const Expression &ast, Environment *environ);
+
+  Expression evaluateothertypes(const Expression &ast, Environment *environ);
+  Expression evaluatespecialforms(const Expression &ast, Environment *environ);
+  Expression evaluatebegin(const Expression &ast, Environment *environ);
+  Expression evaluatedefine(const Expression &ast, Environment *environ);
+  Expression evaluateif(const Expression &ast, Environment *environ);
+  Expression evaluatedraw(const Expression &ast, Environment *environ);
+  Expression evaluateprofilereport(const Expression &ast);
+
+  // Evaluates a call to a builtin with a streaming form, folding each
+  // argument into the accumulator as soon as it is evaluated
+  Expression reduce(const Reducer &reducer, const Expression &ast, Environment *environ);
+
+  // The numeric fast path: evaluates a subtree marked numeric without building
+  // atoms or argument vectors. Returns false, having evaluated nothing that
+  // matters, if a symbol is not bound to a number or the subtree is not
+  // arithmetic after all; the subtree is then evaluated as usual.
+  bool evaluatenumeric(const Expression &ast, Environment *environ, Expression &result);
+  bool evaluatenumber(const Expression &ast, Environment *environ, double &value);
+  bool evaluatearithmetic(const Expression &ast, Environment *environ, double &value);
+
+  // calls proc, or looks its result up in memo if the builtin is memoizable
+  Expression call(Procedure proc, const std::vector<Atom> &args);
+  MemoCache memo = MemoCache(0);
+
+  bool vectorize = false;
+  std::vector<double> operands; // the arguments of the wide + and * being vectorized
+
+  // the calls the fast path failed on, innermost first; evaluated as usual
+  // next, they do not try the fast path again, which made a failing chain of
+  // nested calls quadratic in its depth
+  std::vector<const Expression *> numericfailures;
+
+  // default in-memory sink, used while no other sink is set
+  VectorGraphicsSink graphics;
+  GraphicsSink *graphicssink = nullptr;
+
+  Stats stats;
+  bool statsenabled = false;
+  unsigned depth = 0; // current recursion depth of evaluate, while collecting stats
+
+  Profile profile;
+  bool profiling = false;
+  std::ostream *profileout = nullptr; // std::cerr when null
 };
 
 #endif
@@ -0,0 +1,113 @@
+#include "lod_painter.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+#include <QPolygonF>
+#include <QStyleOptionGraphicsItem>
+
+// largest distance in device pixels between an arc and its segments
+#define ARC_TOLERANCE 0.5
+
+void LodCoverage::reset(const QSize &size)
+{
+  this->size = size;
+  pixels.fill(false, size.width() * size.height());
+}
+
+bool LodCoverage::claim(const QPoint &pixel)
+{
+  if (pixel.x() < 0 || pixel.y() < 0 || pixel.x() >= size.width() || pixel.y() >= size.height())
+  {
+    return false; // outside the device, nothing to draw
+  }
+
+  int i = pixel.y() * size.width() + pixel.x();
+  if (pixels.testBit(i))
+  {
+    return false;
+  }
+  pixels.setBit(i);
+  return true;
+}
+
+LodPainter::LodPainter(QPainter *painter, LodCoverage *coverage) : painter(painter), coverage(coverage)
+{
+  transform = painter->worldTransform();
+  lod = QStyleOptionGraphicsItem::levelOfDetailFromTransform(transform);
+}
+
+LodPainter::~LodPainter()
+{
+  if (pixels.isEmpty())
+  {
+    return;
+  }
+
+  // merged pixels are drawn in device coordinates with a one pixel cosmetic pen, in one call
+  QPen pen = painter->pen();
+  QPen pixelpen(pen.color());
+  pixelpen.setWidth(0);
+
+  painter->save();
+  painter->resetTransform();
+  painter->setPen(pixelpen);
+  painter->drawPoints(pixels.constData(), pixels.size());
+  painter->restore();
+}
+
+void LodPainter::pixel(double x, double y)
+{
+  QPointF device = transform.map(QPointF(x, y));
+
+  if (coverage == nullptr || coverage->claim(device.toPoint()))
+  {
+    pixels.append(device);
+  }
+}
+
+void LodPainter::point(const Point &p)
+{
+  if (2 * DEFAULT_POINT_RADIUS * lod < 1)
+  {
+    pixel(p.x, p.y);
+    return;
+  }
+  painter->drawEllipse(QPointF(p.x, p.y), DEFAULT_POINT_RADIUS, DEFAULT_POINT_RADIUS);
+}
+
+void LodPainter::line(const Line &l)
+{
+  if (std::hypot(l.second.x - l.first.x, l.second.y - l.first.y) * lod < 1)
+  {
+    pixel(l.first.x, l.first.y);
+    return;
+  }
+  painter->drawLine(QPointF(l.first.x, l.first.y), QPointF(l.second.x, l.second.y));
+}
+
+void LodPainter::arc(const Arc &a)
+{
+  double radius = std::hypot(a.start.x - a.center.x, a.start.y - a.center.y);
+  if (radius * lod < 1)
+  {
+    pixel(a.center.x, a.center.y);
+    return;
+  }
+
+  // the cached polyline is relative to the center, so no trigonometry is done per frame
+  const std::vector<Point> &cached = arcCache().tessellate(a, lod, ARC_TOLERANCE);
+
+  QPolygonF polyline(static_cast<int>(cached.size()));
+  for (std::size_t i = 0; i < cached.size(); i++)
+  {
+    polyline[i] = QPointF(a.center.x + cached[i].x, a.center.y + cached[i].y);
+  }
+  painter->drawPolyline(polyline);
+}
+
+ArcTessellationCache &LodPainter::arcCache()
+{
+  static ArcTessellationCache cache;
+  return cache;
+}
@@ -0,0 +1,66 @@
+#ifndef LOD_PAINTER_HPP
+#define LOD_PAINTER_HPP
+
+#include <QBitArray>
+#include <QPainter>
+#include <QPen>
+#include <QPoint>
+#include <QSize>
+#include <QTransform>
+#include <QVector>
+
+#include "arc_geometry.hpp"
+#include "graphics_sink.hpp"
+
+// Radius in scene units of a drawn point (as built by QtGraphicsSink)
+#define DEFAULT_POINT_RADIUS 2
+
+// The device pixels already covered by sub-pixel primitives during one frame,
+// so that primitives collapsing onto the same pixel are drawn once
+class LodCoverage
+{
+public:
+  // forgets every claimed pixel, for a device of the given size
+  void reset(const QSize &size);
+
+  // returns true the first time a pixel inside the device is claimed
+  bool claim(const QPoint &pixel);
+
+private:
+  QSize size;
+  QBitArray pixels;
+};
+
+// Draws primitives onto a painter with a level of detail driven by the
+// painter's current transform: primitives smaller than a pixel on screen are
+// merged into single pixels, and arcs get fewer segments when small on screen
+class LodPainter : public GraphicsSink
+{
+public:
+  // draws with the painter's current pen and brush,
+  // coverage may be null to draw every sub-pixel primitive
+  LodPainter(QPainter *painter, LodCoverage *coverage = nullptr);
+
+  // draws the merged pixels
+  ~LodPainter();
+
+  void point(const Point &p);
+  void line(const Line &l);
+  void arc(const Arc &a);
+
+  // flattened arcs shared by every LodPainter (painting happens on the GUI thread only)
+  static ArcTessellationCache &arcCache();
+
+private:
+  // records a primitive collapsed onto a single pixel
+  void pixel(double x, double y);
+
+  QPainter *painter;
+  LodCoverage *coverage;
+  QTransform transform;
+  double lod; // device pixels per scene unit
+
+  QVector<QPointF> pixels;
+};
+
+#endif
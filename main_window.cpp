@@ -34,9 +34,15 @@ MainWindow::MainWindow(std::string filename, QWidget *parent) : QWidget(parent)
   setLayout(layout);
   setWindowTitle("Slisp Interpreter");
 
+  // a display list written by slisp --display-list is shown without being evaluated
+  bool displaylist = filename.size() > 5 && filename.compare(filename.size() - 5, 5, ".sldl") == 0;
+
+  // and the defines of a checkpoint written by slisp --save-state are restored without being evaluated
+  bool checkpoint = filename.size() > 5 && filename.compare(filename.size() - 5, 5, ".slck") == 0;
+
   std::ifstream fi;
 
-  if (!filename.empty())
+  if (!filename.empty() && !displaylist && !checkpoint)
   {
     fi.open(filename); // opening the file to be read
   }
@@ -55,7 +61,18 @@ MainWindow::MainWindow(std::string filename, QWidget *parent) : QWidget(parent)
 
   // parsing the file:
 
-  if (!filename.empty())
+  if (displaylist)
+  {
+    if (!canvaswidget->loadDisplayList(filename))
+    {
+      messagewidget->error("Error: could not load the display list " + QString::fromStdString(filename));
+    }
+  }
+  else if (checkpoint)
+  {
+    qtinterp->loadState(filename);
+  }
+  else if (!filename.empty())
   {
     qtinterp->parse(fi);
   }
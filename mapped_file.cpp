@@ -0,0 +1,61 @@
+#include "mapped_file.hpp"
+
+// system includes
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+MappedFile::MappedFile() : bytes(nullptr), length(0)
+{
+}
+
+MappedFile::~MappedFile()
+{
+  close();
+}
+
+bool MappedFile::open(const std::string &path)
+{
+  close();
+
+  int fd = ::open(path.c_str(), O_RDONLY);
+  if (fd < 0)
+  {
+    return false;
+  }
+
+  struct stat info;
+  if (fstat(fd, &info) != 0)
+  {
+    ::close(fd);
+    return false;
+  }
+
+  // an empty file is valid but cannot be mapped
+  if (info.st_size > 0)
+  {
+    void *address = mmap(nullptr, info.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (address == MAP_FAILED)
+    {
+      ::close(fd);
+      return false;
+    }
+    bytes = static_cast<const char *>(address);
+    length = info.st_size;
+  }
+
+  // the mapping stays valid after the descriptor is closed
+  ::close(fd);
+  return true;
+}
+
+void MappedFile::close()
+{
+  if (bytes != nullptr)
+  {
+    munmap(const_cast<char *>(bytes), length);
+  }
+  bytes = nullptr;
+  length = 0;
+}
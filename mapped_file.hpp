@@ -0,0 +1,41 @@
+#ifndef MAPPED_FILE_HPP
+#define MAPPED_FILE_HPP
+
+// system includes
+#include <string>
+#include <cstddef>
+
+// A read-only memory mapping of a whole file.
+// The mapping is released when the object is destroyed or closed.
+class MappedFile
+{
+public:
+  MappedFile();
+  ~MappedFile();
+
+  // maps the file at path, returns false if it cannot be opened or mapped
+  bool open(const std::string &path);
+
+  // unmaps the file, if any
+  void close();
+
+  const char *data() const
+  {
+    return bytes;
+  }
+
+  std::size_t size() const
+  {
+    return length;
+  }
+
+private:
+  // a mapping is owned by a single object
+  MappedFile(const MappedFile &);
+  MappedFile &operator=(const MappedFile &);
+
+  const char *bytes;
+  std::size_t length;
+};
+
+#endif
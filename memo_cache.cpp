@@ -0,0 +1,145 @@
+#include "memo_cache.hpp"
+
+MemoCache::MemoCache(std::size_t capacity) : slots(capacity)
+{
+  std::size_t size = 1;
+  while (size < 2 * capacity)
+  {
+    size *= 2;
+  }
+  buckets.assign(size, 0);
+}
+
+std::size_t MemoCache::keyhash(Procedure proc, const std::vector<Atom> &args)
+{
+  std::size_t hash = std::hash<const void *>()(reinterpret_cast<const void *>(proc));
+  for (std::size_t i = 1; i < args.size(); i++)
+  {
+    hash = hash * 31 + atomhash(args[i]);
+  }
+  // spreads the bits over the low ones, which select the bucket
+  return hash ^ (hash >> 17) ^ (hash >> 31);
+}
+
+bool MemoCache::samekey(const Slot &slot, Procedure proc, const std::vector<Atom> &args)
+{
+  if (slot.proc != proc || slot.args.size() + 1 != args.size())
+  {
+    return false;
+  }
+  for (std::size_t i = 0; i < slot.args.size(); i++)
+  {
+    if (!sameatom(slot.args[i], args[i + 1]))
+    {
+      return false;
+    }
+  }
+  return true;
+}
+
+std::size_t MemoCache::bucketof(std::size_t hash, Procedure proc, const std::vector<Atom> &args) const
+{
+  std::size_t mask = buckets.size() - 1;
+  std::size_t bucket = hash & mask;
+  while (buckets[bucket] != 0)
+  {
+    const Slot &slot = slots[buckets[bucket] - 1];
+    if (slot.hash == hash && samekey(slot, proc, args))
+    {
+      break;
+    }
+    bucket = (bucket + 1) & mask;
+  }
+  return bucket;
+}
+
+void MemoCache::erasebucket(std::size_t bucket)
+{
+  // moves back the entries that probed past the erased bucket
+  std::size_t mask = buckets.size() - 1;
+  std::size_t next = (bucket + 1) & mask;
+  while (buckets[next] != 0)
+  {
+    std::size_t home = slots[buckets[next] - 1].hash & mask;
+    if (((next - home) & mask) >= ((next - bucket) & mask))
+    {
+      buckets[bucket] = buckets[next];
+      bucket = next;
+    }
+    next = (next + 1) & mask;
+  }
+  buckets[bucket] = 0;
+}
+
+const Expression *MemoCache::find(Procedure proc, const std::vector<Atom> &args)
+{
+  if (slots.empty())
+  {
+    return nullptr;
+  }
+
+  std::size_t bucket = bucketof(keyhash(proc, args), proc, args);
+  if (buckets[bucket] == 0)
+  {
+    misscount++;
+    return nullptr;
+  }
+  hitcount++;
+  Slot &slot = slots[buckets[bucket] - 1];
+  slot.referenced = true;
+  return &slot.result;
+}
+
+void MemoCache::insert(Procedure proc, const std::vector<Atom> &args, const Expression &result)
+{
+  if (slots.empty())
+  {
+    return;
+  }
+
+  std::size_t slot;
+  if (count < slots.size())
+  {
+    slot = count++; // the slots fill up in order
+  }
+  else
+  {
+    // the clock hand gives the referenced entries a second chance
+    while (slots[hand].referenced)
+    {
+      slots[hand].referenced = false;
+      hand = (hand + 1) % slots.size();
+    }
+    slot = hand;
+    hand = (hand + 1) % slots.size();
+
+    // the evicted entry is in the probe sequence of its hash
+    std::size_t mask = buckets.size() - 1;
+    std::size_t bucket = slots[slot].hash & mask;
+    while (buckets[bucket] != slot + 1)
+    {
+      bucket = (bucket + 1) & mask;
+    }
+    erasebucket(bucket);
+    evictioncount++;
+  }
+
+  Slot &entry = slots[slot];
+  entry.proc = proc;
+  entry.args.assign(args.begin() + 1, args.end());
+  entry.result = result;
+  entry.hash = keyhash(proc, args);
+  entry.referenced = false;
+  buckets[bucketof(entry.hash, proc, args)] = slot + 1;
+}
+
+void MemoCache::clear()
+{
+  for (Slot &slot : slots)
+  {
+    slot = Slot();
+  }
+  buckets.assign(buckets.size(), 0);
+  count = 0;
+  hand = 0;
+}
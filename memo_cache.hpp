@@ -0,0 +1,90 @@
+#ifndef MEMO_CACHE_HPP
+#define MEMO_CACHE_HPP
+
+// system includes
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// module includes
+#include "expression.hpp"
+
+// A bounded cache of the results of pure procedures, keyed on the procedure
+// and the arguments it was called with (args[1] on, args[0] being the
+// operator). When full, an entry is evicted with the CLOCK algorithm: every
+// hit marks its entry as referenced, and the clock hand sweeps the entries,
+// clearing the marks, until it finds one that was not referenced since the
+// previous sweep.
+class MemoCache
+{
+public:
+  explicit MemoCache(std::size_t capacity);
+
+  // returns the cached result of proc called with args, or nullptr
+  const Expression *find(Procedure proc, const std::vector<Atom> &args);
+
+  // caches the result of proc called with args, which must not be cached yet
+  void insert(Procedure proc, const std::vector<Atom> &args, const Expression &result);
+
+  std::size_t capacity() const
+  {
+    return slots.size();
+  }
+
+  std::size_t size() const
+  {
+    return count;
+  }
+
+  std::uint64_t hits() const
+  {
+    return hitcount;
+  }
+
+  std::uint64_t misses() const
+  {
+    return misscount;
+  }
+
+  std::uint64_t evictions() const
+  {
+    return evictioncount;
+  }
+
+  // removes every entry, keeping the counters
+  void clear();
+
+private:
+  struct Slot
+  {
+    Procedure proc = nullptr;
+    std::vector<Atom> args; // the arguments, without the operator
+    Expression result;
+    std::size_t hash = 0;
+    bool referenced = false;
+  };
+
+  static std::size_t keyhash(Procedure proc, const std::vector<Atom> &args);
+  static bool samekey(const Slot &slot, Procedure proc, const std::vector<Atom> &args);
+
+  // the bucket of the slot with the key of proc and args, or the empty
+  // bucket where it would go
+  std::size_t bucketof(std::size_t hash, Procedure proc, const std::vector<Atom> &args) const;
+  void erasebucket(std::size_t bucket);
+
+  std::vector<Slot> slots;
+
+  // An open addressing index of the slots, with linear probing: each bucket
+  // holds a slot number plus one, 0 when empty. There are at least twice as
+  // many buckets as slots, a power of two.
+  std::vector<std::size_t> buckets;
+
+  std::size_t count = 0;
+  std::size_t hand = 0;
+
+  std::uint64_t hitcount = 0;
+  std::uint64_t misscount = 0;
+  std::uint64_t evictioncount = 0;
+};
+
+#endif
@@ -0,0 +1,108 @@
+#include "message_log_model.hpp"
+
+#include <algorithm>
+
+MessageLogModel::MessageLogModel(int capacity, QObject *parent)
+    : QAbstractListModel(parent), ring(std::max(1, capacity)), errorbrush(Qt::red)
+{
+}
+
+int MessageLogModel::rowCount(const QModelIndex &parent) const
+{
+  if (parent.isValid())
+  {
+    return 0;
+  }
+  return static_cast<int>(last - first);
+}
+
+QVariant MessageLogModel::data(const QModelIndex &index, int role) const
+{
+  if (!index.isValid() || index.row() < 0 || index.row() >= rowCount())
+  {
+    return QVariant();
+  }
+
+  qint64 n = first + index.row();
+  if (n < appended - ring.size())
+  {
+    return QVariant(); // overwritten by a message not published yet
+  }
+
+  const Entry &entry = ring[n % ring.size()];
+  if (role == Qt::DisplayRole)
+  {
+    return entry.message;
+  }
+  if (role == Qt::ForegroundRole && entry.error)
+  {
+    return errorbrush;
+  }
+  return QVariant();
+}
+
+void MessageLogModel::append(const QString &message, bool error)
+{
+  Entry &entry = ring[appended % ring.size()];
+  entry.message = message; // implicitly shared, no copy of the text
+  entry.error = error;
+  appended++;
+}
+
+bool MessageLogModel::pending() const
+{
+  return appended != last;
+}
+
+bool MessageLogModel::latest(QString &message, bool &error) const
+{
+  if (appended == 0)
+  {
+    return false;
+  }
+  const Entry &entry = ring[(appended - 1) % ring.size()];
+  message = entry.message;
+  error = entry.error;
+  return true;
+}
+
+void MessageLogModel::publish()
+{
+  if (!pending())
+  {
+    return;
+  }
+
+  qint64 kept = std::max<qint64>(0, appended - ring.size());
+
+  if (kept >= last)
+  {
+    // every row the views know about is gone, rebuild them
+    beginResetModel();
+    first = kept;
+    last = appended;
+    endResetModel();
+    return;
+  }
+
+  if (kept > first)
+  {
+    beginRemoveRows(QModelIndex(), 0, static_cast<int>(kept - first) - 1);
+    first = kept;
+    endRemoveRows();
+  }
+
+  beginInsertRows(QModelIndex(), static_cast<int>(last - first), static_cast<int>(appended - first) - 1);
+  last = appended;
+  endInsertRows();
+}
+
+int MessageLogModel::capacity() const
+{
+  return ring.size();
+}
+
+qint64 MessageLogModel::total() const
+{
+  return appended;
+}
@@ -0,0 +1,62 @@
+#ifndef MESSAGE_LOG_MODEL_HPP
+#define MESSAGE_LOG_MODEL_HPP
+
+#include <QAbstractListModel>
+#include <QBrush>
+#include <QString>
+#include <QVector>
+
+// Bounded history of the info and error messages, kept in a ring buffer.
+// Appending is O(1) and does not notify views; the appended messages are
+// announced all at once by publish, so a burst costs one view update.
+class MessageLogModel : public QAbstractListModel
+{
+  Q_OBJECT
+
+public:
+  // keeps the last capacity messages
+  MessageLogModel(int capacity = 10000, QObject *parent = nullptr);
+
+  int rowCount(const QModelIndex &parent = QModelIndex()) const;
+
+  QVariant data(const QModelIndex &index, int role = Qt::DisplayRole) const;
+
+  // records a message, it is shown once published
+  void append(const QString &message, bool error);
+
+  // true if messages were appended since the last publish
+  bool pending() const;
+
+  // the last appended message, published or not, and whether it is an
+  // error; returns false if no message was appended
+  bool latest(QString &message, bool &error) const;
+
+  // announces the messages appended since the last publish to the views,
+  // and the removal of those that fell out of the history
+  void publish();
+
+  int capacity() const;
+
+  // number of messages ever appended
+  qint64 total() const;
+
+private:
+  struct Entry
+  {
+    QString message;
+    bool error;
+  };
+
+  QVector<Entry> ring;
+
+  // messages are numbered from 0 in order of arrival, message n is kept at ring[n % capacity]
+  qint64 appended = 0;
+
+  // the rows known to the views are the messages [first, last)
+  qint64 first = 0;
+  qint64 last = 0;
+
+  QBrush errorbrush;
+};
+
+#endif
@@ -3,48 +3,104 @@
 #include <QLabel>
 #include <QLayout>
 #include <QLineEdit>
+#include <QListView>
 #include <iostream>
 
-MessageWidget::MessageWidget(QWidget *parent) : QWidget(parent)
-{
-  // TODO: your code here...
+#include "message_log_model.hpp"
+
+// milliseconds between two updates of the log, about one frame
+#define LOG_UPDATE_INTERVAL 16
+// rows of the log shown at once
+#define LOG_VISIBLE_ROWS 4
 
+MessageWidget::MessageWidget(QWidget *parent, int historySize) : QWidget(parent), state(Empty)
+{
   QLabel *label = new QLabel("Message: ");
   lineEdit = new QLineEdit;
   lineEdit->setReadOnly(true);
   lineEdit->setFocus();
 
-  // QWidget *window = new QWidget;
+  infoPalette.setColor(QPalette::Base, Qt::white);
+  infoPalette.setColor(QPalette::Text, Qt::black);
+
+  errorPalette.setColor(QPalette::Text, Qt::black);
+  errorPalette.setColor(QPalette::Highlight, Qt::red);
+  errorPalette.setColor(QPalette::HighlightedText, Qt::white);
+
+  // only the visible rows of the log are ever laid out or painted
+  log = new MessageLogModel(historySize, this);
+  logView = new QListView;
+  logView->setModel(log);
+  logView->setUniformItemSizes(true);
+  logView->setEditTriggers(QAbstractItemView::NoEditTriggers);
+  logView->setSelectionMode(QAbstractItemView::NoSelection);
+  logView->setMaximumHeight(LOG_VISIBLE_ROWS * logView->fontMetrics().lineSpacing() + 2 * logView->frameWidth());
+
+  logTimer.setSingleShot(true);
+  logTimer.setInterval(LOG_UPDATE_INTERVAL);
+  QObject::connect(&logTimer, SIGNAL(timeout()), this, SLOT(updateLog()));
 
-  QHBoxLayout *layout = new QHBoxLayout;
-  layout->addWidget(label);
-  layout->addWidget(lineEdit);
+  QHBoxLayout *line = new QHBoxLayout;
+  line->addWidget(label);
+  line->addWidget(lineEdit);
+
+  QVBoxLayout *layout = new QVBoxLayout;
+  layout->addLayout(line);
+  layout->addWidget(logView);
 
   setLayout(layout);
 }
 
+MessageLogModel *MessageWidget::messageLog() const
+{
+  return log;
+}
+
+void MessageWidget::append(const QString &message, bool error)
+{
+  log->append(message, error);
+
+  // the first message of a frame schedules the update, the next ones join it
+  if (!logTimer.isActive())
+  {
+    logTimer.start();
+  }
+}
+
 void MessageWidget::info(QString message)
 {
-  lineEdit->clear();
-  QPalette *palette = new QPalette();
-  palette->setColor(QPalette::Base, Qt::white);
-  palette->setColor(QPalette::Text, Qt::black);
-  lineEdit->setPalette(*palette);
-  lineEdit->setText(message);
+  append(message, false);
 }
 
 void MessageWidget::error(QString message)
 {
-  QPalette *palette = new QPalette();
-  palette->setColor(QPalette::Text, Qt::black);
-  lineEdit->setText(message);
-  lineEdit->selectAll();
-  palette->setColor(QPalette::Highlight, Qt::red);
-  palette->setColor(QPalette::HighlightedText, Qt::white);
-  lineEdit->setPalette(*palette);
+  append(message, true);
 }
 
-// void MessageWidget::clear()
-// {
-//   // TODO: your code here...
-// }
+void MessageWidget::updateLog()
+{
+  if (!log->pending())
+  {
+    return;
+  }
+  log->publish();
+  logView->scrollToBottom();
+
+  // only the latest message of the frame reaches the line edit
+  QString message;
+  bool error = false;
+  log->latest(message, error);
+
+  // the palette only changes with the kind of message shown
+  State shown = error ? Error : Info;
+  if (state != shown)
+  {
+    lineEdit->setPalette(error ? errorPalette : infoPalette);
+    state = shown;
+  }
+  lineEdit->setText(message);
+  if (error)
+  {
+    lineEdit->selectAll();
+  }
+}
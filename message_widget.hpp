@@ -1,13 +1,20 @@
 #ifndef MESSAGE_WINDOW_HPP
 #define MESSAGE_WINDOW_HPP
 
+#include <QPalette>
 #include <QString>
+#include <QTimer>
 #include <QWidget>
 
 #include "qt_interpreter.hpp"
 
 class QLineEdit;
+class QListView;
+class MessageLogModel;
 
+// Shows the latest message in a line edit, above a log of the previous ones.
+// The line edit and the log are updated at most once per frame, however many
+// messages arrive, so each message costs O(1) work.
 class MessageWidget : public QWidget
 {
   Q_OBJECT
@@ -15,8 +22,32 @@ class MessageWidget : public QWidget
 private:
   QLineEdit *lineEdit;
 
+  QListView *logView;
+  MessageLogModel *log;
+
+  // publishes the logged messages and shows the latest one once per frame
+  QTimer logTimer;
+
+  // palettes of the line edit, built once
+  QPalette infoPalette;
+  QPalette errorPalette;
+
+  enum State
+  {
+    Empty,
+    Info,
+    Error
+  };
+  State state;
+
+  void append(const QString &message, bool error);
+
 public:
-  MessageWidget(QWidget *parent = nullptr);
+  // keeps the last historySize messages in the log
+  MessageWidget(QWidget *parent = nullptr, int historySize = 10000);
+
+  // the log of the messages, as shown by the widget
+  MessageLogModel *messageLog() const;
 
 public slots:
 
@@ -24,7 +55,9 @@ public slots:
 
   void error(QString message);
 
-  // void clear();
+  // shows the messages logged since the last update, and the latest one in
+  // the line edit
+  void updateLog();
 };
 
 #endif
@@ -0,0 +1,140 @@
+#include "nanbox.hpp"
+
+Type boxtype(Boxed boxed)
+{
+  if (isnumber(boxed))
+  {
+    return NumberType;
+  }
+  switch (boxtag(boxed))
+  {
+  case BoxNone:
+    return NoneType;
+  case BoxBoolean:
+    return BooleanType;
+  case BoxSymbol:
+    return SymbolType;
+  case BoxPoint:
+    return PointType;
+  case BoxLine:
+    return LineType;
+  case BoxArc:
+    return ArcType;
+  default:
+    return NullType;
+  }
+}
+
+std::uint32_t BoxHeap::intern(const Symbol &sym)
+{
+  auto found = ids.find(sym);
+  if (found != ids.end())
+  {
+    return found->second;
+  }
+  std::uint32_t id = static_cast<std::uint32_t>(symbols.size());
+  symbols.push_back(sym);
+  ids.emplace(sym, id);
+  return id;
+}
+
+Boxed BoxHeap::boxpoint(const Point &point)
+{
+  points.push_back(point);
+  return boxtagged(BoxPoint, reinterpret_cast<std::uintptr_t>(&points.back()));
+}
+
+Boxed BoxHeap::boxline(const Line &line)
+{
+  lines.push_back(line);
+  return boxtagged(BoxLine, reinterpret_cast<std::uintptr_t>(&lines.back()));
+}
+
+Boxed BoxHeap::boxarc(const Arc &arc)
+{
+  arcs.push_back(arc);
+  return boxtagged(BoxArc, reinterpret_cast<std::uintptr_t>(&arcs.back()));
+}
+
+bool BoxHeap::box(const Expression &exp, Boxed &boxed)
+{
+  if (!exp.tail.empty())
+  {
+    return false;
+  }
+
+  const Atom &atom = exp.head;
+  switch (atom.type)
+  {
+  case NoneType:
+    // an operator like not is NoneType too, but it is not a value
+    if (!atom.value.sym_value.empty())
+    {
+      return false;
+    }
+    boxed = boxnone();
+    return true;
+  case BooleanType:
+    boxed = boxboolean(atom.value.bool_value);
+    return true;
+  case NumberType:
+    boxed = boxnumber(atom.value.num_value);
+    return true;
+  case SymbolType:
+    boxed = boxsymbol(atom.value.sym_value);
+    return true;
+  case PointType:
+    boxed = boxpoint(atom.value.point_value);
+    return true;
+  case LineType:
+    boxed = boxline(atom.value.line_value);
+    return true;
+  case ArcType:
+    boxed = boxarc(atom.value.arc_value);
+    return true;
+  default:
+    return false;
+  }
+}
+
+Expression BoxHeap::unbox(Boxed boxed) const
+{
+  Expression exp;
+  exp.head.type = boxtype(boxed);
+
+  const void *object = reinterpret_cast<const void *>(static_cast<std::uintptr_t>(unboxpayload(boxed)));
+  switch (exp.head.type)
+  {
+  case NumberType:
+    exp.head.value.num_value = unboxnumber(boxed);
+    break;
+  case BooleanType:
+    exp.head.value.bool_value = unboxboolean(boxed);
+    break;
+  case SymbolType:
+    exp.head.value.sym_value = symbol(static_cast<std::uint32_t>(unboxpayload(boxed)));
+    break;
+  case PointType:
+    exp.head.value.point_value = *static_cast<const Point *>(object);
+    break;
+  case LineType:
+    exp.head.value.line_value = *static_cast<const Line *>(object);
+    break;
+  case ArcType:
+    exp.head.value.arc_value = *static_cast<const Arc *>(object);
+    break;
+  default:
+    exp.head.type = NoneType;
+    break;
+  }
+  return exp;
+}
+
+void BoxHeap::clear()
+{
+  symbols.clear();
+  ids.clear();
+  points.clear();
+  lines.clear();
+  arcs.clear();
+}
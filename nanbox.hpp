@@ -0,0 +1,155 @@
+#ifndef NANBOX_HPP
+#define NANBOX_HPP
+
+// system includes
+#include <cstdint>
+#include <cstring>
+#include <deque>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// module includes
+#include "expression.hpp"
+
+// A value encoded in a single 64-bit word (NaN-boxing), for operand stacks
+// and environment slots that are plain arrays of words.
+//
+// A Number is stored inline as its IEEE 754 bits; every NaN is stored as the
+// canonical quiet NaN 0x7ff8000000000000. The other values use the negative
+// quiet NaN space: the top 13 bits are set, bits 48 to 50 hold a tag and the
+// low 48 bits a payload, which is 0 for None, 0 or 1 for a Boolean, the id of
+// an interned Symbol, or the address of a Point, Line or Arc (user space
+// addresses fit in 48 bits on x86-64 and AArch64).
+typedef std::uint64_t Boxed;
+
+enum BoxTag
+{
+  BoxNone = 1,
+  BoxBoolean,
+  BoxSymbol,
+  BoxPoint,
+  BoxLine,
+  BoxArc
+};
+
+const Boxed BOX_NAN = 0x7ff8000000000000ULL;
+const Boxed BOX_TAGGED = 0xfff8000000000000ULL;
+const Boxed BOX_PAYLOAD = 0x0000ffffffffffffULL;
+const unsigned BOX_TAG_SHIFT = 48;
+
+inline Boxed boxnumber(Number num)
+{
+  if (num != num)
+  {
+    return BOX_NAN;
+  }
+  Boxed boxed;
+  std::memcpy(&boxed, &num, sizeof(boxed));
+  return boxed;
+}
+
+inline Boxed boxtagged(BoxTag tag, std::uint64_t payload)
+{
+  return BOX_TAGGED | (static_cast<Boxed>(tag) << BOX_TAG_SHIFT) | (payload & BOX_PAYLOAD);
+}
+
+inline Boxed boxnone()
+{
+  return boxtagged(BoxNone, 0);
+}
+
+inline Boxed boxboolean(Boolean tf)
+{
+  return boxtagged(BoxBoolean, tf);
+}
+
+inline bool isnumber(Boxed boxed)
+{
+  return (boxed & BOX_TAGGED) != BOX_TAGGED;
+}
+
+// the tag of a value that is not a Number
+inline BoxTag boxtag(Boxed boxed)
+{
+  return static_cast<BoxTag>((boxed >> BOX_TAG_SHIFT) & 7);
+}
+
+inline bool hastag(Boxed boxed, BoxTag tag)
+{
+  return (boxed & ~BOX_PAYLOAD) == boxtagged(tag, 0);
+}
+
+inline Number unboxnumber(Boxed boxed)
+{
+  Number num;
+  std::memcpy(&num, &boxed, sizeof(num));
+  return num;
+}
+
+inline Boolean unboxboolean(Boxed boxed)
+{
+  return (boxed & BOX_PAYLOAD) != 0;
+}
+
+inline std::uint64_t unboxpayload(Boxed boxed)
+{
+  return boxed & BOX_PAYLOAD;
+}
+
+// The type of a boxed value, NullType if it is not a valid value
+Type boxtype(Boxed boxed);
+
+// Owns what boxed values refer to: the interned symbols and the Points,
+// Lines and Arcs, which keep their addresses until the heap is cleared.
+// Boxed values outlive neither the heap that boxed them nor its clear().
+class BoxHeap
+{
+public:
+  // the id of sym, interning it on first use
+  std::uint32_t intern(const Symbol &sym);
+
+  // the symbol interned with id
+  const Symbol &symbol(std::uint32_t id) const
+  {
+    return symbols[id];
+  }
+
+  Boxed boxsymbol(const Symbol &sym)
+  {
+    return boxtagged(BoxSymbol, intern(sym));
+  }
+
+  Boxed boxpoint(const Point &point);
+  Boxed boxline(const Line &line);
+  Boxed boxarc(const Arc &arc);
+
+  // boxes the value of a leaf expression: a None, Boolean, Number, Symbol,
+  // Point, Line or Arc. Returns false for a list, an operator, a keyword or
+  // an array.
+  bool box(const Expression &exp, Boxed &boxed);
+
+  // the expression of a value boxed by this heap
+  Expression unbox(Boxed boxed) const;
+
+  // the number of Points, Lines and Arcs allocated
+  std::size_t objects() const
+  {
+    return points.size() + lines.size() + arcs.size();
+  }
+
+  // frees the symbols and objects, invalidating every boxed value that
+  // refers to one
+  void clear();
+
+private:
+  std::vector<Symbol> symbols;
+  std::unordered_map<Symbol, std::uint32_t> ids;
+
+  // deques never move their elements as they grow
+  std::deque<Point> points;
+  std::deque<Line> lines;
+  std::deque<Arc> arcs;
+};
+
+#endif
@@ -0,0 +1,545 @@
+#include "optimizer.hpp"
+
+// system includes
+#include <vector>
+
+// module includes
+#include "environment.hpp"
+#include "interpreter_semantic_error.hpp"
+#include "persistent_map.hpp"
+
+namespace
+{
+// true for a leaf whose value is known before evaluation
+bool isconstant(const Expression &exp)
+{
+  if (!exp.tail.empty())
+  {
+    return false;
+  }
+  switch (exp.head.type)
+  {
+  case BooleanType:
+  case NumberType:
+  case PointType:
+  case LineType:
+  case ArcType:
+  case NumberArrayType:
+  case PointArrayType:
+    return true;
+  case SymbolType: // builtins are never redefined, so pi is always pi
+    return exp.head.value.sym_value == "pi";
+  default:
+    return false;
+  }
+}
+
+Atom constantvalue(const Expression &exp)
+{
+  if (exp.head.type == SymbolType)
+  {
+    return Environment().searchExp(exp.head.value.sym_value).head;
+  }
+  return exp.head;
+}
+
+// the builtin procedure called by exp, or nullptr if exp is not such a call
+Procedure calledprocedure(const Expression &exp)
+{
+  if (exp.tail.empty() || !exp.tail[0].tail.empty())
+  {
+    return nullptr;
+  }
+  const Atom &op = exp.tail[0].head;
+  if ((op.type != ListType && op.type != NoneType) || op.value.sym_value != exp.head.value.sym_value)
+  {
+    return nullptr;
+  }
+  return Environment::builtinproc(op.value.sym_value);
+}
+
+// Replaces exp by its result if it is a call to a builtin procedure whose
+// arguments are all constants and which raises no error. Returns true if it did.
+bool foldcall(Expression &exp)
+{
+  Procedure proc = calledprocedure(exp);
+  if (proc == nullptr)
+  {
+    return false;
+  }
+
+  // the arguments as evaluate passes them, the operator first
+  std::vector<Atom> args;
+  args.reserve(exp.tail.size());
+  args.push_back(exp.tail[0].head);
+  for (std::size_t i = 1; i < exp.tail.size(); i++)
+  {
+    if (!isconstant(exp.tail[i]))
+    {
+      return false;
+    }
+    args.push_back(constantvalue(exp.tail[i]));
+  }
+
+  try
+  {
+    Expression result = proc(args);
+    exp = Expression(result.head);
+  }
+  catch (const InterpreterSemanticError &e)
+  {
+    return false; // evaluating the call raises the error
+  }
+  return true;
+}
+
+// true for the types of values the checker tracks through symbols
+bool isvaluetype(Type type)
+{
+  return type == BooleanType || type == NumberType || type == PointType || type == LineType || type == ArcType ||
+         type == NumberArrayType || type == PointArrayType;
+}
+
+// NullType stands for an unknown type. The symbols defined so far are kept in
+// a persistent map, so each if branch gets an O(1) copy whose defines are
+// dropped after it: a branch may not be evaluated.
+typedef PersistentMap<Type> TypeMap;
+
+// Mirrors Interpreter::evaluate, visiting the subexpressions in the order they
+// are evaluated. reached is true when exp is evaluated whenever the AST is,
+// unless an error is raised before.
+class TypeChecker
+{
+public:
+  std::uint64_t checked = 0;
+  std::string error;
+
+  // returns the type of the value of exp (NullType if unknown)
+  Type check(Expression &exp, TypeMap &defined, bool reached)
+  {
+    const Atom &head = exp.head;
+    if (isvaluetype(head.type)) // evaluates to itself, the tail is ignored
+    {
+      return head.type;
+    }
+
+    const Symbol &name = head.value.sym_value;
+    if (head.type == SymbolType)
+    {
+      if (name == "pi")
+      {
+        return NumberType;
+      }
+      const Type *type = defined.find(name);
+      if (type != nullptr && *type != NullType)
+      {
+        return *type;
+      }
+      // an unknown symbol evaluates to its value, or is called with its tail evaluated
+      checkbranches(exp, 0, defined);
+      return NullType;
+    }
+
+    if (name == "begin")
+    {
+      return checkbegin(exp, defined, reached);
+    }
+    if (name == "define")
+    {
+      return checkdefine(exp, defined, reached);
+    }
+    if (name == "if")
+    {
+      return checkif(exp, defined, reached);
+    }
+    if (name == "draw")
+    {
+      if (exp.tail.size() < 2)
+      {
+        fail("Error (semantic). draw is m-ary. 0 arguments are not allowed.", reached);
+        return NullType;
+      }
+      for (std::size_t i = 1; i < exp.tail.size(); i++)
+      {
+        check(exp.tail[i], defined, reached);
+      }
+      return NoneType;
+    }
+    if (name == "profile-report")
+    {
+      if (exp.tail.size() != 1)
+      {
+        fail("Error (semantic). profile-report takes no arguments.", reached);
+        return NullType;
+      }
+      return NoneType;
+    }
+
+    Procedure proc = calledprocedure(exp);
+    if (proc == nullptr)
+    {
+      checkbranches(exp, 0, defined);
+      return NullType;
+    }
+    if ((name == "and" || name == "or") && exp.tail.size() >= 3)
+    {
+      return checkshortcircuit(exp, proc, defined, reached);
+    }
+    return checkcall(exp, proc, defined, reached);
+  }
+
+private:
+  // checks the tail of exp from first on, as code that may not be evaluated
+  void checkbranches(Expression &exp, std::size_t first, const TypeMap &defined)
+  {
+    for (std::size_t i = first; i < exp.tail.size(); i++)
+    {
+      TypeMap branch = defined;
+      check(exp.tail[i], branch, false);
+    }
+  }
+
+  void fail(const std::string &message, bool reached)
+  {
+    if (reached && error.empty())
+    {
+      error = message;
+    }
+  }
+
+  Type checkbegin(Expression &exp, TypeMap &defined, bool reached)
+  {
+    if (exp.tail.size() < 2)
+    {
+      fail("Error (semantic). begin is m-ary. 0 arguments are not allowed.", reached);
+      return NullType;
+    }
+    Type type = NullType;
+    for (std::size_t i = 1; i < exp.tail.size(); i++)
+    {
+      type = check(exp.tail[i], defined, reached);
+    }
+    return type;
+  }
+
+  Type checkdefine(Expression &exp, TypeMap &defined, bool reached)
+  {
+    if (exp.tail.size() != 3)
+    {
+      fail("Error (semantic). 'if' is ternary. Only 3 arguments are required", reached);
+      return NullType;
+    }
+    if (exp.tail[1].head.type != SymbolType)
+    {
+      fail("Error (semantic). the expression <1> must be of Symbol Type where the format is 'define <1><2>'", reached);
+      return NullType;
+    }
+
+    const Symbol &symbol = exp.tail[1].head.value.sym_value;
+    if (builtins.check(symbol) || defined.find(symbol) != nullptr)
+    {
+      fail("Error (semantic). Expression <1> which is symbol (" + symbol + ") already exists", reached);
+      return NullType;
+    }
+
+    Type type = check(exp.tail[2], defined, reached);
+    defined.insert(symbol, isvaluetype(type) ? type : NullType);
+    return type;
+  }
+
+  Type checkif(Expression &exp, TypeMap &defined, bool reached)
+  {
+    if (exp.tail.size() != 4)
+    {
+      fail("Error (semantic). if is quad-ary. Only 4 arguments are required", reached);
+      return NullType;
+    }
+
+    Type condition = check(exp.tail[1], defined, reached);
+    if (condition != NullType && condition != BooleanType)
+    {
+      fail("Error (semantic). Expression 1 must be a Boolean type", reached);
+      return NullType;
+    }
+
+    TypeMap consequent = defined;
+    TypeMap alternative = defined;
+    Type first = check(exp.tail[2], consequent, false);
+    Type second = check(exp.tail[3], alternative, false);
+    return first == second ? first : NullType;
+  }
+
+  // Calls proc on atoms of the argument types: the checks of the builtins look
+  // at nothing else, so it accepts the call exactly when it accepts every
+  // evaluation of it.
+  Type checkcall(Expression &exp, Procedure proc, TypeMap &defined, bool reached)
+  {
+    std::vector<Atom> args;
+    args.reserve(exp.tail.size());
+    args.push_back(exp.tail[0].head);
+
+    bool known = true;
+    for (std::size_t i = 1; i < exp.tail.size(); i++)
+    {
+      Atom atom = Atom();
+      atom.type = check(exp.tail[i], defined, reached);
+      known = known && atom.type != NullType;
+      args.push_back(atom);
+    }
+    if (!known)
+    {
+      return NullType;
+    }
+
+    try
+    {
+      Type type = proc(args).head.type;
+      exp.checked = true;
+      checked++;
+      return type;
+    }
+    catch (const InterpreterSemanticError &e)
+    {
+      fail(e.what(), reached);
+      return NullType;
+    }
+  }
+
+  // and and or stop at the first argument that decides them, so only the first
+  // one is certain to be evaluated and checked
+  Type checkshortcircuit(Expression &exp, Procedure proc, TypeMap &defined, bool reached)
+  {
+    Atom first = Atom();
+    first.type = check(exp.tail[1], defined, reached);
+
+    bool boolean = first.type == BooleanType;
+    for (std::size_t i = 2; i < exp.tail.size(); i++)
+    {
+      TypeMap branch = defined;
+      boolean = check(exp.tail[i], branch, false) == BooleanType && boolean;
+    }
+
+    if (first.type != NullType && first.type != BooleanType)
+    {
+      // the error proc raises for a first argument of that type
+      Atom second = Atom();
+      second.type = BooleanType;
+      try
+      {
+        proc({exp.tail[0].head, first, second});
+      }
+      catch (const InterpreterSemanticError &e)
+      {
+        fail(e.what(), reached);
+      }
+      return NullType;
+    }
+    if (!boolean)
+    {
+      return NullType;
+    }
+    exp.checked = true;
+    checked++;
+    return BooleanType;
+  }
+
+  const Environment builtins;
+};
+
+// The values of the symbols the program binds to constants. A symbol is never
+// rebound, so once its define has been evaluated the value holds for the rest
+// of the program. Like TypeMap, each if branch gets its own copy.
+typedef PersistentMap<Atom> ConstantMap;
+
+// true for a leaf whose evaluation has no effect and never raises an error
+bool ispure(const Expression &exp)
+{
+  return exp.tail.empty() && (isvaluetype(exp.head.type) || exp.head.type == SymbolType);
+}
+
+// Like TypeChecker, mirrors Interpreter::evaluate, so a define is only used
+// by the subexpressions evaluated after it.
+class BranchEliminator
+{
+public:
+  std::uint64_t eliminated = 0;
+  std::uint64_t folded = 0;
+
+  void simplify(Expression &exp, ConstantMap &constants)
+  {
+    const Atom &head = exp.head;
+    if (isvaluetype(head.type)) // evaluates to itself, the tail is ignored
+    {
+      return;
+    }
+
+    const Symbol &name = head.value.sym_value;
+    if (head.type == SymbolType)
+    {
+      const Atom *value = constants.find(name);
+      if (value != nullptr) // evaluates to its value, the tail is ignored
+      {
+        exp = Expression(*value);
+        return;
+      }
+      simplifybranches(exp, constants);
+      return;
+    }
+
+    if (name == "begin")
+    {
+      simplifybegin(exp, constants);
+      return;
+    }
+    if (name == "define")
+    {
+      simplifydefine(exp, constants);
+      return;
+    }
+    if (name == "if")
+    {
+      simplifyif(exp, constants);
+      return;
+    }
+    if ((name == "and" || name == "or") && exp.tail.size() >= 3 && calledprocedure(exp) != nullptr)
+    {
+      // only the first argument is certain to be evaluated, see Reducer
+      simplify(exp.tail[1], constants);
+      for (std::size_t i = 2; i < exp.tail.size(); i++)
+      {
+        ConstantMap branchconstants = constants;
+        simplify(exp.tail[i], branchconstants);
+      }
+      folded += foldcall(exp);
+      return;
+    }
+    if (name == "draw" || calledprocedure(exp) != nullptr)
+    {
+      for (std::size_t i = 1; i < exp.tail.size(); i++)
+      {
+        simplify(exp.tail[i], constants);
+      }
+      folded += foldcall(exp);
+      return;
+    }
+    if (name == "profile-report")
+    {
+      return;
+    }
+    simplifybranches(exp, constants);
+  }
+
+private:
+  // simplifies the tail of exp as code that may not be evaluated
+  void simplifybranches(Expression &exp, const ConstantMap &constants)
+  {
+    for (Expression &branch : exp.tail)
+    {
+      ConstantMap branchconstants = constants;
+      simplify(branch, branchconstants);
+    }
+  }
+
+  // the value of every expression but the last is discarded, so the pure ones are removed
+  void simplifybegin(Expression &exp, ConstantMap &constants)
+  {
+    if (exp.tail.size() < 2)
+    {
+      return;
+    }
+
+    std::size_t kept = 1;
+    for (std::size_t i = 1; i < exp.tail.size(); i++)
+    {
+      simplify(exp.tail[i], constants);
+      if (i + 1 < exp.tail.size() && ispure(exp.tail[i]))
+      {
+        eliminated++;
+        continue;
+      }
+      if (kept != i)
+      {
+        exp.tail[kept] = std::move(exp.tail[i]);
+      }
+      kept++;
+    }
+    exp.tail.resize(kept);
+  }
+
+  void simplifydefine(Expression &exp, ConstantMap &constants)
+  {
+    // a define raising an error evaluates nothing
+    if (exp.tail.size() != 3 || exp.tail[1].head.type != SymbolType)
+    {
+      return;
+    }
+    const Symbol &symbol = exp.tail[1].head.value.sym_value;
+    if (builtins.check(symbol) || constants.find(symbol) != nullptr)
+    {
+      return;
+    }
+
+    simplify(exp.tail[2], constants);
+    if (exp.tail[2].tail.empty() && isvaluetype(exp.tail[2].head.type))
+    {
+      constants.insert(symbol, exp.tail[2].head);
+    }
+  }
+
+  void simplifyif(Expression &exp, ConstantMap &constants)
+  {
+    if (exp.tail.size() != 4)
+    {
+      return;
+    }
+
+    simplify(exp.tail[1], constants);
+    const Expression &condition = exp.tail[1];
+    if (condition.tail.empty() && condition.head.type == BooleanType)
+    {
+      // the if is replaced by the branch it takes, now evaluated whenever the if is
+      Expression taken = std::move(exp.tail[condition.head.value.bool_value ? 2 : 3]);
+      exp = std::move(taken);
+      eliminated++;
+      simplify(exp, constants);
+      return;
+    }
+
+    for (std::size_t i = 2; i < exp.tail.size(); i++)
+    {
+      ConstantMap branchconstants = constants;
+      simplify(exp.tail[i], branchconstants);
+    }
+  }
+
+  const Environment builtins;
+};
+} // namespace
+
+std::uint64_t foldconstants(Expression &ast)
+{
+  std::uint64_t folded = 0;
+  for (Expression &exp : ast.tail)
+  {
+    folded += foldconstants(exp);
+  }
+  return folded + foldcall(ast);
+}
+
+std::uint64_t eliminatebranches(Expression &ast, std::uint64_t &folded)
+{
+  BranchEliminator eliminator;
+  ConstantMap constants;
+  eliminator.simplify(ast, constants);
+  folded += eliminator.folded;
+  return eliminator.eliminated;
+}
+
+std::uint64_t typecheck(Expression &ast, std::string &error)
+{
+  TypeChecker checker;
+  TypeMap defined;
+  checker.check(ast, defined, true);
+  error = checker.error;
+  return checker.checked;
+}
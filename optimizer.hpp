@@ -0,0 +1,42 @@
+#ifndef OPTIMIZER_HPP
+#define OPTIMIZER_HPP
+
+// system includes
+#include <cstdint>
+#include <string>
+
+// module includes
+#include "expression.hpp"
+
+// Optimization passes run over the AST between read_from_tokens and eval,
+// selected by Interpreter::setOptLevel. A pass never changes the result of
+// evaluating the AST, nor whether evaluating it raises an error.
+
+// Replaces every call to a builtin procedure whose arguments are all
+// constants (literals, pi, or calls folded before) by its result. Calls
+// that raise an error are left in place, to raise it during evaluation.
+// Returns the number of calls folded.
+std::uint64_t foldconstants(Expression &ast);
+
+// Propagates the constants the program binds with define into the
+// expressions evaluated after the define, and folds the builtin calls that
+// become constant. An if whose condition becomes a boolean constant is
+// replaced by the branch it takes, and the expressions of a begin that are
+// neither its last nor able to do anything (literals and symbols) are removed.
+// Returns the number of ifs and expressions removed, and adds the number of
+// calls folded to folded.
+std::uint64_t eliminatebranches(Expression &ast, std::uint64_t &folded);
+
+// Infers the types of the values of the AST's subexpressions, from literals,
+// pi, builtin calls and the symbols defined earlier in the program, and checks
+// the arity and argument types of every builtin call and special form with
+// them. Symbols defined before the program are of unknown type.
+//
+// Calls whose argument types are all known and accepted are marked checked,
+// so the evaluator skips the builtin's checks. The first error that evaluating
+// the AST is certain to raise (one outside of an if branch) is stored in error,
+// which is left empty otherwise. Evaluation could have raised another error
+// before reaching it. Returns the number of calls marked.
+std::uint64_t typecheck(Expression &ast, std::string &error);
+
+#endif
@@ -0,0 +1,339 @@
+#ifndef PERSISTENT_MAP_HPP
+#define PERSISTENT_MAP_HPP
+
+// system includes
+#include <bitset>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+
+// A persistent hash array mapped trie from strings to Values.
+//
+// Copying a PersistentMap is O(1): copies share every node, and insert and
+// erase copy only the path from the root to the changed slot (at most
+// 64 / PERSISTENT_MAP_BITS nodes), so the other copies never see the change.
+// Each node holds up to 32 slots, indexed by 5 bits of the key's hash and
+// stored densely behind a bitmap. Keys whose hashes are equal end up in a
+// collision list below the last level.
+template <typename Value, typename Hash = std::hash<std::string>>
+class PersistentMap
+{
+public:
+  PersistentMap() : count(0)
+  {
+  }
+
+  // the value mapped to key, or nullptr
+  const Value *find(const std::string &key) const
+  {
+    std::size_t hash = hasher(key);
+    const Node *node = root.get();
+
+    for (unsigned shift = 0; node != nullptr; shift += PERSISTENT_MAP_BITS)
+    {
+      if (shift >= HASH_BITS)
+      {
+        for (const EntryPtr &entry : node->collisions)
+        {
+          if (entry->key == key)
+          {
+            return &entry->value;
+          }
+        }
+        return nullptr;
+      }
+
+      std::uint32_t bit = slotbit(hash, shift);
+      if (!(node->bitmap & bit))
+      {
+        return nullptr;
+      }
+
+      const Slot &slot = node->slots[slotindex(node->bitmap, bit)];
+      if (slot.entry)
+      {
+        return slot.entry->key == key ? &slot.entry->value : nullptr;
+      }
+      node = slot.node.get();
+    }
+    return nullptr;
+  }
+
+  // maps key to value, unless key is already mapped; returns true if inserted
+  bool insert(const std::string &key, const Value &value)
+  {
+    EntryPtr entry = std::make_shared<const Entry>(Entry{hasher(key), key, value});
+    NodePtr updated = insert(root, 0, entry);
+    if (updated == root)
+    {
+      return false;
+    }
+    root = updated;
+    count++;
+    return true;
+  }
+
+  // removes the mapping of key; returns true if there was one
+  bool erase(const std::string &key)
+  {
+    bool erased = false;
+    root = erase(root, 0, hasher(key), key, erased);
+    count -= erased;
+    return erased;
+  }
+
+  std::size_t size() const
+  {
+    return count;
+  }
+
+  bool empty() const
+  {
+    return count == 0;
+  }
+
+  void clear()
+  {
+    root.reset();
+    count = 0;
+  }
+
+  // calls f(key, value) for every mapping, in no particular order
+  template <typename F>
+  void foreach(F f) const
+  {
+    foreach(root.get(), f);
+  }
+
+private:
+  enum
+  {
+    PERSISTENT_MAP_BITS = 5,
+    HASH_BITS = sizeof(std::size_t) * 8
+  };
+
+  struct Entry
+  {
+    std::size_t hash;
+    std::string key;
+    Value value;
+  };
+
+  struct Node;
+
+  typedef std::shared_ptr<const Entry> EntryPtr;
+  typedef std::shared_ptr<const Node> NodePtr;
+
+  // a slot holds either an entry or a child node
+  struct Slot
+  {
+    EntryPtr entry;
+    NodePtr node;
+  };
+
+  struct Node
+  {
+    std::uint32_t bitmap = 0;
+    std::vector<Slot> slots;
+
+    // only below the last level, the entries whose hashes are all equal
+    std::vector<EntryPtr> collisions;
+  };
+
+  static std::uint32_t slotbit(std::size_t hash, unsigned shift)
+  {
+    return std::uint32_t(1) << ((hash >> shift) & ((1 << PERSISTENT_MAP_BITS) - 1));
+  }
+
+  // position of the slot of bit among the slots present in bitmap
+  static std::size_t slotindex(std::uint32_t bitmap, std::uint32_t bit)
+  {
+    return std::bitset<32>(bitmap & (bit - 1)).count();
+  }
+
+  // returns node with entry added, or node itself if entry's key is present
+  static NodePtr insert(const NodePtr &node, unsigned shift, const EntryPtr &entry)
+  {
+    if (shift >= HASH_BITS)
+    {
+      if (node)
+      {
+        for (const EntryPtr &other : node->collisions)
+        {
+          if (other->key == entry->key)
+          {
+            return node;
+          }
+        }
+      }
+      std::shared_ptr<Node> updated = node ? std::make_shared<Node>(*node) : std::make_shared<Node>();
+      updated->collisions.push_back(entry);
+      return updated;
+    }
+
+    std::uint32_t bit = slotbit(entry->hash, shift);
+
+    if (!node || !(node->bitmap & bit)) // a free slot
+    {
+      std::shared_ptr<Node> updated = node ? std::make_shared<Node>(*node) : std::make_shared<Node>();
+      Slot slot;
+      slot.entry = entry;
+      updated->slots.insert(updated->slots.begin() + slotindex(updated->bitmap, bit), slot);
+      updated->bitmap |= bit;
+      return updated;
+    }
+
+    std::size_t index = slotindex(node->bitmap, bit);
+    const Slot &slot = node->slots[index];
+    Slot replacement;
+
+    if (slot.entry)
+    {
+      if (slot.entry->key == entry->key)
+      {
+        return node;
+      }
+      // both entries move one level down
+      replacement.node = insert(insert(NodePtr(), shift + PERSISTENT_MAP_BITS, slot.entry), shift + PERSISTENT_MAP_BITS,
+                                entry);
+    }
+    else
+    {
+      replacement.node = insert(slot.node, shift + PERSISTENT_MAP_BITS, entry);
+      if (replacement.node == slot.node)
+      {
+        return node;
+      }
+    }
+
+    std::shared_ptr<Node> updated = std::make_shared<Node>(*node);
+    updated->slots[index] = replacement;
+    return updated;
+  }
+
+  // the only entry of node, if it has no other entry or child
+  static EntryPtr single(const NodePtr &node)
+  {
+    if (node->collisions.size() == 1 && node->slots.empty())
+    {
+      return node->collisions[0];
+    }
+    if (node->slots.size() == 1 && node->collisions.empty())
+    {
+      return node->slots[0].entry;
+    }
+    return EntryPtr();
+  }
+
+  // returns node without key, nullptr once empty, or node itself if key is absent
+  static NodePtr erase(const NodePtr &node, unsigned shift, std::size_t hash, const std::string &key, bool &erased)
+  {
+    if (!node)
+    {
+      return node;
+    }
+
+    if (shift >= HASH_BITS)
+    {
+      for (std::size_t i = 0; i < node->collisions.size(); i++)
+      {
+        if (node->collisions[i]->key == key)
+        {
+          erased = true;
+          if (node->collisions.size() == 1)
+          {
+            return NodePtr();
+          }
+          std::shared_ptr<Node> updated = std::make_shared<Node>(*node);
+          updated->collisions.erase(updated->collisions.begin() + i);
+          return updated;
+        }
+      }
+      return node;
+    }
+
+    std::uint32_t bit = slotbit(hash, shift);
+    if (!(node->bitmap & bit))
+    {
+      return node;
+    }
+
+    std::size_t index = slotindex(node->bitmap, bit);
+    const Slot &slot = node->slots[index];
+    Slot replacement;
+
+    if (slot.entry)
+    {
+      if (slot.entry->key != key)
+      {
+        return node;
+      }
+      erased = true;
+    }
+    else
+    {
+      replacement.node = erase(slot.node, shift + PERSISTENT_MAP_BITS, hash, key, erased);
+      if (replacement.node == slot.node)
+      {
+        return node;
+      }
+      // a child left with a single entry is replaced by the entry, keeping the trie shallow
+      if (replacement.node)
+      {
+        replacement.entry = single(replacement.node);
+        if (replacement.entry)
+        {
+          replacement.node.reset();
+        }
+      }
+    }
+
+    std::shared_ptr<Node> updated = std::make_shared<Node>(*node);
+    if (replacement.entry || replacement.node)
+    {
+      updated->slots[index] = replacement;
+    }
+    else
+    {
+      updated->slots.erase(updated->slots.begin() + index);
+      updated->bitmap &= ~bit;
+      if (updated->slots.empty())
+      {
+        return NodePtr();
+      }
+    }
+    return updated;
+  }
+
+  template <typename F>
+  static void foreach(const Node *node, F &f)
+  {
+    if (node == nullptr)
+    {
+      return;
+    }
+    for (const EntryPtr &entry : node->collisions)
+    {
+      f(entry->key, entry->value);
+    }
+    for (const Slot &slot : node->slots)
+    {
+      if (slot.entry)
+      {
+        f(slot.entry->key, slot.entry->value);
+      }
+      else
+      {
+        foreach(slot.node.get(), f);
+      }
+    }
+  }
+
+  NodePtr root;
+  std::size_t count;
+  Hash hasher;
+};
+
+#endif
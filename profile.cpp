@@ -0,0 +1,38 @@
+#include "profile.hpp"
+
+// system includes
+#include <algorithm>
+#include <iomanip>
+#include <utility>
+#include <vector>
+
+void Profile::report(std::ostream &out) const
+{
+  std::vector<std::pair<Symbol, ProfileEntry>> calls(builtins.begin(), builtins.end());
+  std::stable_sort(calls.begin(), calls.end(),
+                   [](const std::pair<Symbol, ProfileEntry> &a, const std::pair<Symbol, ProfileEntry> &b) {
+                     return a.second.time > b.second.time;
+                   });
+
+  out << std::left << std::setw(12) << "builtin" << std::right << std::setw(12) << "calls" << std::setw(12)
+      << "arguments" << std::setw(16) << "inclusive ms" << std::setw(12) << "mean us" << std::endl;
+  for (const std::pair<Symbol, ProfileEntry> &call : calls)
+  {
+    const ProfileEntry &entry = call.second;
+    out << std::left << std::setw(12) << call.first << std::right << std::setw(12) << entry.calls << std::setw(12)
+        << entry.arguments << std::fixed << std::setprecision(3) << std::setw(16) << entry.time * 1e3
+        << std::setw(12) << entry.time * 1e6 / entry.calls << std::endl;
+  }
+
+  std::vector<std::pair<Symbol, std::uint64_t>> symbols(lookups.begin(), lookups.end());
+  std::stable_sort(symbols.begin(), symbols.end(),
+                   [](const std::pair<Symbol, std::uint64_t> &a, const std::pair<Symbol, std::uint64_t> &b) {
+                     return a.second > b.second;
+                   });
+
+  out << std::left << std::setw(12) << "symbol" << std::right << std::setw(12) << "lookups" << std::endl;
+  for (const std::pair<Symbol, std::uint64_t> &symbol : symbols)
+  {
+    out << std::left << std::setw(12) << symbol.first << std::right << std::setw(12) << symbol.second << std::endl;
+  }
+}
@@ -0,0 +1,54 @@
+#ifndef PROFILE_HPP
+#define PROFILE_HPP
+
+// system includes
+#include <cstdint>
+#include <map>
+#include <ostream>
+
+// module includes
+#include "expression.hpp"
+
+// Calls of one builtin procedure
+struct ProfileEntry
+{
+  std::uint64_t calls = 0;
+  std::uint64_t arguments = 0;
+  double time = 0; // seconds, inclusive of evaluating the arguments
+};
+
+// Per-builtin and per-symbol counters collected by an Interpreter
+// while profiling (see Interpreter::enableProfile)
+class Profile
+{
+public:
+  // records a call of builtin with the given number of arguments
+  void call(const Symbol &builtin, std::size_t arguments, double seconds)
+  {
+    ProfileEntry &entry = builtins[builtin];
+    entry.calls++;
+    entry.arguments += arguments;
+    entry.time += seconds;
+  }
+
+  // records a lookup of a symbol in the environment
+  void lookup(const Symbol &symbol)
+  {
+    lookups[symbol]++;
+  }
+
+  void clear()
+  {
+    builtins.clear();
+    lookups.clear();
+  }
+
+  // writes the builtins by decreasing inclusive time,
+  // then the symbols by decreasing number of lookups
+  void report(std::ostream &out) const;
+
+  std::map<Symbol, ProfileEntry> builtins;
+  std::map<Symbol, std::uint64_t> lookups;
+};
+
+#endif
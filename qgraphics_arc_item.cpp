@@ -5,8 +5,12 @@
 #include <QDebug>
 #include <QPainter>
 
+#include "canvas_view.hpp"
+#include "lod_painter.hpp"
+
 QGraphicsArcItem::QGraphicsArcItem()
 {
+  arc.span = 0;
 }
 
 // QGraphicsArcItem::QGraphicsArcItem(qreal x, qreal y, qreal width, qreal height,
@@ -14,11 +18,21 @@ QGraphicsArcItem::QGraphicsArcItem()
 // {
 //   // TODO: your code here ...
 // }
+
+void QGraphicsArcItem::setArc(const Arc &a)
+{
+  arc = a;
+  update();
+}
+
 void QGraphicsArcItem::paint(QPainter *painter,
                              const QStyleOptionGraphicsItem *option,
                              QWidget *widget)
 {
-  // TODO: your code here ...
+  painter->setPen(pen());
   painter->setBrush(Qt::black);
-  painter->drawArc(rect(), startAngle(), spanAngle());
+
+  // the arc is drawn as segments, fewer of them when it is small on screen
+  LodPainter lodpainter(painter, CanvasView::coverage(widget));
+  lodpainter.arc(arc);
 }
@@ -3,6 +3,8 @@
 
 #include <QGraphicsEllipseItem>
 
+#include "expression.hpp"
+
 class QGraphicsArcItem : public QGraphicsEllipseItem
 {
 
@@ -11,9 +13,13 @@ public:
   // QGraphicsArcItem(qreal x, qreal y, qreal width, qreal height,
   //                  QGraphicsItem *parent = nullptr);
 
+  // the arc painted by this item, its rect and angles only define the item's shape
+  void setArc(const Arc &a);
+
   void paint(QPainter *painter, const QStyleOptionGraphicsItem *option, QWidget *widget);
 
 private:
+  Arc arc;
 };
 
 #endif
@@ -0,0 +1,36 @@
+#include "qgraphics_display_list_item.hpp"
+
+#include <QBrush>
+#include <QPainter>
+#include <QStyleOptionGraphicsItem>
+
+#include "canvas_view.hpp"
+#include "lod_painter.hpp"
+
+QGraphicsDisplayListItem::QGraphicsDisplayListItem(std::unique_ptr<DisplayList> displaylist) : displaylist(std::move(displaylist))
+{
+  // exposedRect is only filled in with the extended style option
+  setFlag(QGraphicsItem::ItemUsesExtendedStyleOption);
+}
+
+QRectF QGraphicsDisplayListItem::boundingRect() const
+{
+  Bounds b = displaylist->bounds();
+
+  // points are drawn around their coordinates
+  return QRectF(b.minx, b.miny, b.maxx - b.minx, b.maxy - b.miny)
+      .adjusted(-DEFAULT_POINT_RADIUS - 1, -DEFAULT_POINT_RADIUS - 1, DEFAULT_POINT_RADIUS + 1, DEFAULT_POINT_RADIUS + 1);
+}
+
+void QGraphicsDisplayListItem::paint(QPainter *painter, const QStyleOptionGraphicsItem *option, QWidget *widget)
+{
+  painter->setPen(QPen(Qt::black));
+  painter->setBrush(QBrush(Qt::black));
+
+  // a point drawn next to the exposed area can still reach into it
+  QRectF exposed = option->exposedRect.adjusted(-DEFAULT_POINT_RADIUS, -DEFAULT_POINT_RADIUS, DEFAULT_POINT_RADIUS, DEFAULT_POINT_RADIUS);
+  Bounds area = {exposed.left(), exposed.top(), exposed.right(), exposed.bottom()};
+
+  LodPainter lodpainter(painter, CanvasView::coverage(widget));
+  displaylist->replay(lodpainter, area);
+}
@@ -0,0 +1,27 @@
+#ifndef QGRAPHICS_DISPLAY_LIST_ITEM_HPP
+#define QGRAPHICS_DISPLAY_LIST_ITEM_HPP
+
+#include <memory>
+
+#include <QGraphicsItem>
+
+#include "display_list.hpp"
+
+// A whole display list shown as a single item: each repaint only visits the
+// primitives in the exposed area (through the list's spatial index) and
+// draws them with level of detail, so no per-primitive item is ever built
+class QGraphicsDisplayListItem : public QGraphicsItem
+{
+public:
+  // takes ownership of an opened display list
+  QGraphicsDisplayListItem(std::unique_ptr<DisplayList> displaylist);
+
+  QRectF boundingRect() const;
+
+  void paint(QPainter *painter, const QStyleOptionGraphicsItem *option, QWidget *widget);
+
+private:
+  std::unique_ptr<DisplayList> displaylist;
+};
+
+#endif
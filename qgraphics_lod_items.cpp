@@ -0,0 +1,38 @@
+#include "qgraphics_lod_items.hpp"
+
+#include <QBrush>
+#include <QPainter>
+
+#include "canvas_view.hpp"
+#include "lod_painter.hpp"
+
+QGraphicsLodPointItem::QGraphicsLodPointItem(const Point &p) : center(p)
+{
+  // The rectangle is constructed with (x, y) as its top-left corner and a given width and height.
+  // So, if you'd like to center your point at a coordinate (x,y) we must subtract the height and width
+  // to get the specific point.
+  setBrush(QBrush(Qt::black));
+  setRect(p.x - DEFAULT_POINT_RADIUS, p.y - DEFAULT_POINT_RADIUS, 2 * DEFAULT_POINT_RADIUS, 2 * DEFAULT_POINT_RADIUS);
+}
+
+void QGraphicsLodPointItem::paint(QPainter *painter, const QStyleOptionGraphicsItem *option, QWidget *widget)
+{
+  painter->setPen(pen());
+  painter->setBrush(brush());
+
+  LodPainter lodpainter(painter, CanvasView::coverage(widget));
+  lodpainter.point(center);
+}
+
+QGraphicsLodLineItem::QGraphicsLodLineItem(const Line &l) : segment(l)
+{
+  setLine(l.first.x, l.first.y, l.second.x, l.second.y);
+}
+
+void QGraphicsLodLineItem::paint(QPainter *painter, const QStyleOptionGraphicsItem *option, QWidget *widget)
+{
+  painter->setPen(pen());
+
+  LodPainter lodpainter(painter, CanvasView::coverage(widget));
+  lodpainter.line(segment);
+}
@@ -0,0 +1,33 @@
+#ifndef QGRAPHICS_LOD_ITEMS_HPP
+#define QGRAPHICS_LOD_ITEMS_HPP
+
+#include <QGraphicsEllipseItem>
+#include <QGraphicsLineItem>
+
+#include "expression.hpp"
+
+// A drawn point, merged into a single pixel when smaller than a pixel on screen
+class QGraphicsLodPointItem : public QGraphicsEllipseItem
+{
+public:
+  QGraphicsLodPointItem(const Point &p);
+
+  void paint(QPainter *painter, const QStyleOptionGraphicsItem *option, QWidget *widget);
+
+private:
+  Point center;
+};
+
+// A drawn line, merged into a single pixel when shorter than a pixel on screen
+class QGraphicsLodLineItem : public QGraphicsLineItem
+{
+public:
+  QGraphicsLodLineItem(const Line &l);
+
+  void paint(QPainter *painter, const QStyleOptionGraphicsItem *option, QWidget *widget);
+
+private:
+  Line segment;
+};
+
+#endif
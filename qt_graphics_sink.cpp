@@ -0,0 +1,87 @@
+#include "qt_graphics_sink.hpp"
+
+#include <cmath>
+
+#include <QBrush>
+#include <QGraphicsPathItem>
+#include <QGraphicsPolygonItem>
+#include <QPainterPath>
+#include <QPolygonF>
+#include <QtAlgorithms>
+
+#include "arc_geometry.hpp"
+#include "qgraphics_arc_item.hpp"
+#include "qgraphics_lod_items.hpp"
+
+QtGraphicsSink::~QtGraphicsSink()
+{
+  discard();
+}
+
+void QtGraphicsSink::point(const Point &p)
+{
+  batch.append(new QGraphicsLodPointItem(p));
+}
+
+void QtGraphicsSink::line(const Line &l)
+{
+  batch.append(new QGraphicsLodLineItem(l));
+}
+
+void QtGraphicsSink::arc(const Arc &a)
+{
+  QGraphicsArcItem *item = new QGraphicsArcItem;
+  item->setBrush(QBrush(Qt::black));
+
+  ArcGeometry g = arcgeometry(a);
+  item->setRect(g.center.x - g.radius, g.center.y - g.radius, 2 * g.radius, 2 * g.radius);
+
+  // Note: setStartAngle and setSpanAngle take angles in 16ths of a degree,
+  // they only describe the item's shape; it is painted from the exact arc
+  double sixteenths = 16 * 180 / std::atan2(0, -1);
+  item->setStartAngle(qRound(-g.start * sixteenths));
+  item->setSpanAngle(qRound(g.span * sixteenths));
+  item->setArc(a);
+  batch.append(item);
+}
+
+void QtGraphicsSink::polyline(const Number *x, const Number *y, std::size_t n, bool closed)
+{
+  // a single point has no segment, as for the sinks drawing lines
+  if (n < 2)
+  {
+    return;
+  }
+
+  if (closed)
+  {
+    QPolygonF polygon;
+    polygon.reserve(static_cast<int>(n));
+    for (std::size_t i = 0; i < n; i++)
+    {
+      polygon.append(QPointF(x[i], y[i]));
+    }
+    batch.append(new QGraphicsPolygonItem(polygon));
+    return;
+  }
+
+  QPainterPath path(QPointF(x[0], y[0]));
+  for (std::size_t i = 1; i < n; i++)
+  {
+    path.lineTo(x[i], y[i]);
+  }
+  batch.append(new QGraphicsPathItem(path));
+}
+
+void QtGraphicsSink::discard()
+{
+  qDeleteAll(batch);
+  batch.clear();
+}
+
+QList<QGraphicsItem *> QtGraphicsSink::takeBatch()
+{
+  QList<QGraphicsItem *> items;
+  items.swap(batch);
+  return items;
+}
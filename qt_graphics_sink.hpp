@@ -0,0 +1,33 @@
+#ifndef QT_GRAPHICS_SINK_HPP
+#define QT_GRAPHICS_SINK_HPP
+
+#include <QList>
+#include <QGraphicsItem>
+
+#include "graphics_sink.hpp"
+
+// Builds the QGraphicsItem for each primitive as soon as it is drawn.
+// Items are batched per evaluation: QtInterpreter takes the batch once
+// the evaluation succeeds, and the batch is deleted if it fails.
+class QtGraphicsSink : public GraphicsSink
+{
+public:
+  ~QtGraphicsSink();
+
+  void point(const Point &p);
+  void line(const Line &l);
+  void arc(const Arc &a);
+
+  // builds a single QGraphicsPathItem, or a QGraphicsPolygonItem if closed
+  void polyline(const Number *x, const Number *y, std::size_t n, bool closed);
+
+  void discard();
+
+  // hands over ownership of the items built since the last call
+  QList<QGraphicsItem *> takeBatch();
+
+private:
+  QList<QGraphicsItem *> batch;
+};
+
+#endif
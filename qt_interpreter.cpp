@@ -9,14 +9,13 @@
 #include <QBrush>
 #include <QDebug>
 
-#include "qgraphics_arc_item.hpp"
 #include "expression.hpp"
 #include "interpreter_semantic_error.hpp"
 
-#define DEFAULT_POINT_RADIUS 2
-
 QtInterpreter::QtInterpreter(QObject *parent) : QObject(parent)
 {
+  // drawn primitives go straight to the Qt sink instead of a vector of atoms
+  interp.setGraphicsSink(&graphicssink);
 }
 
 void QtInterpreter::parseAndEvaluate(QString entry)
@@ -39,11 +38,7 @@ void QtInterpreter::parseAndEvaluate(QString entry)
 
       updatemessages(result);
 
-      std::vector<Atom> graphics = interp.getGraphicsatoms();
-
-      updatinggraphics(graphics);
-
-      interp.clearGraphics(); // clears the vector of Graphics atoms
+      updatinggraphics(); // emits the items drawn by this evaluation
     }
     catch (const InterpreterSemanticError &e)
     {
@@ -73,11 +68,7 @@ void QtInterpreter::parse(std::istream &fi)
 
       updatemessages(result);
 
-      std::vector<Atom> graphics = interp.getGraphicsatoms();
-
-      updatinggraphics(graphics);
-
-      interp.clearGraphics(); // clears the vector of Graphics atoms
+      updatinggraphics(); // emits the items drawn by this evaluation
     }
     catch (const InterpreterSemanticError &e)
     {
@@ -87,6 +78,16 @@ void QtInterpreter::parse(std::istream &fi)
   }
 }
 
+bool QtInterpreter::loadState(const std::string &path)
+{
+  if (!interp.loadState(path))
+  {
+    emit error(QString::fromStdString("Error: could not load the checkpoint " + path));
+    return false;
+  }
+  return true;
+}
+
 void QtInterpreter::updatemessages(Expression result)
 {
   if (result.head.type == NumberType)
@@ -131,56 +132,20 @@ void QtInterpreter::updatemessages(Expression result)
     x = "((" + QString::number(result.head.value.arc_value.center.x) + "," + QString::number(result.head.value.arc_value.center.y) + ")(" + QString::number(result.head.value.arc_value.start.x) + "," + QString::number(result.head.value.arc_value.start.y) + ")(" + QString::number(result.head.value.arc_value.span) + "))";
     emit info(x);
   }
+  else if (result.head.type == NumberArrayType || result.head.type == PointArrayType)
+  {
+    emit info(QString::fromStdString(formatarray(result.head)));
+  }
 }
 
-void QtInterpreter::updatinggraphics(std::vector<Atom> &graphics)
+void QtInterpreter::updatinggraphics()
 {
-  for (int i = 0; i < graphics.size(); i++)
+  QList<QGraphicsItem *> items = graphicssink.takeBatch();
+
+  for (int i = 0; i < items.size(); i++)
   {
     std::string x = "(None)";
     emit info(QString::fromStdString(x));
-    if (graphics[i].type == PointType)
-    {
-      QGraphicsEllipseItem *item = new QGraphicsEllipseItem;
-      // The rectangle is constructed with (x, y) as its top-left corner and a given width and height.
-      // So, if you'd like to center your point at a coordinate (x,y) we must subtract the height and width
-      // to get the specific point.
-      item->setBrush(QBrush(Qt::black));
-      item->setRect(graphics[i].value.point_value.x - DEFAULT_POINT_RADIUS, graphics[i].value.point_value.y - DEFAULT_POINT_RADIUS, 2 * DEFAULT_POINT_RADIUS, 2 * DEFAULT_POINT_RADIUS);
-      emit drawGraphic(item);
-    }
-    else if (graphics[i].type == LineType)
-    {
-      Line l;
-      QGraphicsLineItem *item = new QGraphicsLineItem;
-      Point start = graphics[i].value.line_value.first;
-      Point finish = graphics[i].value.line_value.second;
-      item->setLine(start.x, start.y, finish.x, finish.y);
-      emit drawGraphic(item);
-    }
-    else if (graphics[i].type == ArcType)
-    {
-      QGraphicsArcItem *item = new QGraphicsArcItem;
-      item->setBrush(QBrush(Qt::black));
-      Point center = graphics[i].value.arc_value.center;
-      Point start = graphics[i].value.arc_value.start;
-      double sp = graphics[i].value.arc_value.span;
-
-      double radius = sqrt(pow((center.y - start.y), 2) + pow((center.x - start.x), 2));
-      item->setRect(center.x - radius, center.y - radius, 2 * radius, 2 * radius);
-
-      double sp_degrees = sp * 180 / atan2(0, -1);
-
-      // central angle:
-      double start_degrees = -(atan2((start.y - center.y), (start.x - center.x)) * 180 / atan2(0, -1));
-
-      // Note: setStartAngle and setSpanAngle set an angle for an ellipse
-      // segment to a number which is in 16ths of a degree. Hence, the resulting degree
-      // is multiplied by 16.
-
-      item->setStartAngle(16 * start_degrees);
-      item->setSpanAngle(16 * sp_degrees);
-      emit drawGraphic(item);
-    }
+    emit drawGraphic(items[i]);
   }
-}
\ No newline at end of file
+}
@@ -8,6 +8,7 @@
 #include <QGraphicsItem>
 
 #include "interpreter.hpp"
+#include "qt_graphics_sink.hpp"
 
 class QtInterpreter : public QObject, private Interpreter
 {
@@ -16,14 +17,20 @@ class QtInterpreter : public QObject, private Interpreter
 private:
   Interpreter interp; // creating the interpreter
 
+  QtGraphicsSink graphicssink; // builds the items drawn by interp
+
 public:
   QtInterpreter(QObject *parent = nullptr);
 
   void parse(std::istream &fi);
 
+  // restores the defines of a checkpoint written by slisp --save-state,
+  // emits an error if the file cannot be loaded
+  bool loadState(const std::string &path);
+
   void updatemessages(Expression result);
 
-  void updatinggraphics(std::vector<Atom> &graphics);
+  void updatinggraphics();
 
 signals:
 
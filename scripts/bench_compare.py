@@ -0,0 +1,62 @@
+#!/usr/bin/env python3
+"""Compare two slisp_bench JSON reports and flag regressions.
+
+usage: bench_compare.py <baseline.json> <current.json> [--threshold=0.10]
+
+A benchmark regresses when its median grew by more than the threshold
+(a fraction of the baseline median). Exits with 1 if any benchmark
+regressed, 0 otherwise.
+"""
+
+import json
+import sys
+
+
+def load(path):
+    with open(path) as f:
+        return {b['name']: b for b in json.load(f)['benchmarks']}
+
+
+def main(argv):
+    threshold = 0.10
+    paths = []
+    for arg in argv[1:]:
+        if arg.startswith('--threshold='):
+            threshold = float(arg[len('--threshold='):])
+        else:
+            paths.append(arg)
+
+    if len(paths) != 2:
+        print(__doc__.strip(), file=sys.stderr)
+        return 2
+
+    baseline = load(paths[0])
+    current = load(paths[1])
+
+    regressions = 0
+    print('%-32s %12s %12s %9s' % ('benchmark', 'baseline ns', 'current ns', 'change'))
+    for name in sorted(set(baseline) | set(current)):
+        if name not in current:
+            print('%-32s %12.1f %12s %9s' % (name, baseline[name]['median_ns'], '-', 'removed'))
+            continue
+        if name not in baseline:
+            print('%-32s %12s %12.1f %9s' % (name, '-', current[name]['median_ns'], 'new'))
+            continue
+
+        before = baseline[name]['median_ns']
+        after = current[name]['median_ns']
+        change = (after - before) / before if before > 0 else 0.0
+        flag = ''
+        if change > threshold:
+            flag = '  REGRESSION'
+            regressions += 1
+        print('%-32s %12.1f %12.1f %+8.1f%%%s' % (name, before, after, 100 * change, flag))
+
+    if regressions:
+        print('%d benchmark(s) regressed by more than %.0f%%' % (regressions, 100 * threshold))
+        return 1
+    return 0
+
+
+if __name__ == '__main__':
+    sys.exit(main(sys.argv))
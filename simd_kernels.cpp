@@ -0,0 +1,386 @@
+#include "simd_kernels.hpp"
+
+// system includes
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+
+#if (defined(__x86_64__) || defined(__i386__)) && defined(__GNUC__)
+#define SIMD_X86 1
+#include <immintrin.h>
+#endif
+
+namespace
+{
+// values reduced in lanes before the pairwise recursion
+const std::size_t SIMD_BLOCK = 256;
+// interleaved accumulators: 4 AVX2 or 8 SSE2 registers
+const std::size_t SIMD_LANES = 16;
+// largest angle the range reduction handles exactly
+const double SINCOS_LIMIT = 1e6;
+
+// pi / 2 split in three, the first two with trailing zero bits so their
+// products with the quadrant number are exact (Cephes' DP1, DP2, DP3 doubled)
+const double PIO2_1 = 1.57079625129699707031e+00;
+const double PIO2_2 = 7.54978941586159635335e-08;
+const double PIO2_3 = 5.39030285815811905290e-15;
+const double TWO_OVER_PI = 6.36619772367581382433e-01;
+// adding 1.5 * 2^52 rounds to an integer, left in the low mantissa bits
+const double ROUNDING = 6755399441055744.0;
+
+// minimax polynomials on [-pi / 4, pi / 4] (Cephes' sincof and coscof)
+const double S0 = 1.58962301576546568060e-10;
+const double S1 = -2.50507477628578072866e-08;
+const double S2 = 2.75573136213857245213e-06;
+const double S3 = -1.98412698295895385996e-04;
+const double S4 = 8.33333333332211858878e-03;
+const double S5 = -1.66666666666666307295e-01;
+const double C0 = -1.13585365213876817300e-11;
+const double C1 = 2.08757008419747316778e-09;
+const double C2 = -2.75573141792967388112e-07;
+const double C3 = 2.48015872888517045348e-05;
+const double C4 = -1.38888888888730564116e-03;
+const double C5 = 4.16666666666665929218e-02;
+
+SimdLevel &currentlevel()
+{
+  static SimdLevel level = simdsupported();
+  return level;
+}
+
+double apply(double a, double b, bool product)
+{
+  return product ? a * b : a + b;
+}
+
+// folds the last n < SIMD_LANES values into the lanes, then combines the
+// lanes in halves: lane j with lane j + 8, then j + 4, j + 2 and j + 1
+double combine(double *lanes, const double *x, std::size_t n, bool product)
+{
+  for (std::size_t j = 0; j < n; j++)
+  {
+    lanes[j] = apply(lanes[j], x[j], product);
+  }
+  for (std::size_t width = SIMD_LANES / 2; width > 0; width /= 2)
+  {
+    for (std::size_t j = 0; j < width; j++)
+    {
+      lanes[j] = apply(lanes[j], lanes[j + width], product);
+    }
+  }
+  return lanes[0];
+}
+
+double blockscalar(const double *x, std::size_t n, bool product)
+{
+  double lanes[SIMD_LANES];
+  for (double &lane : lanes)
+  {
+    lane = product ? 1 : 0;
+  }
+
+  std::size_t i = 0;
+  for (; i + SIMD_LANES <= n; i += SIMD_LANES)
+  {
+    for (std::size_t j = 0; j < SIMD_LANES; j++)
+    {
+      lanes[j] = apply(lanes[j], x[i + j], product);
+    }
+  }
+  return combine(lanes, x + i, n - i, product);
+}
+
+// sine and cosine of an angle within SINCOS_LIMIT
+void sincosscalar(double x, double &sine, double &cosine)
+{
+  double t = x * TWO_OVER_PI + ROUNDING;
+  double q = t - ROUNDING;
+  std::uint64_t quadrant;
+  std::memcpy(&quadrant, &t, sizeof(quadrant));
+
+  double r = ((x - q * PIO2_1) - q * PIO2_2) - q * PIO2_3;
+  double z = r * r;
+  double s = r + r * z * (((((S0 * z + S1) * z + S2) * z + S3) * z + S4) * z + S5);
+  double c = 1.0 - 0.5 * z + z * z * (((((C0 * z + C1) * z + C2) * z + C3) * z + C4) * z + C5);
+
+  // sin x is s, c, -s or -c in quadrants 0 to 3 and cos x is c, -s, -c or s
+  sine = (quadrant & 1) ? c : s;
+  cosine = (quadrant & 1) ? s : c;
+  if (quadrant & 2)
+  {
+    sine = -sine;
+  }
+  if ((quadrant + 1) & 2)
+  {
+    cosine = -cosine;
+  }
+}
+
+void batchscalar(const double *angles, double *sines, double *cosines, std::size_t n)
+{
+  for (std::size_t i = 0; i < n; i++)
+  {
+    sincosscalar(angles[i], sines[i], cosines[i]);
+  }
+}
+
+#ifdef SIMD_X86
+// the lanes are kept in registers: lanes 2j and 2j + 1 in a[j]
+template <bool product>
+__attribute__((target("sse2"))) double blocksse2(const double *x, std::size_t n)
+{
+  __m128d a0 = _mm_set1_pd(product ? 1 : 0), a1 = a0, a2 = a0, a3 = a0, a4 = a0, a5 = a0, a6 = a0, a7 = a0;
+
+  std::size_t i = 0;
+  for (; i + SIMD_LANES <= n; i += SIMD_LANES)
+  {
+    if (product)
+    {
+      a0 = _mm_mul_pd(a0, _mm_loadu_pd(x + i));
+      a1 = _mm_mul_pd(a1, _mm_loadu_pd(x + i + 2));
+      a2 = _mm_mul_pd(a2, _mm_loadu_pd(x + i + 4));
+      a3 = _mm_mul_pd(a3, _mm_loadu_pd(x + i + 6));
+      a4 = _mm_mul_pd(a4, _mm_loadu_pd(x + i + 8));
+      a5 = _mm_mul_pd(a5, _mm_loadu_pd(x + i + 10));
+      a6 = _mm_mul_pd(a6, _mm_loadu_pd(x + i + 12));
+      a7 = _mm_mul_pd(a7, _mm_loadu_pd(x + i + 14));
+    }
+    else
+    {
+      a0 = _mm_add_pd(a0, _mm_loadu_pd(x + i));
+      a1 = _mm_add_pd(a1, _mm_loadu_pd(x + i + 2));
+      a2 = _mm_add_pd(a2, _mm_loadu_pd(x + i + 4));
+      a3 = _mm_add_pd(a3, _mm_loadu_pd(x + i + 6));
+      a4 = _mm_add_pd(a4, _mm_loadu_pd(x + i + 8));
+      a5 = _mm_add_pd(a5, _mm_loadu_pd(x + i + 10));
+      a6 = _mm_add_pd(a6, _mm_loadu_pd(x + i + 12));
+      a7 = _mm_add_pd(a7, _mm_loadu_pd(x + i + 14));
+    }
+  }
+
+  double lanes[SIMD_LANES];
+  _mm_storeu_pd(lanes, a0);
+  _mm_storeu_pd(lanes + 2, a1);
+  _mm_storeu_pd(lanes + 4, a2);
+  _mm_storeu_pd(lanes + 6, a3);
+  _mm_storeu_pd(lanes + 8, a4);
+  _mm_storeu_pd(lanes + 10, a5);
+  _mm_storeu_pd(lanes + 12, a6);
+  _mm_storeu_pd(lanes + 14, a7);
+  return combine(lanes, x + i, n - i, product);
+}
+
+// lanes 4j to 4j + 3 in a[j]
+template <bool product>
+__attribute__((target("avx2"))) double blockavx2(const double *x, std::size_t n)
+{
+  __m256d a0 = _mm256_set1_pd(product ? 1 : 0), a1 = a0, a2 = a0, a3 = a0;
+
+  std::size_t i = 0;
+  for (; i + SIMD_LANES <= n; i += SIMD_LANES)
+  {
+    if (product)
+    {
+      a0 = _mm256_mul_pd(a0, _mm256_loadu_pd(x + i));
+      a1 = _mm256_mul_pd(a1, _mm256_loadu_pd(x + i + 4));
+      a2 = _mm256_mul_pd(a2, _mm256_loadu_pd(x + i + 8));
+      a3 = _mm256_mul_pd(a3, _mm256_loadu_pd(x + i + 12));
+    }
+    else
+    {
+      a0 = _mm256_add_pd(a0, _mm256_loadu_pd(x + i));
+      a1 = _mm256_add_pd(a1, _mm256_loadu_pd(x + i + 4));
+      a2 = _mm256_add_pd(a2, _mm256_loadu_pd(x + i + 8));
+      a3 = _mm256_add_pd(a3, _mm256_loadu_pd(x + i + 12));
+    }
+  }
+
+  double lanes[SIMD_LANES];
+  _mm256_storeu_pd(lanes, a0);
+  _mm256_storeu_pd(lanes + 4, a1);
+  _mm256_storeu_pd(lanes + 8, a2);
+  _mm256_storeu_pd(lanes + 12, a3);
+  _mm256_zeroupper();
+  return combine(lanes, x + i, n - i, product);
+}
+
+// the vector versions of sincosscalar, operation for operation
+
+__attribute__((target("sse2"))) void batchsse2(const double *angles, double *sines, double *cosines, std::size_t n)
+{
+  const __m128i one = _mm_set1_epi64x(1), two = _mm_set1_epi64x(2);
+  std::size_t i = 0;
+  for (; i + 2 <= n; i += 2)
+  {
+    __m128d x = _mm_loadu_pd(angles + i);
+    __m128d t = _mm_add_pd(_mm_mul_pd(x, _mm_set1_pd(TWO_OVER_PI)), _mm_set1_pd(ROUNDING));
+    __m128d q = _mm_sub_pd(t, _mm_set1_pd(ROUNDING));
+    __m128i quadrant = _mm_castpd_si128(t);
+
+    __m128d r = _mm_sub_pd(x, _mm_mul_pd(q, _mm_set1_pd(PIO2_1)));
+    r = _mm_sub_pd(r, _mm_mul_pd(q, _mm_set1_pd(PIO2_2)));
+    r = _mm_sub_pd(r, _mm_mul_pd(q, _mm_set1_pd(PIO2_3)));
+    __m128d z = _mm_mul_pd(r, r);
+
+    __m128d ps = _mm_set1_pd(S0);
+    ps = _mm_add_pd(_mm_mul_pd(ps, z), _mm_set1_pd(S1));
+    ps = _mm_add_pd(_mm_mul_pd(ps, z), _mm_set1_pd(S2));
+    ps = _mm_add_pd(_mm_mul_pd(ps, z), _mm_set1_pd(S3));
+    ps = _mm_add_pd(_mm_mul_pd(ps, z), _mm_set1_pd(S4));
+    ps = _mm_add_pd(_mm_mul_pd(ps, z), _mm_set1_pd(S5));
+    __m128d s = _mm_add_pd(r, _mm_mul_pd(_mm_mul_pd(r, z), ps));
+
+    __m128d pc = _mm_set1_pd(C0);
+    pc = _mm_add_pd(_mm_mul_pd(pc, z), _mm_set1_pd(C1));
+    pc = _mm_add_pd(_mm_mul_pd(pc, z), _mm_set1_pd(C2));
+    pc = _mm_add_pd(_mm_mul_pd(pc, z), _mm_set1_pd(C3));
+    pc = _mm_add_pd(_mm_mul_pd(pc, z), _mm_set1_pd(C4));
+    pc = _mm_add_pd(_mm_mul_pd(pc, z), _mm_set1_pd(C5));
+    __m128d c = _mm_sub_pd(_mm_set1_pd(1.0), _mm_mul_pd(_mm_set1_pd(0.5), z));
+    c = _mm_add_pd(c, _mm_mul_pd(_mm_mul_pd(z, z), pc));
+
+    __m128d swap = _mm_castsi128_pd(_mm_sub_epi64(_mm_setzero_si128(), _mm_and_si128(quadrant, one)));
+    __m128d sinsign = _mm_castsi128_pd(_mm_slli_epi64(_mm_and_si128(quadrant, two), 62));
+    __m128d cossign = _mm_castsi128_pd(_mm_slli_epi64(_mm_and_si128(_mm_add_epi64(quadrant, one), two), 62));
+    __m128d sine = _mm_or_pd(_mm_and_pd(swap, c), _mm_andnot_pd(swap, s));
+    __m128d cosine = _mm_or_pd(_mm_and_pd(swap, s), _mm_andnot_pd(swap, c));
+    _mm_storeu_pd(sines + i, _mm_xor_pd(sine, sinsign));
+    _mm_storeu_pd(cosines + i, _mm_xor_pd(cosine, cossign));
+  }
+  batchscalar(angles + i, sines + i, cosines + i, n - i);
+}
+
+__attribute__((target("avx2"))) void batchavx2(const double *angles, double *sines, double *cosines, std::size_t n)
+{
+  const __m256i one = _mm256_set1_epi64x(1), two = _mm256_set1_epi64x(2);
+  std::size_t i = 0;
+  for (; i + 4 <= n; i += 4)
+  {
+    __m256d x = _mm256_loadu_pd(angles + i);
+    __m256d t = _mm256_add_pd(_mm256_mul_pd(x, _mm256_set1_pd(TWO_OVER_PI)), _mm256_set1_pd(ROUNDING));
+    __m256d q = _mm256_sub_pd(t, _mm256_set1_pd(ROUNDING));
+    __m256i quadrant = _mm256_castpd_si256(t);
+
+    __m256d r = _mm256_sub_pd(x, _mm256_mul_pd(q, _mm256_set1_pd(PIO2_1)));
+    r = _mm256_sub_pd(r, _mm256_mul_pd(q, _mm256_set1_pd(PIO2_2)));
+    r = _mm256_sub_pd(r, _mm256_mul_pd(q, _mm256_set1_pd(PIO2_3)));
+    __m256d z = _mm256_mul_pd(r, r);
+
+    __m256d ps = _mm256_set1_pd(S0);
+    ps = _mm256_add_pd(_mm256_mul_pd(ps, z), _mm256_set1_pd(S1));
+    ps = _mm256_add_pd(_mm256_mul_pd(ps, z), _mm256_set1_pd(S2));
+    ps = _mm256_add_pd(_mm256_mul_pd(ps, z), _mm256_set1_pd(S3));
+    ps = _mm256_add_pd(_mm256_mul_pd(ps, z), _mm256_set1_pd(S4));
+    ps = _mm256_add_pd(_mm256_mul_pd(ps, z), _mm256_set1_pd(S5));
+    __m256d s = _mm256_add_pd(r, _mm256_mul_pd(_mm256_mul_pd(r, z), ps));
+
+    __m256d pc = _mm256_set1_pd(C0);
+    pc = _mm256_add_pd(_mm256_mul_pd(pc, z), _mm256_set1_pd(C1));
+    pc = _mm256_add_pd(_mm256_mul_pd(pc, z), _mm256_set1_pd(C2));
+    pc = _mm256_add_pd(_mm256_mul_pd(pc, z), _mm256_set1_pd(C3));
+    pc = _mm256_add_pd(_mm256_mul_pd(pc, z), _mm256_set1_pd(C4));
+    pc = _mm256_add_pd(_mm256_mul_pd(pc, z), _mm256_set1_pd(C5));
+    __m256d c = _mm256_sub_pd(_mm256_set1_pd(1.0), _mm256_mul_pd(_mm256_set1_pd(0.5), z));
+    c = _mm256_add_pd(c, _mm256_mul_pd(_mm256_mul_pd(z, z), pc));
+
+    __m256d swap = _mm256_castsi256_pd(_mm256_sub_epi64(_mm256_setzero_si256(), _mm256_and_si256(quadrant, one)));
+    __m256d sinsign = _mm256_castsi256_pd(_mm256_slli_epi64(_mm256_and_si256(quadrant, two), 62));
+    __m256d cossign =
+        _mm256_castsi256_pd(_mm256_slli_epi64(_mm256_and_si256(_mm256_add_epi64(quadrant, one), two), 62));
+    __m256d sine = _mm256_or_pd(_mm256_and_pd(swap, c), _mm256_andnot_pd(swap, s));
+    __m256d cosine = _mm256_or_pd(_mm256_and_pd(swap, s), _mm256_andnot_pd(swap, c));
+    _mm256_storeu_pd(sines + i, _mm256_xor_pd(sine, sinsign));
+    _mm256_storeu_pd(cosines + i, _mm256_xor_pd(cosine, cossign));
+  }
+  batchscalar(angles + i, sines + i, cosines + i, n - i);
+}
+#endif
+
+double reduce(const double *x, std::size_t n, bool product)
+{
+  if (n > SIMD_BLOCK)
+  {
+    // the first half is a whole number of lane groups
+    std::size_t half = n / 2 / SIMD_LANES * SIMD_LANES;
+    return apply(reduce(x, half, product), reduce(x + half, n - half, product), product);
+  }
+
+#ifdef SIMD_X86
+  switch (currentlevel())
+  {
+  case SimdAVX2:
+    return product ? blockavx2<true>(x, n) : blockavx2<false>(x, n);
+  case SimdSSE2:
+    return product ? blocksse2<true>(x, n) : blocksse2<false>(x, n);
+  default:
+    break;
+  }
+#endif
+  return blockscalar(x, n, product);
+}
+} // namespace
+
+SimdLevel simdsupported()
+{
+#ifdef SIMD_X86
+  __builtin_cpu_init();
+  if (__builtin_cpu_supports("avx2"))
+  {
+    return SimdAVX2;
+  }
+  if (__builtin_cpu_supports("sse2"))
+  {
+    return SimdSSE2;
+  }
+#endif
+  return SimdScalar;
+}
+
+SimdLevel simdlevel()
+{
+  return currentlevel();
+}
+
+SimdLevel setsimdlevel(SimdLevel level)
+{
+  SimdLevel supported = simdsupported();
+  currentlevel() = level < supported ? level : supported;
+  return currentlevel();
+}
+
+double pairwisesum(const double *x, std::size_t n)
+{
+  return reduce(x, n, false);
+}
+
+double pairwiseproduct(const double *x, std::size_t n)
+{
+  return reduce(x, n, true);
+}
+
+void batchsincos(const double *angles, double *sines, double *cosines, std::size_t n)
+{
+  switch (currentlevel())
+  {
+#ifdef SIMD_X86
+  case SimdAVX2:
+    batchavx2(angles, sines, cosines, n);
+    break;
+  case SimdSSE2:
+    batchsse2(angles, sines, cosines, n);
+    break;
+#endif
+  default:
+    batchscalar(angles, sines, cosines, n);
+    break;
+  }
+
+  for (std::size_t i = 0; i < n; i++)
+  {
+    if (!(std::fabs(angles[i]) <= SINCOS_LIMIT))
+    {
+      sines[i] = std::sin(angles[i]);
+      cosines[i] = std::cos(angles[i]);
+    }
+  }
+}
@@ -0,0 +1,41 @@
+#ifndef SIMD_KERNELS_HPP
+#define SIMD_KERNELS_HPP
+
+// system includes
+#include <cstddef>
+
+// Numeric kernels over contiguous arrays of doubles, with AVX2, SSE2 and
+// scalar implementations chosen at runtime for the CPU. Every implementation
+// performs the same floating point operations in the same order, so the
+// results do not depend on the CPU, only on the input.
+enum SimdLevel
+{
+  SimdScalar,
+  SimdSSE2,
+  SimdAVX2
+};
+
+// the best level the CPU supports
+SimdLevel simdsupported();
+
+// the level the kernels use, simdsupported() unless set
+SimdLevel simdlevel();
+
+// makes the kernels use level, or the best supported level below it;
+// returns the level used
+SimdLevel setsimdlevel(SimdLevel level);
+
+// The pairwise sum and product of x[0] ... x[n - 1] (0 and 1 when n is 0).
+// Blocks of up to 256 values are reduced in 16 interleaved lanes, which are
+// then combined in halves, and longer arrays are split in two recursively,
+// so the rounding error grows with log n rather than n. The result may differ
+// in its last bits from adding up the values in order.
+double pairwisesum(const double *x, std::size_t n);
+double pairwiseproduct(const double *x, std::size_t n);
+
+// sines[i] and cosines[i] of angles[i], for i < n, accurate to about 1 ulp
+// (polynomials on a Cody-Waite range reduction); angles larger than 1e6 in
+// magnitude, infinities and NaNs fall back to std::sin and std::cos
+void batchsincos(const double *angles, double *sines, double *cosines, std::size_t n);
+
+#endif
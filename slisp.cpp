@@ -1,14 +1,40 @@
 #include <cstdlib>
+#include <memory>
 #include <iostream>
 #include <string>
 #include <sstream>
 #include <fstream>
+#include <vector>
 #include "interpreter.hpp"
 #include "interpreter_semantic_error.hpp"
+#include "graphics_sink.hpp"
+#include "display_list.hpp"
+#include "trace.hpp"
 
-int shortPrograms(int argc, char **argv, Interpreter slinterp);
-int filePrograms(int argc, char **argv, Interpreter slinterp);
-int REPL(int argc, char **argv, Interpreter slinterp);
+// options given as --name=value, anywhere on the command line
+struct Options
+{
+  std::string svgfile;         // --svg=<file>: streams drawn primitives to an SVG file
+  std::string displaylistfile; // --display-list=<file>: writes drawn primitives to a display list
+  bool displaylistfloat = false; // --display-list-float: stores its coordinates as floats
+  std::string stats;             // --stats or --stats=json: prints the interpreter's statistics to stderr
+  std::string tracefile;         // --trace=<file>: writes a Chrome trace of the execution
+  TraceOptions trace;            // --trace-depth=<n>, --trace-sample=<n>: limits what is traced
+  bool profile = false;          // --profile: prints the builtin calls and symbol lookups to stderr
+  int optlevel = 0;              // --opt-level=<n>: optimization passes run before evaluation
+  bool hashcons = false;         // --hash-cons: stores identical subtrees of the program once
+  std::size_t memo = 0;          // --memo=<n>: caches the results of up to n trigonometric and geometry calls
+  bool vectorize = false;        // --vectorize: sums and multiplies wide argument lists with SIMD kernels
+  std::string loadstate;         // --load-state=<file>: restores the defines of a checkpoint before running
+  std::string savestate;         // --save-state=<file>: writes the defines to a checkpoint after running
+};
+
+std::vector<char *> parseoptions(int argc, char **argv, Options &options);
+
+int shortPrograms(int argc, char **argv, Interpreter &slinterp);
+int filePrograms(int argc, char **argv, Interpreter &slinterp);
+int REPL(int argc, char **argv, Interpreter &slinterp);
+int runmode(int argc, char **argv, Interpreter &slinterp);
 
 void printresults(Expression result);
 
@@ -17,6 +43,117 @@ int main(int argc, char **argv)
 
   Interpreter slinterp; // slisp interpreter
 
+  // separate the options from the arguments selecting the mode
+  Options options;
+  std::vector<char *> arguments = parseoptions(argc, argv, options);
+  argc = arguments.size();
+  argv = arguments.data();
+
+  if (!options.svgfile.empty() && !options.displaylistfile.empty()) // drawn primitives go to a single sink
+  {
+    std::cout << "Error" << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  std::ofstream svgstream;
+  std::unique_ptr<SvgGraphicsSink> svgsink;
+
+  if (!options.svgfile.empty())
+  {
+    svgstream.open(options.svgfile);
+
+    if (!svgstream) // if the file cannot be created
+    {
+      std::cout << "Error" << std::endl;
+      return EXIT_FAILURE;
+    }
+
+    svgsink.reset(new SvgGraphicsSink(svgstream));
+    slinterp.setGraphicsSink(svgsink.get());
+  }
+
+  DisplayListWriter displaylist(DISPLAY_LIST_INDEXED | (options.displaylistfloat ? DISPLAY_LIST_FLOAT : 0));
+
+  if (!options.displaylistfile.empty())
+  {
+    slinterp.setGraphicsSink(&displaylist);
+  }
+
+  if (options.stats == "text" || options.stats == "json")
+  {
+    slinterp.enableStats(true);
+  }
+  else if (!options.stats.empty())
+  {
+    std::cout << "Error" << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  if (!options.tracefile.empty())
+  {
+    tracestart(options.trace);
+  }
+
+  if (options.profile)
+  {
+    slinterp.enableProfile(true, &std::cerr);
+  }
+
+  slinterp.setOptLevel(options.optlevel);
+  slinterp.setHashConsing(options.hashcons);
+  slinterp.setMemoCapacity(options.memo);
+  slinterp.setVectorize(options.vectorize);
+
+  if (!options.loadstate.empty() && !slinterp.loadState(options.loadstate))
+  {
+    std::cout << "Error" << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  int status = runmode(argc, argv, slinterp);
+
+  if (!options.tracefile.empty())
+  {
+    tracestop();
+    if (!tracewrite(options.tracefile))
+    {
+      std::cout << "Error" << std::endl;
+      return EXIT_FAILURE;
+    }
+  }
+
+  // statistics go to stderr, the program's results stay alone on stdout
+  if (options.profile)
+  {
+    slinterp.getProfile().report(std::cerr);
+  }
+  if (options.stats == "text")
+  {
+    slinterp.getStats().print(std::cerr);
+  }
+  else if (options.stats == "json")
+  {
+    slinterp.getStats().printjson(std::cerr);
+  }
+
+  // the display list holds everything drawn by successful evaluations
+  if (status == EXIT_SUCCESS && !options.displaylistfile.empty() && !displaylist.write(options.displaylistfile))
+  {
+    std::cout << "Error" << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  if (status == EXIT_SUCCESS && !options.savestate.empty() && !slinterp.saveState(options.savestate))
+  {
+    std::cout << "Error" << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  return status;
+}
+
+int runmode(int argc, char **argv, Interpreter &slinterp)
+{
   // MODE 1: SHORT PROGRAMS:
 
   if (argc > 2)
@@ -41,7 +178,89 @@ int main(int argc, char **argv)
   return EXIT_SUCCESS;
 }
 
-int shortPrograms(int argc, char **argv, Interpreter slinterp)
+std::vector<char *> parseoptions(int argc, char **argv, Options &options)
+{
+  std::vector<char *> arguments;
+
+  for (int i = 0; i < argc; i++)
+  {
+    std::string arg = argv[i];
+
+    if (arg == "-e" && i + 1 < argc) // the program following -e is never an option
+    {
+      arguments.push_back(argv[i]);
+      arguments.push_back(argv[++i]);
+    }
+    else if (arg.compare(0, 6, "--svg=") == 0)
+    {
+      options.svgfile = arg.substr(6);
+    }
+    else if (arg.compare(0, 15, "--display-list=") == 0)
+    {
+      options.displaylistfile = arg.substr(15);
+    }
+    else if (arg == "--display-list-float")
+    {
+      options.displaylistfloat = true;
+    }
+    else if (arg.compare(0, 8, "--trace=") == 0)
+    {
+      options.tracefile = arg.substr(8);
+    }
+    else if (arg.compare(0, 14, "--trace-depth=") == 0)
+    {
+      options.trace.maxdepth = std::atoi(arg.c_str() + 14);
+    }
+    else if (arg.compare(0, 15, "--trace-sample=") == 0)
+    {
+      options.trace.sampleevery = std::atoi(arg.c_str() + 15);
+    }
+    else if (arg.compare(0, 12, "--opt-level=") == 0)
+    {
+      options.optlevel = std::atoi(arg.c_str() + 12);
+    }
+    else if (arg.compare(0, 13, "--load-state=") == 0)
+    {
+      options.loadstate = arg.substr(13);
+    }
+    else if (arg.compare(0, 13, "--save-state=") == 0)
+    {
+      options.savestate = arg.substr(13);
+    }
+    else if (arg.compare(0, 7, "--memo=") == 0)
+    {
+      options.memo = std::strtoul(arg.c_str() + 7, nullptr, 10);
+    }
+    else if (arg == "--vectorize")
+    {
+      options.vectorize = true;
+    }
+    else if (arg == "--hash-cons")
+    {
+      options.hashcons = true;
+    }
+    else if (arg == "--profile")
+    {
+      options.profile = true;
+    }
+    else if (arg == "--stats")
+    {
+      options.stats = "text";
+    }
+    else if (arg.compare(0, 8, "--stats=") == 0)
+    {
+      options.stats = arg.substr(8);
+    }
+    else
+    {
+      arguments.push_back(argv[i]);
+    }
+  }
+
+  return arguments;
+}
+
+int shortPrograms(int argc, char **argv, Interpreter &slinterp)
 {
   std::string arg1 = argv[1];
 
@@ -76,7 +295,7 @@ int shortPrograms(int argc, char **argv, Interpreter slinterp)
   }
 }
 
-int filePrograms(int argc, char **argv, Interpreter slinterp)
+int filePrograms(int argc, char **argv, Interpreter &slinterp)
 {
   std::string arg1 = argv[1];
 
@@ -119,7 +338,7 @@ int filePrograms(int argc, char **argv, Interpreter slinterp)
   return EXIT_FAILURE;
 }
 
-int REPL(int argc, char **argv, Interpreter slinterp)
+int REPL(int argc, char **argv, Interpreter &slinterp)
 {
   std::string exp;
 
@@ -156,9 +375,8 @@ int REPL(int argc, char **argv, Interpreter slinterp)
       {
         std::cout << "Error" << std::endl;
 
-        // reset to default state:
-        slinterp.resetenv();
-
+        // eval has rolled back the defines of the failed expression,
+        // the earlier definitions of the session are kept
         error = true;
       }
 
@@ -207,4 +425,8 @@ void printresults(Expression result)
   {
     std::cout << "((" << result.head.value.arc_value.center.x << "," << result.head.value.arc_value.center.y << ")(" << result.head.value.arc_value.start.x << "," << result.head.value.arc_value.start.y << ")(" << result.head.value.arc_value.span << "))" << std::endl;
   }
+  else if (result.head.type == NumberArrayType || result.head.type == PointArrayType)
+  {
+    std::cout << formatarray(result.head) << std::endl;
+  }
 }
\ No newline at end of file
@@ -0,0 +1,573 @@
+// Microbenchmarks of every stage of the interpreter: tokenizing, atom
+// conversion, parsing, evaluation, the builtin procedures and the environment.
+//
+// usage: slisp_bench [--filter=<substring>] [--repetitions=<n>] [--warmup-ms=<n>]
+//                    [--min-time-ms=<n>] [--json=<file>]
+//
+// Every benchmark is warmed up, calibrated so one repetition lasts at least
+// min-time-ms, then timed over the given number of repetitions. The table
+// (or the JSON written with --json) reports nanoseconds per iteration: the
+// median and the 99th percentile of the repetitions, which is the slowest
+// one below 100 repetitions.
+// Compare two JSON reports with scripts/bench_compare.py.
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <fstream>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "environment.hpp"
+#include "expression.hpp"
+#include "interpreter.hpp"
+#include "interpreter_semantic_error.hpp"
+#include "nanbox.hpp"
+#include "simd_kernels.hpp"
+#include "stats.hpp"
+#include "tokenize.hpp"
+
+typedef std::chrono::steady_clock Clock;
+
+// a benchmark body returns a value depending on its work, so it is not optimized away
+struct Benchmark
+{
+  std::string name;
+  std::function<std::size_t()> body;
+};
+
+struct BenchmarkResult
+{
+  std::string name;
+  std::size_t iterations; // per repetition
+  std::vector<double> samples; // nanoseconds per iteration, one per repetition
+  double median;
+  double p99;
+  double min;
+  double mean;
+  double allocations; // heap allocations per iteration
+};
+
+struct BenchOptions
+{
+  std::string filter;
+  std::string jsonfile;
+  // enough repetitions for a 99th percentile that is not merely the slowest
+  int repetitions = 100;
+  int warmupms = 50;
+  int mintimems = 2;
+};
+
+// every benchmark result is folded in here
+static volatile std::size_t blackhole;
+
+// a small program exercising arithmetic, comparisons, conditionals and graphics
+static const char *EVAL_PROGRAM =
+    "(begin (+ 1 2 3 4 5 6 7 8) (* 2 3 4) (- 10 4) (/ 9 3)"
+    " (if (< 1 2) (+ pi 1) (- pi 1)) (and True (not False) (>= 3 2))"
+    " (arc (point 0 0) (point 10 0) (/ pi 2)) (line (point 0 0) (point (cos 1) (sin 1)))"
+    " (pow 2 (log10 100)) (arctan 1 1))";
+
+// a program that defines symbols, like the programs in tests/
+static const char *DEFINE_PROGRAM =
+    "(begin (define a 1) (define b (+ a 1)) (define c (* a b 3))"
+    " (define p (point a b)) (define q (point b c)) (define l (line p q))"
+    " (draw p q l) (if (> c b) c b))";
+
+static double elapsedns(Clock::time_point start)
+{
+  return std::chrono::duration<double, std::nano>(Clock::now() - start).count();
+}
+
+static BenchmarkResult run(const Benchmark &benchmark, const BenchOptions &options)
+{
+  BenchmarkResult result;
+  result.name = benchmark.name;
+
+  // warm up caches and the allocator, and estimate the cost of one iteration
+  std::size_t count = 0;
+  Clock::time_point start = Clock::now();
+  do
+  {
+    blackhole = blackhole + benchmark.body();
+    count++;
+  } while (elapsedns(start) < options.warmupms * 1e6);
+  double estimate = elapsedns(start) / count;
+
+  result.iterations = std::max<std::size_t>(1, static_cast<std::size_t>(options.mintimems * 1e6 / estimate));
+
+  std::uint64_t allocations = allocationcount.load();
+  for (int r = 0; r < options.repetitions; r++)
+  {
+    start = Clock::now();
+    for (std::size_t i = 0; i < result.iterations; i++)
+    {
+      blackhole = blackhole + benchmark.body();
+    }
+    result.samples.push_back(elapsedns(start) / result.iterations);
+  }
+  result.allocations = static_cast<double>(allocationcount.load() - allocations) / (result.iterations * options.repetitions);
+
+  std::vector<double> sorted = result.samples;
+  std::sort(sorted.begin(), sorted.end());
+  std::size_t n = sorted.size();
+
+  result.median = (n % 2) ? sorted[n / 2] : (sorted[n / 2 - 1] + sorted[n / 2]) / 2;
+  // nearest-rank percentile
+  result.p99 = sorted[std::min(n - 1, static_cast<std::size_t>(std::ceil(0.99 * n)) - 1)];
+  result.min = sorted.front();
+  double sum = 0;
+  for (double s : sorted)
+  {
+    sum += s;
+  }
+  result.mean = sum / n;
+
+  return result;
+}
+
+// the argument vector of a builtin: the operator then the arguments
+static std::vector<Atom> arguments(const std::string &op, const std::vector<Expression> &args)
+{
+  std::vector<Atom> atoms;
+  atoms.push_back(Expression(op).head);
+  for (const Expression &arg : args)
+  {
+    atoms.push_back(arg.head);
+  }
+  return atoms;
+}
+
+static Benchmark procedure(const std::string &name, Procedure proc, const std::vector<Atom> &args)
+{
+  return Benchmark{"proc/" + name, [proc, args]() {
+                     return static_cast<std::size_t>(proc(args).head.type);
+                   }};
+}
+
+static std::vector<Benchmark> benchmarks()
+{
+  std::vector<Benchmark> list;
+
+  std::string program = EVAL_PROGRAM;
+  TokenSequenceType tokens;
+  {
+    std::istringstream in(program);
+    tokens = tokenize(in);
+  }
+
+  // tokenizing
+
+  list.push_back(Benchmark{"tokenize/program", [program]() {
+                             std::istringstream in(program);
+                             return tokenize(in).size();
+                           }});
+
+  // token to atom conversion, for each kind of token
+
+  const char *kinds[][2] = {{"number", "3.14159"}, {"symbol", "abc"}, {"boolean", "True"},
+                            {"operator", "+"}, {"builtin", "point"}, {"keyword", "define"}};
+  for (auto &kind : kinds)
+  {
+    std::string token = kind[1];
+    list.push_back(Benchmark{std::string("token_to_atom/") + kind[0], [token]() {
+                               Atom atom;
+                               return static_cast<std::size_t>(token_to_atom(token, atom)) + atom.type;
+                             }});
+  }
+
+  // parsing, read_from_tokens consumes its tokens so each iteration parses a copy
+
+  Interpreter parseinterp;
+  list.push_back(Benchmark{"read_from_tokens/program", [tokens, parseinterp]() mutable {
+                             TokenSequenceType copy = tokens;
+                             return parseinterp.read_from_tokens(copy).tail.size();
+                           }});
+
+  list.push_back(Benchmark{"parse/program", [program, parseinterp]() mutable {
+                             parseinterp.clearAST();
+                             std::istringstream in(program);
+                             return static_cast<std::size_t>(parseinterp.parse(in));
+                           }});
+
+  // evaluation, of an already parsed program
+
+  Interpreter evalinterp;
+  {
+    std::istringstream in(program);
+    evalinterp.parse(in);
+  }
+  list.push_back(Benchmark{"eval/program", [evalinterp]() mutable {
+                             Expression result = evalinterp.eval();
+                             evalinterp.clearGraphics();
+                             return static_cast<std::size_t>(result.head.type);
+                           }});
+
+  // the same program with its constant builtin calls folded while parsing
+  Interpreter foldinterp;
+  foldinterp.setOptLevel(1);
+  list.push_back(Benchmark{"parse/program-folded", [program, foldinterp]() mutable {
+                             foldinterp.clearAST();
+                             std::istringstream in(program);
+                             return static_cast<std::size_t>(foldinterp.parse(in));
+                           }});
+  {
+    std::istringstream in(program);
+    foldinterp.parse(in);
+  }
+  list.push_back(Benchmark{"eval/program-folded", [foldinterp]() mutable {
+                             Expression result = foldinterp.eval();
+                             foldinterp.clearGraphics();
+                             return static_cast<std::size_t>(result.head.type);
+                           }});
+
+  // a program with defines can only be evaluated once per environment
+  std::string defines = DEFINE_PROGRAM;
+  list.push_back(Benchmark{"eval/defines", [defines]() {
+                             Interpreter interp;
+                             std::istringstream in(defines);
+                             interp.parse(in);
+                             return static_cast<std::size_t>(interp.eval().head.type);
+                           }});
+
+  // the same, type checked while parsing so its builtin calls skip their checks
+  list.push_back(Benchmark{"eval/defines-checked", [defines]() {
+                             Interpreter interp;
+                             interp.setOptLevel(2);
+                             std::istringstream in(defines);
+                             interp.parse(in);
+                             return static_cast<std::size_t>(interp.eval().head.type);
+                           }});
+
+  // a templated program, whose feature flag ifs are fixed by its defines
+  std::string flags = "(begin (define debug False) (define factor 2)";
+  for (int i = 0; i < 1000; i++)
+  {
+    flags += " (if debug (draw (point 0 " + std::to_string(i) + ")) (* factor " + std::to_string(i) + "))";
+  }
+  flags += ")";
+  for (int level = 0; level <= 3; level += 3)
+  {
+    Interpreter flagsinterp;
+    flagsinterp.setOptLevel(level);
+    std::istringstream in(flags);
+    flagsinterp.parse(in);
+    list.push_back(Benchmark{level == 0 ? "eval/flags" : "eval/flags-eliminated", [flagsinterp]() mutable {
+                               flagsinterp.resetenv(); // the defines are evaluated again
+                               return static_cast<std::size_t>(flagsinterp.eval().head.type);
+                             }});
+  }
+
+  // arithmetic over numbers and defined symbols, all taken by the numeric fast path
+  std::string arithmetic = "(begin (define x 3) (define y 4)";
+  for (int i = 0; i < 1000; i++)
+  {
+    std::string n = std::to_string(i);
+    arithmetic += " (< (+ (* x x) (* y " + n + ")) (/ (- " + n + " x) (- y)))";
+  }
+  arithmetic += ")";
+  Interpreter arithinterp;
+  {
+    std::istringstream in(arithmetic);
+    arithinterp.parse(in);
+  }
+  list.push_back(Benchmark{"eval/arithmetic", [arithinterp]() mutable {
+                             arithinterp.resetenv(); // the defines are evaluated again
+                             return static_cast<std::size_t>(arithinterp.eval().head.type);
+                           }});
+
+  // a + of many calls, whose arguments are folded one at a time, and an or
+  // stopping at its second argument
+  std::string wide = "(+";
+  std::string anyof = "(or (< 1 0) (> 1 0)";
+  for (int i = 0; i < 10000; i++)
+  {
+    wide += " (sin " + std::to_string(i) + ")";
+    anyof += " (= (sin " + std::to_string(i) + ") 0)";
+  }
+  wide += ")";
+  anyof += ")";
+  for (const std::string &reduction : {wide, anyof})
+  {
+    Interpreter reduceinterp;
+    std::istringstream in(reduction);
+    reduceinterp.parse(in);
+    list.push_back(Benchmark{reduction == wide ? "eval/sum-wide" : "eval/or-wide", [reduceinterp]() mutable {
+                               return static_cast<std::size_t>(reduceinterp.eval().head.type);
+                             }});
+  }
+
+  // the SIMD kernels against the loop of add_proc and std::sin and std::cos,
+  // at every level the CPU supports
+  std::vector<Atom> addends = {Expression(std::string("+")).head};
+  std::vector<double> numbers, angles;
+  std::string table = "(+";
+  for (int i = 0; i < 10000; i++)
+  {
+    addends.push_back(Expression(i / 7.).head);
+    numbers.push_back(i / 7.);
+    table += " " + std::to_string(i);
+  }
+  table += ")";
+  for (int i = 0; i <= 256; i++)
+  {
+    angles.push_back(i * 0.0245);
+  }
+  list.push_back(procedure("+/10000", add_proc, addends));
+  list.push_back(Benchmark{"sincos/257-libm", [angles]() {
+                             double sum = 0;
+                             for (double angle : angles)
+                             {
+                               sum += std::sin(angle) + std::cos(angle);
+                             }
+                             return static_cast<std::size_t>(sum);
+                           }});
+  const char *levels[] = {"scalar", "sse2", "avx2"};
+  for (int level = SimdScalar; level <= simdsupported(); level++)
+  {
+    SimdLevel simd = static_cast<SimdLevel>(level);
+    list.push_back(Benchmark{std::string("pairwisesum/10000-") + levels[level], [numbers, simd]() {
+                               setsimdlevel(simd);
+                               double sum = pairwisesum(numbers.data(), numbers.size());
+                               setsimdlevel(simdsupported());
+                               return static_cast<std::size_t>(sum);
+                             }});
+    list.push_back(Benchmark{std::string("sincos/257-") + levels[level], [angles, simd]() {
+                               setsimdlevel(simd);
+                               std::vector<double> sines(angles.size()), cosines(angles.size());
+                               batchsincos(angles.data(), sines.data(), cosines.data(), angles.size());
+                               setsimdlevel(simdsupported());
+                               return static_cast<std::size_t>(sines.back() + cosines.back());
+                             }});
+  }
+  for (int vectorize = 0; vectorize <= 1; vectorize++)
+  {
+    Interpreter tableinterp;
+    tableinterp.setVectorize(vectorize);
+    std::istringstream in(table);
+    tableinterp.parse(in);
+    list.push_back(Benchmark{vectorize ? "eval/table-vectorized" : "eval/table", [tableinterp]() mutable {
+                               return static_cast<std::size_t>(tableinterp.eval().head.type);
+                             }});
+  }
+
+  // a parametric drawing, calling trigonometric builtins with a few recurring angles
+  std::string trig = "(begin";
+  for (int i = 0; i < 1000; i++)
+  {
+    std::string angle = std::to_string(i % 8);
+    trig += " (point (cos " + angle + ") (sin " + angle + "))";
+  }
+  trig += ")";
+  for (std::size_t capacity = 0; capacity <= 64; capacity += 64)
+  {
+    Interpreter triginterp;
+    triginterp.setMemoCapacity(capacity);
+    std::istringstream in(trig);
+    triginterp.parse(in);
+    list.push_back(Benchmark{capacity == 0 ? "eval/trig" : "eval/trig-memo", [triginterp]() mutable {
+                               return static_cast<std::size_t>(triginterp.eval().head.type);
+                             }});
+  }
+
+  // a sampled curve drawn as 10000 line forms, each evaluated and drawn on
+  // its own, against one polyline built and drawn by the array builtins
+  std::string lines = "(draw";
+  for (int i = 0; i < 10000; i++)
+  {
+    lines += " (line (point " + std::to_string(i) + " (sin " + std::to_string(i) + ")) (point " +
+             std::to_string(i + 1) + " (sin " + std::to_string(i + 1) + ")))";
+  }
+  lines += ")";
+  std::string polyline = "(begin (define xs (range 0 10001)) (draw (polyline (points-from-range xs (sin xs)))))";
+  for (const std::string &curve : {lines, polyline})
+  {
+    Interpreter curveinterp;
+    std::istringstream in(curve);
+    curveinterp.parse(in);
+    list.push_back(Benchmark{curve == lines ? "eval/lines-10000" : "eval/polyline-10000", [curveinterp]() mutable {
+                               curveinterp.clearGraphics();
+                               curveinterp.resetenv();
+                               return static_cast<std::size_t>(curveinterp.eval().head.type);
+                             }});
+  }
+
+  // a type checked sum over 100000 values: 14 MB of Atoms, 144 bytes each,
+  // against 800 kB of NaN-boxed words
+  std::vector<Atom> atoms;
+  std::vector<Boxed> boxes;
+  for (int i = 0; i < 100000; i++)
+  {
+    atoms.push_back(Expression(double(i)).head);
+    boxes.push_back(boxnumber(i));
+  }
+  list.push_back(Benchmark{"values/sum-atoms", [atoms]() {
+                             double sum = 0;
+                             for (const Atom &atom : atoms)
+                             {
+                               sum += atom.type == NumberType ? atom.value.num_value : 0;
+                             }
+                             return static_cast<std::size_t>(sum);
+                           }});
+  list.push_back(Benchmark{"values/sum-nanboxed", [boxes]() {
+                             double sum = 0;
+                             for (Boxed boxed : boxes)
+                             {
+                               sum += isnumber(boxed) ? unboxnumber(boxed) : 0;
+                             }
+                             return static_cast<std::size_t>(sum);
+                           }});
+
+  // every builtin procedure
+
+  Expression one(1.0), two(2.0), yes(true), no(false);
+  Expression p(std::make_tuple(0.0, 0.0)), q(std::make_tuple(10.0, 0.0));
+
+  list.push_back(procedure("not", not_proc, arguments("not", {no})));
+  list.push_back(procedure("and", and_proc, arguments("and", {yes, yes, yes})));
+  list.push_back(procedure("or", or_proc, arguments("or", {no, no, yes})));
+  list.push_back(procedure("<", lessthan_proc, arguments("<", {one, two})));
+  list.push_back(procedure("<=", lessthaneq_proc, arguments("<=", {one, two})));
+  list.push_back(procedure(">", greaterthan_proc, arguments(">", {one, two})));
+  list.push_back(procedure(">=", greaterthaneq_proc, arguments(">=", {one, two})));
+  list.push_back(procedure("=", equal_proc, arguments("=", {one, two})));
+  list.push_back(procedure("+", add_proc, arguments("+", {one, two, one, two})));
+  list.push_back(procedure("-", sub_proc, arguments("-", {one, two})));
+  list.push_back(procedure("*", mul_proc, arguments("*", {one, two, one, two})));
+  list.push_back(procedure("/", div_proc, arguments("/", {one, two})));
+  list.push_back(procedure("log10", Log10_proc, arguments("log10", {two})));
+  list.push_back(procedure("pow", pow_proc, arguments("pow", {two, two})));
+  list.push_back(procedure("point", point_proc, arguments("point", {one, two})));
+  list.push_back(procedure("line", line_proc, arguments("line", {p, q})));
+  list.push_back(procedure("arc", arc_proc, arguments("arc", {p, q, one})));
+  list.push_back(procedure("sin", sin_proc, arguments("sin", {one})));
+  list.push_back(procedure("cos", cos_proc, arguments("cos", {one})));
+  list.push_back(procedure("arctan", arctan_proc, arguments("arctan", {one, two})));
+
+  // the environment
+
+  list.push_back(Benchmark{"environment/construct", []() {
+                             Environment env;
+                             return static_cast<std::size_t>(env.check("pi"));
+                           }});
+
+  Environment env;
+  list.push_back(Benchmark{"environment/searchProc", [env]() mutable {
+                             return reinterpret_cast<std::size_t>(env.searchProc("arctan"));
+                           }});
+  list.push_back(Benchmark{"environment/searchExp", [env]() mutable {
+                             return static_cast<std::size_t>(env.searchExp("pi").head.type);
+                           }});
+  list.push_back(Benchmark{"environment/check", [env]() mutable {
+                             return static_cast<std::size_t>(env.check("undefined"));
+                           }});
+
+  Interpreter resetinterp;
+  list.push_back(Benchmark{"interpreter/resetenv", [resetinterp]() mutable {
+                             resetinterp.resetenv();
+                             return static_cast<std::size_t>(1);
+                           }});
+
+  return list;
+}
+
+static void printjson(std::ostream &out, const std::vector<BenchmarkResult> &results, const BenchOptions &options)
+{
+  out << std::setprecision(6) << std::fixed;
+  out << "{\n  \"repetitions\": " << options.repetitions << ",\n  \"benchmarks\": [";
+  for (std::size_t i = 0; i < results.size(); i++)
+  {
+    const BenchmarkResult &r = results[i];
+    out << (i ? ",\n" : "\n") << "    {\"name\": \"" << r.name << "\", \"iterations\": " << r.iterations
+        << ", \"median_ns\": " << r.median << ", \"p99_ns\": " << r.p99 << ", \"min_ns\": " << r.min
+        << ", \"mean_ns\": " << r.mean << ", \"allocations\": " << r.allocations << "}";
+  }
+  out << "\n  ]\n}\n";
+}
+
+static bool parseoptions(int argc, char **argv, BenchOptions &options)
+{
+  for (int i = 1; i < argc; i++)
+  {
+    std::string arg = argv[i];
+    std::string::size_type eq = arg.find('=');
+    std::string name = arg.substr(0, eq);
+    std::string value = (eq == std::string::npos) ? "" : arg.substr(eq + 1);
+
+    if (name == "--filter")
+    {
+      options.filter = value;
+    }
+    else if (name == "--json")
+    {
+      options.jsonfile = value;
+    }
+    else if (name == "--repetitions")
+    {
+      options.repetitions = std::atoi(value.c_str());
+    }
+    else if (name == "--warmup-ms")
+    {
+      options.warmupms = std::atoi(value.c_str());
+    }
+    else if (name == "--min-time-ms")
+    {
+      options.mintimems = std::atoi(value.c_str());
+    }
+    else
+    {
+      return false;
+    }
+  }
+  return options.repetitions > 0 && options.warmupms >= 0 && options.mintimems > 0;
+}
+
+int main(int argc, char **argv)
+{
+  BenchOptions options;
+  if (!parseoptions(argc, argv, options))
+  {
+    std::cerr << "usage: slisp_bench [--filter=<substring>] [--repetitions=<n>] [--warmup-ms=<n>]"
+                 " [--min-time-ms=<n>] [--json=<file>]"
+              << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  std::vector<BenchmarkResult> results;
+
+  std::cout << std::left << std::setw(32) << "benchmark" << std::right << std::setw(12) << "median ns"
+            << std::setw(12) << "p99 ns" << std::setw(12) << "allocs" << std::setw(12) << "iterations" << std::endl;
+
+  for (const Benchmark &benchmark : benchmarks())
+  {
+    if (benchmark.name.find(options.filter) == std::string::npos)
+    {
+      continue;
+    }
+
+    BenchmarkResult result = run(benchmark, options);
+    results.push_back(result);
+
+    std::cout << std::left << std::setw(32) << result.name << std::right << std::fixed << std::setprecision(1)
+              << std::setw(12) << result.median << std::setw(12) << result.p99 << std::setw(12)
+              << result.allocations << std::setw(12) << result.iterations << std::endl;
+  }
+
+  if (!options.jsonfile.empty())
+  {
+    std::ofstream out(options.jsonfile);
+    printjson(out, results, options);
+    if (!out)
+    {
+      std::cerr << "Error: could not write " << options.jsonfile << std::endl;
+      return EXIT_FAILURE;
+    }
+  }
+
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,122 @@
+// Generates synthetic slisp programs for benchmarking and stress testing.
+//
+// usage: slisp_gen [--kind=nesting|begin|defines|add|scene] [--seed=<n>]
+//                  [--size=<n> | --bytes=<n>[k|m|g]] [--depth=<n>] [--output=<file>]
+//
+// The program is streamed to the output file (standard output by default),
+// so multi-gigabyte programs are generated in constant memory.
+
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <string>
+
+#include "workload_generator.hpp"
+
+// reads a count with an optional k, m or g (binary) suffix
+static bool parsecount(const std::string &text, std::uint64_t &count)
+{
+  if (text.empty())
+  {
+    return false;
+  }
+
+  char *end = nullptr;
+  count = std::strtoull(text.c_str(), &end, 10);
+
+  std::string suffix = end;
+  if (suffix == "k" || suffix == "K")
+  {
+    count <<= 10;
+  }
+  else if (suffix == "m" || suffix == "M")
+  {
+    count <<= 20;
+  }
+  else if (suffix == "g" || suffix == "G")
+  {
+    count <<= 30;
+  }
+  else if (!suffix.empty() || end == text.c_str())
+  {
+    return false;
+  }
+  return true;
+}
+
+static bool parseoptions(int argc, char **argv, WorkloadOptions &options, std::string &output)
+{
+  for (int i = 1; i < argc; i++)
+  {
+    std::string arg = argv[i];
+    std::string::size_type eq = arg.find('=');
+    std::string name = arg.substr(0, eq);
+    std::string value = (eq == std::string::npos) ? "" : arg.substr(eq + 1);
+    std::uint64_t count;
+
+    if (name == "--kind")
+    {
+      if (!parseworkloadkind(value, options.kind))
+      {
+        return false;
+      }
+    }
+    else if (name == "--seed" && parsecount(value, count))
+    {
+      options.seed = static_cast<std::uint32_t>(count);
+    }
+    else if (name == "--size" && parsecount(value, count))
+    {
+      options.size = count;
+    }
+    else if (name == "--bytes" && parsecount(value, count))
+    {
+      options.bytes = count;
+    }
+    else if (name == "--depth" && parsecount(value, count))
+    {
+      options.depth = static_cast<unsigned>(count);
+    }
+    else if (name == "--output" && !value.empty())
+    {
+      output = value;
+    }
+    else
+    {
+      return false;
+    }
+  }
+  return true;
+}
+
+int main(int argc, char **argv)
+{
+  WorkloadOptions options;
+  std::string output;
+
+  if (!parseoptions(argc, argv, options, output))
+  {
+    std::cerr << "usage: slisp_gen [--kind=nesting|begin|defines|add|scene] [--seed=<n>]"
+                 " [--size=<n> | --bytes=<n>[k|m|g]] [--depth=<n>] [--output=<file>]"
+              << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  if (output.empty())
+  {
+    generateworkload(std::cout, options);
+    return std::cout ? EXIT_SUCCESS : EXIT_FAILURE;
+  }
+
+  std::ofstream out(output, std::ios::binary);
+  if (out)
+  {
+    generateworkload(out, options);
+  }
+  if (!out)
+  {
+    std::cerr << "Error: could not write " << output << std::endl;
+    return EXIT_FAILURE;
+  }
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,439 @@
+// Searches for slisp programs whose cost grows faster than their length, and
+// checks a corpus of such programs against a linear cost budget.
+//
+// usage: slisp_stress [--seeds=<dir>] [--corpus=<dir>] [--rounds=<n>] [--keep=<n>]
+//                     [--max-bytes=<n>] [--min-bytes=<n>] [--seed=<n>]
+//        slisp_stress --check=<dir> [--max-allocs-per-byte=<x>] [--max-ns-ratio=<x>]
+//
+// The search mutates the programs of the seeds directory (tests/ by default)
+// and generated workloads, keeps the inputs with the most heap allocations
+// per byte, and saves the best of them to the corpus directory. The check
+// mode evaluates every .slp file of a directory and fails if one costs more
+// than the given allocations per input byte, or more than the given multiple
+// of the nanoseconds per byte of a generated program of linear cost.
+//
+// Costs are measured above those of an empty program, so the fixed price of
+// a fresh interpreter is not counted, and divided by at least --min-bytes so
+// that tiny programs do not dominate the ranking.
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include <dirent.h>
+
+#include "interpreter.hpp"
+#include "interpreter_semantic_error.hpp"
+#include "stats.hpp"
+#include "workload_generator.hpp"
+
+struct StressOptions
+{
+  std::string seeds = "tests";
+  std::string corpus = "tests/perf_corpus";
+  std::string check;
+  unsigned rounds = 200;
+  unsigned keep = 8;
+  std::size_t maxbytes = 8192;
+  std::size_t minbytes = 256;
+  std::uint32_t seed = 1;
+
+  // linear budget of the check mode; the corpus cost about 11 allocations per
+  // byte while evaluate copied its subtrees, and under 1 since
+  double maxallocsperbyte = 2;
+
+  // the time per byte is compared with that of a generated begin of random
+  // expressions, measured by the same build on the same machine; the corpus
+  // costs up to about 1.5 times as much, and 15 times while the numeric fast
+  // path was retried at every level of a failing chain
+  double maxnsratio = 4;
+};
+
+struct Cost
+{
+  double ns;
+  double allocations;
+};
+
+// cost of evaluating an empty program, and the least size costs are divided by
+static Cost overhead = {0, 0};
+static std::size_t minbytes = 1;
+
+struct Input
+{
+  std::string program;
+  Cost cost;
+
+  double allocsperbyte() const
+  {
+    return std::max(0.0, cost.allocations - overhead.allocations) / std::max(minbytes, program.size());
+  }
+
+  double nsperbyte() const
+  {
+    return std::max(0.0, cost.ns - overhead.ns) / std::max(minbytes, program.size());
+  }
+};
+
+// parses and evaluates program in a fresh interpreter, the fastest of a few runs
+static Cost measure(const std::string &program)
+{
+  Cost best = {0, 0};
+
+  for (int run = 0; run < 3; run++)
+  {
+    std::uint64_t allocations = allocationcount.load();
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    {
+      Interpreter interp;
+      std::istringstream in(program);
+      if (interp.parse(in))
+      {
+        try
+        {
+          interp.eval();
+        }
+        catch (const InterpreterSemanticError &e)
+        {
+          // failing programs are measured too
+        }
+      }
+    }
+    double ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+
+    Cost cost = {ns, static_cast<double>(allocationcount.load() - allocations)};
+    if (run == 0 || cost.ns < best.ns)
+    {
+      best = cost;
+    }
+  }
+  return best;
+}
+
+// the .slp files of a directory, sorted by name
+static std::vector<std::string> slpfiles(const std::string &dir)
+{
+  std::vector<std::string> files;
+  DIR *d = opendir(dir.c_str());
+  if (d == nullptr)
+  {
+    return files;
+  }
+  for (struct dirent *entry = readdir(d); entry != nullptr; entry = readdir(d))
+  {
+    std::string name = entry->d_name;
+    if (name.size() > 4 && name.compare(name.size() - 4, 4, ".slp") == 0)
+    {
+      files.push_back(dir + "/" + name);
+    }
+  }
+  closedir(d);
+  std::sort(files.begin(), files.end());
+  return files;
+}
+
+static std::string readfile(const std::string &path)
+{
+  std::ifstream in(path, std::ios::binary);
+  std::ostringstream text;
+  text << in.rdbuf();
+  return text.str();
+}
+
+class Mutator
+{
+public:
+  Mutator(std::uint32_t seed) : random(seed)
+  {
+  }
+
+  std::string mutate(const std::string &program, const std::string &other)
+  {
+    std::vector<std::pair<std::size_t, std::size_t>> lists = sublists(program);
+    if (lists.empty())
+    {
+      return "(begin " + program + ")";
+    }
+    std::pair<std::size_t, std::size_t> list = lists[pick(lists.size())];
+    std::string sub = program.substr(list.first, list.second - list.first);
+
+    switch (pick(6))
+    {
+    case 0: // nest a list one level deeper
+      return program.substr(0, list.first) + "(begin " + sub + ")" + program.substr(list.second);
+    case 1: // repeat a list
+      return program.substr(0, list.second) + " " + sub + program.substr(list.second);
+    case 2: // comment lines before a list
+      return program.substr(0, list.first) + ";" + std::string(pick(40), 'c') + "\n" + program.substr(list.first);
+    case 3: // blank lines and spaces before a list
+      return program.substr(0, list.first) + std::string(1 + pick(8), pick(2) ? '\n' : ' ') + program.substr(list.first);
+    case 4: // wrap the whole program
+      return "(begin " + program + ")";
+    default: // splice a list of another input after this one
+    {
+      std::vector<std::pair<std::size_t, std::size_t>> others = sublists(other);
+      if (others.empty())
+      {
+        return program;
+      }
+      std::pair<std::size_t, std::size_t> o = others[pick(others.size())];
+      return program.substr(0, list.second) + " " + other.substr(o.first, o.second - o.first) +
+             program.substr(list.second);
+    }
+    }
+  }
+
+  std::size_t pick(std::size_t n)
+  {
+    return std::uniform_int_distribution<std::size_t>(0, n - 1)(random);
+  }
+
+private:
+  // the [begin, end) spans of every balanced parenthesized list
+  static std::vector<std::pair<std::size_t, std::size_t>> sublists(const std::string &program)
+  {
+    std::vector<std::pair<std::size_t, std::size_t>> lists;
+    std::vector<std::size_t> open;
+    bool comment = false;
+    for (std::size_t i = 0; i < program.size(); i++)
+    {
+      char c = program[i];
+      if (comment)
+      {
+        comment = (c != '\n' && c != '\r');
+      }
+      else if (c == ';')
+      {
+        comment = true;
+      }
+      else if (c == '(')
+      {
+        open.push_back(i);
+      }
+      else if (c == ')' && !open.empty())
+      {
+        lists.push_back(std::make_pair(open.back(), i + 1));
+        open.pop_back();
+      }
+    }
+    return lists;
+  }
+
+  std::mt19937 random;
+};
+
+static bool sortbycost(const Input &a, const Input &b)
+{
+  return a.allocsperbyte() > b.allocsperbyte();
+}
+
+static int search(const StressOptions &options)
+{
+  std::vector<Input> population;
+
+  for (const std::string &file : slpfiles(options.seeds))
+  {
+    std::string program = readfile(file);
+    population.push_back(Input{program, measure(program)});
+  }
+
+  const WorkloadKind kinds[] = {NestingWorkload, WideBeginWorkload, DefinesWorkload, WideAddWorkload, SceneWorkload};
+  for (WorkloadKind kind : kinds)
+  {
+    WorkloadOptions workload;
+    workload.kind = kind;
+    workload.seed = options.seed;
+    workload.size = 8;
+    std::ostringstream out;
+    generateworkload(out, workload);
+    population.push_back(Input{out.str(), measure(out.str())});
+  }
+
+  if (population.empty())
+  {
+    std::cerr << "Error: no seed programs" << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  Mutator mutator(options.seed);
+
+  for (unsigned round = 0; round < options.rounds; round++)
+  {
+    std::sort(population.begin(), population.end(), sortbycost);
+    if (population.size() > 4 * options.keep)
+    {
+      population.resize(4 * options.keep);
+    }
+
+    // mutants of the costliest inputs, that are still small enough
+    std::size_t parents = population.size();
+    for (std::size_t i = 0; i < parents; i++)
+    {
+      // population grows below, so the parents are not referenced across push_back
+      std::string child = mutator.mutate(population[i].program, population[mutator.pick(parents)].program);
+      if (child.size() <= options.maxbytes)
+      {
+        population.push_back(Input{child, measure(child)});
+      }
+    }
+  }
+
+  std::sort(population.begin(), population.end(), sortbycost);
+
+  std::cout << std::setw(8) << "bytes" << std::setw(16) << "allocs/byte" << std::setw(12) << "ns/byte" << std::endl;
+  for (unsigned i = 0; i < options.keep && i < population.size(); i++)
+  {
+    const Input &input = population[i];
+    std::ostringstream name;
+    name << options.corpus << "/stress_" << std::setw(2) << std::setfill('0') << i << ".slp";
+
+    std::ofstream out(name.str(), std::ios::binary);
+    out << input.program;
+    if (!out)
+    {
+      std::cerr << "Error: could not write " << name.str() << std::endl;
+      return EXIT_FAILURE;
+    }
+
+    std::cout << std::setw(8) << input.program.size() << std::fixed << std::setprecision(2) << std::setw(16)
+              << input.allocsperbyte() << std::setw(12) << input.nsperbyte() << "  " << name.str() << std::endl;
+  }
+  return EXIT_SUCCESS;
+}
+
+static int check(const StressOptions &options)
+{
+  std::vector<std::string> files = slpfiles(options.check);
+  if (files.empty())
+  {
+    std::cerr << "Error: no .slp files in " << options.check << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  WorkloadOptions workload;
+  workload.kind = WideBeginWorkload;
+  workload.seed = options.seed;
+  workload.bytes = options.maxbytes;
+  std::ostringstream generated;
+  generateworkload(generated, workload);
+  Input reference = {generated.str(), measure(generated.str())};
+  double maxnsperbyte = options.maxnsratio * reference.nsperbyte();
+
+  std::cout << "     " << std::setw(8) << reference.program.size() << " bytes" << std::fixed << std::setprecision(2)
+            << std::setw(10) << reference.allocsperbyte() << " allocs/byte" << std::setw(10) << reference.nsperbyte()
+            << " ns/byte  (reference)" << std::endl;
+
+  int failures = 0;
+  for (const std::string &file : files)
+  {
+    std::string program = readfile(file);
+    Input input = {program, measure(program)};
+
+    bool ok = input.allocsperbyte() <= options.maxallocsperbyte && input.nsperbyte() <= maxnsperbyte;
+    failures += !ok;
+
+    std::cout << (ok ? "ok   " : "FAIL ") << std::setw(8) << program.size() << " bytes" << std::fixed
+              << std::setprecision(2) << std::setw(10) << input.allocsperbyte() << " allocs/byte" << std::setw(10)
+              << input.nsperbyte() << " ns/byte  " << file << std::endl;
+  }
+
+  if (failures)
+  {
+    std::cout << failures << " input(s) over the budget of " << options.maxallocsperbyte << " allocs/byte and "
+              << maxnsperbyte << " ns/byte (" << options.maxnsratio << " times the reference)" << std::endl;
+    return EXIT_FAILURE;
+  }
+  return EXIT_SUCCESS;
+}
+
+static bool parseoptions(int argc, char **argv, StressOptions &options)
+{
+  for (int i = 1; i < argc; i++)
+  {
+    std::string arg = argv[i];
+    std::string::size_type eq = arg.find('=');
+    std::string name = arg.substr(0, eq);
+    std::string value = (eq == std::string::npos) ? "" : arg.substr(eq + 1);
+
+    if (value.empty())
+    {
+      return false;
+    }
+    else if (name == "--seeds")
+    {
+      options.seeds = value;
+    }
+    else if (name == "--corpus")
+    {
+      options.corpus = value;
+    }
+    else if (name == "--check")
+    {
+      options.check = value;
+    }
+    else if (name == "--rounds")
+    {
+      options.rounds = std::atoi(value.c_str());
+    }
+    else if (name == "--keep")
+    {
+      options.keep = std::atoi(value.c_str());
+    }
+    else if (name == "--max-bytes")
+    {
+      options.maxbytes = std::atoi(value.c_str());
+    }
+    else if (name == "--min-bytes")
+    {
+      options.minbytes = std::atoi(value.c_str());
+    }
+    else if (name == "--seed")
+    {
+      options.seed = std::atoi(value.c_str());
+    }
+    else if (name == "--max-allocs-per-byte")
+    {
+      options.maxallocsperbyte = std::atof(value.c_str());
+    }
+    else if (name == "--max-ns-ratio")
+    {
+      options.maxnsratio = std::atof(value.c_str());
+    }
+    else
+    {
+      return false;
+    }
+  }
+  return options.keep > 0;
+}
+
+int main(int argc, char **argv)
+{
+  StressOptions options;
+  if (!parseoptions(argc, argv, options))
+  {
+    std::cerr << "usage: slisp_stress [--seeds=<dir>] [--corpus=<dir>] [--rounds=<n>] [--keep=<n>]"
+                 " [--max-bytes=<n>] [--min-bytes=<n>] [--seed=<n>]\n"
+                 "       slisp_stress --check=<dir> [--max-allocs-per-byte=<x>] [--max-ns-ratio=<x>]"
+              << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  if (!allocationsCounted())
+  {
+    std::cerr << "Error: slisp_stress must be linked with alloc_hooks.cpp" << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  overhead = measure("");
+  minbytes = std::max<std::size_t>(1, options.minbytes);
+
+  return options.check.empty() ? search(options) : check(options);
+}
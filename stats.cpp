@@ -0,0 +1,110 @@
+#include "stats.hpp"
+
+// system includes
+#include <chrono>
+#include <ctime>
+#include <iomanip>
+
+std::atomic<std::uint64_t> allocationcount(0);
+std::atomic<std::uint64_t> allocationbytes(0);
+
+// set by alloc_hooks.cpp when it is linked in
+bool allocationhooks = false;
+
+bool allocationsCounted()
+{
+  return allocationhooks;
+}
+
+static double wallseconds()
+{
+  return std::chrono::duration<double>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+static double cpuseconds()
+{
+  return static_cast<double>(std::clock()) / CLOCKS_PER_SEC;
+}
+
+PhaseTimer::PhaseTimer(PhaseStats *phase) : phase(phase)
+{
+  if (phase != nullptr)
+  {
+    wall = wallseconds();
+    cpu = cpuseconds();
+    allocations = allocationcount.load(std::memory_order_relaxed);
+    allocatedbytes = allocationbytes.load(std::memory_order_relaxed);
+  }
+}
+
+PhaseTimer::~PhaseTimer()
+{
+  if (phase != nullptr)
+  {
+    phase->wall += wallseconds() - wall;
+    phase->cpu += cpuseconds() - cpu;
+    phase->allocations += allocationcount.load(std::memory_order_relaxed) - allocations;
+    phase->allocatedbytes += allocationbytes.load(std::memory_order_relaxed) - allocatedbytes;
+    phase->runs++;
+  }
+}
+
+static void printphase(std::ostream &out, const char *name, const PhaseStats &phase)
+{
+  out << std::left << std::setw(10) << name << std::right << std::fixed << std::setprecision(3)
+      << std::setw(12) << phase.wall * 1e3 << std::setw(12) << phase.cpu * 1e3
+      << std::setw(14) << phase.allocations << std::setw(16) << phase.allocatedbytes << std::endl;
+}
+
+void Stats::print(std::ostream &out) const
+{
+  out << std::left << std::setw(10) << "phase" << std::right << std::setw(12) << "wall ms" << std::setw(12)
+      << "cpu ms" << std::setw(14) << "allocations" << std::setw(16) << "allocated bytes" << std::endl;
+  printphase(out, "tokenize", tokenize);
+  printphase(out, "read", read);
+  printphase(out, "optimize", optimize);
+  printphase(out, "eval", eval);
+  printphase(out, "graphics", graphics);
+
+  out << "tokens: " << tokens << ", ast nodes: " << astnodes << ", max depth: " << maxdepth
+      << ", environment size: " << envsize << ", primitives: " << primitives << ", folded: " << folded
+      << ", checked: " << checked << ", eliminated: " << eliminated
+      << ", shared: " << shared << ", numeric: " << numeric << std::endl;
+  if (memohits + memomisses > 0)
+  {
+    out << "memo hits: " << memohits << ", misses: " << memomisses << ", evictions: " << memoevictions
+        << ", hit rate: " << 100.0 * memohits / (memohits + memomisses) << "%" << std::endl;
+  }
+
+  if (!allocationsCounted())
+  {
+    out << "(allocations are not counted in this program)" << std::endl;
+  }
+}
+
+static void printphasejson(std::ostream &out, const char *name, const PhaseStats &phase)
+{
+  out << "\"" << name << "\": {\"wall_ms\": " << phase.wall * 1e3 << ", \"cpu_ms\": " << phase.cpu * 1e3
+      << ", \"allocations\": " << phase.allocations << ", \"allocated_bytes\": " << phase.allocatedbytes
+      << ", \"runs\": " << phase.runs << "}";
+}
+
+void Stats::printjson(std::ostream &out) const
+{
+  out << std::fixed << std::setprecision(6) << "{";
+  printphasejson(out, "tokenize", tokenize);
+  out << ", ";
+  printphasejson(out, "read", read);
+  out << ", ";
+  printphasejson(out, "optimize", optimize);
+  out << ", ";
+  printphasejson(out, "eval", eval);
+  out << ", ";
+  printphasejson(out, "graphics", graphics);
+  out << ", \"tokens\": " << tokens << ", \"ast_nodes\": " << astnodes << ", \"max_depth\": " << maxdepth
+      << ", \"environment_size\": " << envsize << ", \"primitives\": " << primitives << ", \"folded\": " << folded
+      << ", \"checked\": " << checked << ", \"eliminated\": " << eliminated << ", \"shared\": " << shared << ", \"numeric\": " << numeric
+      << ", \"memo_hits\": " << memohits << ", \"memo_misses\": " << memomisses
+      << ", \"memo_evictions\": " << memoevictions
+      << ", \"allocations_counted\": " << (allocationsCounted() ? "true" : "false") << "}" << std::endl;
+}
@@ -0,0 +1,83 @@
+#ifndef STATS_HPP
+#define STATS_HPP
+
+// system includes
+#include <atomic>
+#include <cstdint>
+#include <ostream>
+
+// Heap allocations made by the process so far. They are counted by the
+// replacement operator new of alloc_hooks.cpp, which is only linked into the
+// programs that report allocations (slisp, slisp_bench); elsewhere they stay 0.
+extern std::atomic<std::uint64_t> allocationcount;
+extern std::atomic<std::uint64_t> allocationbytes;
+
+// true when alloc_hooks.cpp is linked in
+bool allocationsCounted();
+
+// Cost of one phase of the interpreter, summed over every time it ran
+struct PhaseStats
+{
+  double wall = 0; // seconds
+  double cpu = 0;  // seconds of process CPU time
+  std::uint64_t allocations = 0;
+  std::uint64_t allocatedbytes = 0;
+  std::uint64_t runs = 0;
+};
+
+// Statistics collected by an Interpreter (see Interpreter::enableStats)
+struct Stats
+{
+  PhaseStats tokenize;
+  PhaseStats read;     // read_from_tokens, building the AST
+  PhaseStats optimize; // the optimization passes over the AST
+  PhaseStats eval;     // includes graphics
+  PhaseStats graphics; // streaming drawn primitives to the graphics sink
+
+  std::uint64_t tokens = 0;
+  std::uint64_t astnodes = 0;
+  std::uint64_t primitives = 0; // drawn points, lines, arcs and paths
+  unsigned maxdepth = 0;        // deepest recursion of evaluate
+  std::uint64_t envsize = 0;    // symbols in the environment after the last eval
+  std::uint64_t folded = 0;     // builtin calls replaced by their result before eval
+  std::uint64_t checked = 0;    // builtin calls proven well-typed before eval
+  std::uint64_t eliminated = 0; // ifs and unused expressions removed before eval
+  std::uint64_t shared = 0;     // subtrees stored once by hash-consing, then shared
+  std::uint64_t memohits = 0;   // builtin calls whose result was found in the memo cache
+  std::uint64_t memomisses = 0; // memoizable builtin calls computed, then cached
+  std::uint64_t memoevictions = 0;
+  std::uint64_t numeric = 0;    // arithmetic subtrees evaluated on doubles by the numeric fast path
+
+  void clear()
+  {
+    *this = Stats();
+  }
+
+  // writes a table of the phases followed by the counters
+  void print(std::ostream &out) const;
+
+  // writes the statistics as a JSON object
+  void printjson(std::ostream &out) const;
+};
+
+// Adds the time and allocations between its construction and destruction to
+// a phase. A null phase makes it do nothing, so it can be left in place when
+// statistics are disabled.
+class PhaseTimer
+{
+public:
+  PhaseTimer(PhaseStats *phase);
+  ~PhaseTimer();
+
+private:
+  PhaseTimer(const PhaseTimer &);
+  PhaseTimer &operator=(const PhaseTimer &);
+
+  PhaseStats *phase;
+  double wall;
+  double cpu;
+  std::uint64_t allocations;
+  std::uint64_t allocatedbytes;
+};
+
+#endif
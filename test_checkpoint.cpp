@@ -0,0 +1,139 @@
+#include "catch.hpp"
+
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <sstream>
+#include <string>
+
+#include "checkpoint.hpp"
+#include "interpreter.hpp"
+#include "interpreter_semantic_error.hpp"
+#include "test_config.hpp"
+
+// evaluates program in interp, which must succeed
+static Expression run(Interpreter &interp, const std::string &program)
+{
+  std::istringstream iss(program);
+  REQUIRE(interp.parse(iss));
+  return interp.eval();
+}
+
+TEST_CASE("Test checkpoint round trip", "[checkpoint]")
+{
+  std::string fname = "test_checkpoint.slck";
+
+  Interpreter prelude;
+  run(prelude, "(begin (define n (+ 1 2)) (define t (< 1 2)) (define p (point 1 2))"
+               " (define l (line (point -5 0) (point 5 10))) (define a (arc (point 0 0) (point 10 0) pi))"
+               " (define nested (1 2 (3 4))) (define xs (range 0 40 2))"
+               " (define ps (polygon (points-from-range xs (sin xs)))) (define empty (range 1 0)))");
+  REQUIRE(prelude.saveState(fname));
+
+  Interpreter restored;
+  REQUIRE(restored.loadState(fname));
+  REQUIRE(restored.returnenv().size() == prelude.returnenv().size());
+
+  const char *names[] = {"n", "t", "p", "l", "a", "nested", "xs", "ps", "empty"};
+  for (const char *name : names)
+  {
+    REQUIRE(restored.returnenv().searchExp(name) == prelude.returnenv().searchExp(name));
+  }
+  REQUIRE(restored.returnenv().searchExp("nested").tail.size() == 3);
+  REQUIRE(restored.returnenv().searchExp("ps").head.value.array_value.path == PathClosed);
+  REQUIRE(restored.returnenv().searchExp("ps").head.value.array_value.size() == 20);
+
+  // the restored defines are used like evaluated ones
+  Expression result = run(restored, "(+ n (arctan 0 1))");
+  REQUIRE(result.head.value.num_value == 3 + atan2(0, 1));
+
+  // restoring again would redefine every symbol, nothing is changed
+  REQUIRE_FALSE(restored.loadState(fname));
+  REQUIRE(restored.returnenv().size() == prelude.returnenv().size());
+
+  std::remove(fname.c_str());
+}
+
+TEST_CASE("Test invalid checkpoints are rejected", "[checkpoint]")
+{
+  std::string fname = "test_checkpoint_invalid.slck";
+
+  Interpreter interp;
+  REQUIRE_FALSE(interp.loadState(TEST_FILE_DIR + "/test_car.slp"));
+  REQUIRE_FALSE(interp.loadState(TEST_FILE_DIR + "/does_not_exist.slck"));
+
+  Interpreter prelude;
+  run(prelude, "(begin (define a 1) (define b (point 1 2)))");
+  std::ostringstream out;
+  REQUIRE(writecheckpoint(prelude.returnenv(), out));
+  std::string bytes = out.str();
+
+  // a truncated file fails without adding any mapping
+  std::ofstream(fname, std::ios::binary).write(bytes.data(), bytes.size() - 1);
+  REQUIRE_FALSE(interp.loadState(fname));
+  REQUIRE(interp.returnenv().size() == Environment().size());
+
+  // so does a record with an invalid type
+  std::string corrupt = bytes;
+  CheckpointRecord *record = reinterpret_cast<CheckpointRecord *>(&corrupt[sizeof(CheckpointHeader)]);
+  record->type = NullType + 1;
+  std::ofstream(fname, std::ios::binary).write(corrupt.data(), corrupt.size());
+  REQUIRE_FALSE(interp.loadState(fname));
+  REQUIRE(interp.returnenv().size() == Environment().size());
+
+  // and a binding nested deeper than the reader accepts, which would
+  // otherwise exhaust the stack; a valid one a level less deep is read
+  for (int depth = 100000; depth >= 64; depth = depth == 100000 ? 65 : depth - 1)
+  {
+    INFO(depth);
+    CheckpointHeader header;
+    std::memset(&header, 0, sizeof(header));
+    std::memcpy(header.magic, "SLCK", 4);
+    header.version = CHECKPOINT_VERSION;
+    header.bindingcount = 1;
+    header.recordcount = depth + 1;
+    header.recordoffset = sizeof(CheckpointHeader);
+    header.stringoffset = header.recordoffset + header.recordcount * sizeof(CheckpointRecord);
+    header.stringsize = 4;
+
+    // (((... 1))) with depth lists around the number, bound to deep
+    std::vector<CheckpointRecord> records(depth + 1);
+    std::memset(records.data(), 0, records.size() * sizeof(CheckpointRecord));
+    for (int i = 0; i < depth; i++)
+    {
+      records[i].type = ListType;
+      records[i].tailcount = 1;
+    }
+    records[depth].type = NumberType;
+    records[depth].values[0] = 1;
+    records[0].namelength = 4;
+
+    std::ofstream deep(fname, std::ios::binary);
+    deep.write(reinterpret_cast<const char *>(&header), sizeof(header));
+    deep.write(reinterpret_cast<const char *>(records.data()), records.size() * sizeof(CheckpointRecord));
+    deep.write("deep", 4);
+    deep.close();
+
+    Interpreter fresh;
+    REQUIRE(fresh.loadState(fname) == (depth == 64));
+  }
+
+  // the writer refuses what the reader would reject
+  Interpreter nested;
+  std::string program = "(define deep ";
+  for (int i = 0; i < 70; i++)
+  {
+    program += "(1 ";
+  }
+  program += "1" + std::string(70, ')') + ")";
+  run(nested, program);
+  std::ostringstream refused;
+  REQUIRE_FALSE(writecheckpoint(nested.returnenv(), refused));
+  REQUIRE(refused.str().empty());
+
+  std::ofstream(fname, std::ios::binary).write(bytes.data(), bytes.size());
+  REQUIRE(interp.loadState(fname));
+  REQUIRE(interp.returnenv().size() == Environment().size() + 2);
+
+  std::remove(fname.c_str());
+}
@@ -0,0 +1,319 @@
+#include "catch.hpp"
+
+#include <string>
+#include <sstream>
+#include <cstdio>
+#include <cmath>
+
+#include "interpreter_semantic_error.hpp"
+#include "interpreter.hpp"
+#include "graphics_sink.hpp"
+#include "display_list.hpp"
+#include "arc_geometry.hpp"
+#include "test_config.hpp"
+
+// counts the primitives streamed to it
+class CountingSink : public GraphicsSink
+{
+public:
+  int points = 0, lines = 0, arcs = 0, commits = 0, discards = 0;
+
+  void point(const Point &p) { points++; }
+  void line(const Line &l) { lines++; }
+  void arc(const Arc &a) { arcs++; }
+  void commit() { commits++; }
+  void discard() { discards++; }
+};
+
+TEST_CASE("Test draw streams primitives to the graphics sink", "[graphics]")
+{
+  std::string program = "(begin (draw (point 0 0) (line (point 0 0) (point 1 1))) (draw (arc (point 0 0) (point 1 0) pi)))";
+  std::istringstream iss(program);
+
+  Interpreter interp;
+  CountingSink sink;
+  interp.setGraphicsSink(&sink);
+
+  REQUIRE(interp.parse(iss));
+  interp.eval();
+
+  REQUIRE(sink.points == 1);
+  REQUIRE(sink.lines == 1);
+  REQUIRE(sink.arcs == 1);
+  REQUIRE(sink.commits == 1);
+  REQUIRE(sink.discards == 0);
+
+  // nothing was accumulated by the interpreter itself
+  REQUIRE(interp.getGraphicsatoms().empty());
+}
+
+TEST_CASE("Test the default sink drops graphics of a failed evaluation", "[graphics]")
+{
+  Interpreter interp;
+
+  std::istringstream good("(draw (point 1 2))");
+  REQUIRE(interp.parse(good));
+  interp.eval();
+  REQUIRE(interp.getGraphicsatoms().size() == 1);
+
+  std::istringstream bad("(begin (draw (point -20 0)) (define pi 3))");
+  REQUIRE(interp.parse(bad));
+  REQUIRE_THROWS_AS(interp.eval(), InterpreterSemanticError);
+  REQUIRE(interp.getGraphicsatoms().size() == 1);
+  REQUIRE(interp.getGraphicsatoms()[0].value.point_value.x == 1);
+  REQUIRE(interp.getGraphicsatoms()[0].value.point_value.y == 2);
+
+  interp.clearGraphics();
+  REQUIRE(interp.getGraphicsatoms().empty());
+}
+
+TEST_CASE("Test SVG graphics sink", "[graphics]")
+{
+  std::ostringstream oss;
+  {
+    SvgGraphicsSink sink(oss);
+    sink.point(Point{1, 2});
+    sink.line(Line{Point{0, 0}, Point{3, 4}});
+    sink.arc(Arc{Point{0, 0}, Point{10, 0}, atan2(0, -1)});
+  }
+
+  std::string svg = oss.str();
+  REQUIRE(svg.find("<svg") == 0);
+  REQUIRE(svg.find("<circle cx=\"1\" cy=\"2\"") != std::string::npos);
+  REQUIRE(svg.find("<line x1=\"0\" y1=\"0\" x2=\"3\" y2=\"4\"") != std::string::npos);
+  REQUIRE(svg.find("<path d=\"M 10 0 A 10 10 0 0 0") != std::string::npos);
+  REQUIRE(svg.find("</svg>") == svg.size() - 7);
+}
+
+TEST_CASE("Test drawing arrays", "[graphics]")
+{
+  std::string program = "(begin (define xs (range 0 100)) (define ps (points-from-range xs (sin xs)))"
+                        " (draw ps (polyline ps) (polygon (point 0 0) (point 1 0) (point 1 1))))";
+
+  // sinks without a path primitive get the points and the segments
+  Interpreter interp;
+  interp.enableStats(true);
+  CountingSink sink;
+  interp.setGraphicsSink(&sink);
+  std::istringstream iss(program);
+  REQUIRE(interp.parse(iss));
+  interp.eval();
+  REQUIRE(sink.points == 100);
+  REQUIRE(sink.lines == 99 + 3);
+
+  // the points are counted one by one, each path once
+  REQUIRE(interp.getStats().primitives == 100 + 1 + 1);
+
+  // the default sink keeps each drawn array as a single atom
+  Interpreter kept;
+  std::istringstream again(program);
+  REQUIRE(kept.parse(again));
+  kept.eval();
+  REQUIRE(kept.getGraphicsatoms().size() == 3);
+  REQUIRE(kept.getGraphicsatoms()[1].type == PointArrayType);
+
+  std::ostringstream oss;
+  {
+    SvgGraphicsSink svg(oss);
+    std::vector<Number> x = {0, 3, 3}, y = {0, 0, 4};
+    svg.polyline(x.data(), y.data(), 3, false);
+    svg.polyline(x.data(), y.data(), 3, true);
+  }
+  REQUIRE(oss.str().find("<polyline points=\"0,0 3,0 3,4\"") != std::string::npos);
+  REQUIRE(oss.str().find("<polygon points=\"0,0 3,0 3,4\"") != std::string::npos);
+}
+
+// collects the primitives replayed from a display list
+class CollectingSink : public GraphicsSink
+{
+public:
+  std::vector<Point> points;
+  std::vector<Line> lines;
+  std::vector<Arc> arcs;
+
+  void point(const Point &p) { points.push_back(p); }
+  void line(const Line &l) { lines.push_back(l); }
+  void arc(const Arc &a) { arcs.push_back(a); }
+};
+
+TEST_CASE("Test display list round trip", "[graphics]")
+{
+  std::string fname = "test_display_list.sldl";
+
+  std::string program = "(begin (draw (point 1 2) (line (point -5 0) (point 5 10))) (draw (arc (point 0 0) (point 10 0) pi)))";
+  std::istringstream iss(program);
+
+  Interpreter interp;
+  DisplayListWriter writer;
+  interp.setGraphicsSink(&writer);
+
+  REQUIRE(interp.parse(iss));
+  interp.eval();
+
+  // a failed evaluation adds nothing to the list
+  std::istringstream bad("(begin (draw (point 100 100)) (define pi 3))");
+  REQUIRE(interp.parse(bad));
+  REQUIRE_THROWS_AS(interp.eval(), InterpreterSemanticError);
+
+  REQUIRE(writer.write(fname));
+
+  DisplayList list;
+  REQUIRE(list.open(fname));
+  REQUIRE(list.indexed());
+  REQUIRE(list.pointCount() == 1);
+  REQUIRE(list.lineCount() == 1);
+  REQUIRE(list.arcCount() == 1);
+
+  REQUIRE((list.point(0) == Point{1, 2}));
+  REQUIRE((list.line(0).second == Point{5, 10}));
+  REQUIRE(list.arc(0).span == atan2(0, -1));
+
+  Bounds b = list.bounds();
+  REQUIRE(b.minx == -10);
+  REQUIRE(b.miny == -10);
+  REQUIRE(b.maxx == 10);
+  REQUIRE(b.maxy == 10);
+
+  CollectingSink all;
+  list.replay(all);
+  REQUIRE(all.points.size() == 1);
+  REQUIRE(all.lines.size() == 1);
+  REQUIRE(all.arcs.size() == 1);
+
+  std::remove(fname.c_str());
+}
+
+TEST_CASE("Test display list spatial queries match a full scan", "[graphics]")
+{
+  std::string fname = "test_display_list_index.sldl";
+
+  DisplayListWriter indexed(DISPLAY_LIST_INDEXED | DISPLAY_LIST_FLOAT);
+  for (int i = 0; i < 50; i++)
+  {
+    for (int j = 0; j < 50; j++)
+    {
+      indexed.point(Point{i * 10.0, j * 10.0});
+      indexed.line(Line{Point{i * 10.0, j * 10.0}, Point{i * 10.0 + 25, j * 10.0 + 3}});
+    }
+    indexed.arc(Arc{Point{i * 10.0, 0}, Point{i * 10.0 + 7, 0}, 1.5});
+  }
+  indexed.commit();
+  REQUIRE(indexed.write(fname));
+
+  DisplayList list;
+  REQUIRE(list.open(fname));
+  REQUIRE(list.indexed());
+  REQUIRE(list.pointCount() == 2500);
+
+  Bounds area = {95, 95, 203, 148};
+
+  CollectingSink fromindex;
+  list.replay(fromindex, area);
+
+  // count the expected primitives by testing every one of them
+  int points = 0, lines = 0, arcs = 0;
+  for (std::uint64_t i = 0; i < list.pointCount(); i++)
+  {
+    Bounds p = primitivebounds(list.point(i));
+    points += (p.minx <= area.maxx && area.minx <= p.maxx && p.miny <= area.maxy && area.miny <= p.maxy);
+  }
+  for (std::uint64_t i = 0; i < list.lineCount(); i++)
+  {
+    Bounds l = primitivebounds(list.line(i));
+    lines += (l.minx <= area.maxx && area.minx <= l.maxx && l.miny <= area.maxy && area.miny <= l.maxy);
+  }
+  for (std::uint64_t i = 0; i < list.arcCount(); i++)
+  {
+    Bounds a = primitivebounds(list.arc(i));
+    arcs += (a.minx <= area.maxx && area.minx <= a.maxx && a.miny <= area.maxy && area.miny <= a.maxy);
+  }
+
+  REQUIRE(points > 0);
+  REQUIRE(fromindex.points.size() == points);
+  REQUIRE(fromindex.lines.size() == lines);
+  REQUIRE(fromindex.arcs.size() == arcs);
+
+  std::remove(fname.c_str());
+}
+
+TEST_CASE("Test invalid display lists are rejected", "[graphics]")
+{
+  DisplayList list;
+  REQUIRE_FALSE(list.open(TEST_FILE_DIR + "/test_car.slp"));
+  REQUIRE_FALSE(list.open(TEST_FILE_DIR + "/does_not_exist.sldl"));
+  REQUIRE(list.pointCount() == 0);
+}
+
+TEST_CASE("Test arc flattening stays within tolerance", "[graphics]")
+{
+  Arc a;
+  a.center = Point{10, -5};
+  a.start = Point{110, -5};
+  a.span = 3 * std::atan2(0, -1) / 2;
+
+  for (double tolerance : {2.0, 0.5, 0.01})
+  {
+    std::vector<Point> polyline = flattenarc(a, tolerance);
+    REQUIRE(polyline.size() >= 2);
+    REQUIRE(polyline.size() == static_cast<std::size_t>(arcsegments(100, a.span, tolerance) + 1));
+
+    // the ends are the ends of the arc, a positive span turns counter-clockwise on screen
+    REQUIRE(polyline.front().x == 110);
+    REQUIRE(polyline.front().y == -5);
+    REQUIRE(std::fabs(polyline.back().x - 10) < 1e-9);
+    REQUIRE(std::fabs(polyline.back().y - 95) < 1e-9);
+
+    // every vertex is on the arc and every chord midpoint within tolerance of it
+    for (std::size_t i = 0; i + 1 < polyline.size(); i++)
+    {
+      double x = (polyline[i].x + polyline[i + 1].x) / 2;
+      double y = (polyline[i].y + polyline[i + 1].y) / 2;
+      REQUIRE(std::fabs(std::hypot(polyline[i].x - 10, polyline[i].y + 5) - 100) < 1e-9);
+      REQUIRE(100 - std::hypot(x - 10, y + 5) <= tolerance);
+    }
+  }
+
+  // finer tolerances and larger arcs take more segments, tiny arcs a single one
+  REQUIRE(arcsegments(100, 1, 0.1) > arcsegments(100, 1, 1));
+  REQUIRE(arcsegments(1000, 1, 1) > arcsegments(100, 1, 1));
+  REQUIRE(arcsegments(0.1, 6, 0.5) == 1);
+  REQUIRE(arcsegments(100, 0, 0.5) == 1);
+}
+
+TEST_CASE("Test arc tessellation cache", "[graphics]")
+{
+  ArcTessellationCache cache(2);
+
+  Arc a;
+  a.center = Point{0, 0};
+  a.start = Point{50, 0};
+  a.span = 1;
+
+  std::size_t segments = cache.tessellate(a, 1, 0.5).size();
+  REQUIRE(cache.misses() == 1);
+  REQUIRE(cache.hits() == 0);
+
+  // a translated copy, and a slightly different zoom, reuse the entry
+  Arc b = a;
+  b.center = Point{100, 200};
+  b.start = Point{150, 200};
+  const std::vector<Point> &relative = cache.tessellate(b, 1.05, 0.5);
+  REQUIRE(cache.hits() == 1);
+  REQUIRE(relative.size() == segments);
+  REQUIRE(relative.front().x == 50);
+  REQUIRE(relative.front().y == 0);
+
+  // zooming in by a lot needs a new, finer polyline
+  REQUIRE(cache.tessellate(a, 16, 0.5).size() > segments);
+  REQUIRE(cache.misses() == 2);
+  REQUIRE(cache.size() == 2);
+
+  // the cache never grows past its capacity
+  Arc c = a;
+  c.span = 2;
+  cache.tessellate(c, 1, 0.5);
+  REQUIRE(cache.size() <= 2);
+
+  cache.clear();
+  REQUIRE(cache.size() == 0);
+}
@@ -24,6 +24,7 @@ private slots:
   void testPoint();
   void testLine();
   void testArc();
+  void testPath();
   void testEnvRestore();
   void testMessage();
   void cleanupTestCase();
@@ -85,7 +86,7 @@ void TestGUI::testREPLGood()
   // check message
   QVERIFY2(messageEdit->isReadOnly(),
            "Expected QLineEdit inside MessageWidget to be read-only.");
-  QCOMPARE(messageEdit->text(), QString("(1)"));
+  QTRY_COMPARE(messageEdit->text(), QString("(1)"));
 }
 
 void TestGUI::testREPLBad()
@@ -101,7 +102,7 @@ void TestGUI::testREPLBad()
   // check message
   QVERIFY2(messageEdit->isReadOnly(),
            "Expected QLineEdit inside MessageWidget to be read-only.");
-  QVERIFY2(messageEdit->text().startsWith("Error"), "Expected error message.");
+  QTRY_VERIFY2(messageEdit->text().startsWith("Error"), "Expected error message.");
 
   // check background color and selection
   QPalette p = messageEdit->palette();
@@ -123,7 +124,7 @@ void TestGUI::testREPLBad2Good()
   // check message
   QVERIFY2(messageEdit->isReadOnly(),
            "Expected QLineEdit inside MessageWidget to be read-only.");
-  QVERIFY2(messageEdit->text().startsWith("Error"), "Expected error message.");
+  QTRY_VERIFY2(messageEdit->text().startsWith("Error"), "Expected error message.");
 
   // check background color and selection
   QPalette p = messageEdit->palette();
@@ -138,7 +139,7 @@ void TestGUI::testREPLBad2Good()
   // check message
   QVERIFY2(messageEdit->isReadOnly(),
            "Expected QLineEdit inside MessageWidget to be read-only.");
-  QCOMPARE(messageEdit->text(), QString("(100)"));
+  QTRY_COMPARE(messageEdit->text(), QString("(100)"));
 
   // check background color and selection
   p = messageEdit->palette();
@@ -201,6 +202,29 @@ void TestGUI::testArc()
   qDebug() << temp->boundingRect();
 }
 
+void TestGUI::testPath()
+{
+
+  QVERIFY(repl && replEdit);
+  QVERIFY(canvas && scene);
+
+  // send a string to the repl widget
+  QTest::keyClicks(replEdit, "(draw (polyline (point 200 200) (point 300 200) (point 300 300)) "
+                             "(polygon (point 200 400) (point 300 400) (point 300 500)))");
+  QTest::keyClick(replEdit, Qt::Key_Return, Qt::NoModifier);
+
+  // check canvas: each path is a single item
+  QList<QGraphicsItem *> open = scene->items(QRectF(190, 190, 120, 120));
+  QCOMPARE(open.size(), 1);
+  QVERIFY2(qgraphicsitem_cast<QGraphicsPathItem *>(open[0]) != 0,
+           "Expected the polyline as a single path item.");
+
+  QList<QGraphicsItem *> closed = scene->items(QRectF(190, 390, 120, 120));
+  QCOMPARE(closed.size(), 1);
+  QVERIFY2(qgraphicsitem_cast<QGraphicsPolygonItem *>(closed[0]) != 0,
+           "Expected the polygon as a single polygon item.");
+}
+
 void TestGUI::testEnvRestore()
 {
 
@@ -252,30 +276,30 @@ void TestGUI::testHistory()
 
   QTest::keyClicks(replEdit, "(+ b 2)");
   QTest::keyClick(replEdit, Qt::Key_Return, Qt::NoModifier);
-  QCOMPARE(messageEdit->text(), QString("(3)"));
+  QTRY_COMPARE(messageEdit->text(), QString("(3)"));
 
   QTest::keyClicks(replEdit, "(+ 3 2)");
   QTest::keyClick(replEdit, Qt::Key_Return, Qt::NoModifier);
-  QCOMPARE(messageEdit->text(), QString("(5)"));
+  QTRY_COMPARE(messageEdit->text(), QString("(5)"));
 
   QTest::keyClicks(replEdit, "(- 10 2)");
   QTest::keyClick(replEdit, Qt::Key_Return, Qt::NoModifier);
-  QCOMPARE(messageEdit->text(), QString("(8)"));
+  QTRY_COMPARE(messageEdit->text(), QString("(8)"));
 
   QTest::keyClick(replEdit, Qt::Key_Up, Qt::NoModifier);
   QTest::keyClick(replEdit, Qt::Key_Up, Qt::NoModifier);
   QTest::keyClick(replEdit, Qt::Key_Up, Qt::NoModifier);
   QTest::keyClick(replEdit, Qt::Key_Down, Qt::NoModifier);
   QTest::keyClick(replEdit, Qt::Key_Return, Qt::NoModifier);
-  QCOMPARE(messageEdit->text(), QString("(5)"));
+  QTRY_COMPARE(messageEdit->text(), QString("(5)"));
 
   QTest::keyClicks(replEdit, "(point 1 1)");
   QTest::keyClick(replEdit, Qt::Key_Return, Qt::NoModifier);
-  QCOMPARE(messageEdit->text(), QString("(1,1)"));
+  QTRY_COMPARE(messageEdit->text(), QString("(1,1)"));
 
   QTest::keyClicks(replEdit, "(line (point 2 1) (point 3 2))");
   QTest::keyClick(replEdit, Qt::Key_Return, Qt::NoModifier);
-  QCOMPARE(messageEdit->text(), QString("((2,1)(3,2))"));
+  QTRY_COMPARE(messageEdit->text(), QString("((2,1)(3,2))"));
 
   // QTest::keyClicks(replEdit, "(arc (point -300 -300) (point -275 -300) (/ pi 8))");
   // QTest::keyClick(replEdit, Qt::Key_Return, Qt::NoModifier);
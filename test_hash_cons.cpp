@@ -0,0 +1,152 @@
+#include "catch.hpp"
+
+#include <fstream>
+#include <set>
+#include <sstream>
+#include <string>
+
+#include "hash_cons.hpp"
+#include "interpreter.hpp"
+#include "test_config.hpp"
+
+static Expression parsed(const std::string &program, bool hashconsing, int level = 0)
+{
+  Interpreter interp;
+  interp.setHashConsing(hashconsing);
+  interp.setOptLevel(level);
+  std::istringstream iss(program);
+  REQUIRE(interp.parse(iss));
+  return interp.returnast();
+}
+
+// adds the tail storage of every list in exp to storages
+static void collectstorages(const Expression &exp, std::set<const void *> &storages)
+{
+  if (exp.tail.empty())
+  {
+    return;
+  }
+  storages.insert(exp.tail.storage());
+  for (const Expression &e : exp.tail)
+  {
+    collectstorages(e, storages);
+  }
+}
+
+TEST_CASE("Test structural hashing of expressions", "[hash_cons]")
+{
+  std::hash<Expression> hash;
+  Expression a = parsed("(line (point 0 0) (point 1 pi))", false);
+  Expression b = parsed("(line (point 0 0) (point 1 pi))", false);
+  Expression c = parsed("(line (point 0 0) (point 1 2))", false);
+
+  REQUIRE(identical(a, b));
+  REQUIRE(hash(a) == hash(b));
+  REQUIRE(!identical(a, c));
+  REQUIRE(hash(a) != hash(c));
+
+  // operator== only compares the heads
+  REQUIRE(a == c);
+  REQUIRE(!identical(Expression(1.), Expression(true)));
+  REQUIRE(identical(Expression(std::make_tuple(0., 1.)), Expression(std::make_tuple(0., 1.))));
+}
+
+TEST_CASE("Test copies of an expression share their tail until changed", "[hash_cons]")
+{
+  Expression a = parsed("(+ 1 (* 2 3))", false);
+  Expression b = a;
+  const Expression &c = b;
+  REQUIRE(a.tail.shares(c.tail));
+  REQUIRE(c.tail[2].tail.shares(a.tail[2].tail));
+
+  b.tail[2].tail[1] = Expression(5.);
+  REQUIRE(!a.tail.shares(b.tail));
+  REQUIRE(a.tail[2].tail[1] == Expression(2.));
+  REQUIRE(b.tail[2].tail[1] == Expression(5.));
+  // the unchanged subtrees are still shared
+  REQUIRE(a.tail[1].tail.shares(b.tail[1].tail));
+
+  b.tail.clear();
+  REQUIRE(b.tail.empty());
+  REQUIRE(a.tail.size() == 3);
+}
+
+TEST_CASE("Test the hash-consing parser", "[hash_cons]")
+{
+  std::string program = "(begin (draw (point 0 0)) (draw (point 0 0)) (line (point 0 0) (point 0 1)))";
+  Expression ast = parsed(program, true);
+  const Expression &cast = ast;
+  REQUIRE(cast.tail[1].tail.shares(cast.tail[2].tail));
+  REQUIRE(cast.tail[1].tail[1].tail.shares(cast.tail[3].tail[1].tail));
+  REQUIRE(!cast.tail[3].tail[1].tail.shares(cast.tail[3].tail[2].tail));
+  REQUIRE(identical(ast, parsed(program, false)));
+
+  Interpreter interp;
+  interp.enableStats(true);
+  interp.setHashConsing(true);
+  std::istringstream iss(program);
+  REQUIRE(interp.parse(iss));
+  REQUIRE(interp.getStats().shared == 3); // two (point 0 0) and a (draw (point 0 0))
+
+  HashConsTable table;
+  Expression leaf(1.);
+  REQUIRE(table.intern(leaf) == leaf);
+  REQUIRE(table.size() == 0);
+
+  // the optimization passes only change their own copy of a shared subtree
+  interp.setOptLevel(2);
+  std::istringstream iss2("(begin (if False (* (+ a 1) 2) 0) (define a 1) (* (+ a 1) 2))");
+  REQUIRE(interp.parse(iss2));
+  const Expression &checked = interp.returnast();
+  REQUIRE(!checked.tail[1].tail[2].tail[1].checked);
+  REQUIRE(checked.tail[3].tail[1].checked);
+  REQUIRE(interp.eval() == Expression(4.));
+}
+
+TEST_CASE("Test the optimized AST stays shared", "[hash_cons]")
+{
+  std::string program = "(begin (define a 1) (define b 2)";
+  for (int i = 0; i < 200; i++)
+  {
+    program += " (draw (line (point 0 0) (point a b)))";
+  }
+  program += ")";
+
+  // the begin, a draw, a line, the two points, and the two defines
+  for (int level = 0; level <= 3; level++)
+  {
+    INFO(level);
+    std::set<const void *> storages;
+    collectstorages(parsed(program, true, level), storages);
+    REQUIRE(storages.size() <= 7);
+  }
+}
+
+TEST_CASE("Test hash-consing does not change results", "[hash_cons]")
+{
+  const char *files[] = {"test2.slp", "test3.slp", "test4.slp", "test5.slp", "test_car.slp",
+                         "test_arc.slp", "test_line.slp", "test_point.slp", "test_crlf.slp"};
+  for (const char *file : files)
+  {
+    INFO(file);
+    std::string fname = TEST_FILE_DIR + "/" + file;
+    Expression results[2];
+    std::vector<Atom> drawn[2];
+    for (int i = 0; i < 2; i++)
+    {
+      Interpreter interp;
+      interp.setHashConsing(i == 1);
+      interp.setOptLevel(3 * i);
+      std::ifstream ifs(fname);
+      REQUIRE(interp.parse(ifs));
+      results[i] = interp.eval();
+      drawn[i] = interp.getGraphicsatoms();
+    }
+    REQUIRE(results[0] == results[1]);
+    REQUIRE(drawn[0].size() == drawn[1].size());
+    for (std::size_t i = 0; i < drawn[0].size(); i++)
+    {
+      REQUIRE(Expression(drawn[0][i]) == Expression(drawn[1][i]));
+    }
+  }
+}
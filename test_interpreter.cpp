@@ -4,6 +4,8 @@
 #include <sstream>
 #include <fstream>
 #include <iostream>
+#include <cmath>
+#include <cstring>
 
 #include "interpreter_semantic_error.hpp"
 #include "interpreter.hpp"
@@ -101,6 +103,15 @@ TEST_CASE("Test Interpreter parser with truncated input", "[interpreter]")
     bool ok = interp.parse(iss);
     REQUIRE(ok == false);
   }
+
+  {
+    std::string program = "((f 1) (g 2)";
+    std::istringstream iss(program);
+
+    Interpreter interp;
+    bool ok = interp.parse(iss);
+    REQUIRE(ok == false);
+  }
 }
 
 TEST_CASE("Test Interpreter parser with extra input", "[interpreter]")
@@ -391,7 +402,9 @@ TEST_CASE("Test some semantically invalid expresions", "[interpreter]")
   std::vector<std::string> programs = {"(@ none)",          // so such procedure
                                        "(- 1 1 2)",         // too many arguments
                                        "(define if 1)",     // redefine special form
-                                       "(define pi 3.14)"}; // redefine builtin symbol
+                                       "(define pi 3.14)",  // redefine builtin symbol
+                                       "(begin)",           // nothing to evaluate
+                                       "(+ 1 begin)"};      // special form as an argument
   for (auto s : programs)
   {
     Interpreter interp;
@@ -495,3 +508,344 @@ TEST_CASE("Test all syntactically and semantically CORRECT files.", "[interprete
     REQUIRE(result == expected_result);
   }
 }
+
+TEST_CASE("Test interpreter statistics", "[interpreter]")
+{
+  std::string program = "(begin (define a 1) (draw (point a 2) (point 3 4)) (+ a (* 2 3)))";
+
+  Interpreter interp;
+
+  // nothing is collected unless enabled
+  std::istringstream off(program);
+  REQUIRE(interp.parse(off));
+  REQUIRE(interp.getStats().tokens == 0);
+  REQUIRE(interp.getStats().astnodes == 0);
+
+  interp.enableStats(true);
+
+  std::istringstream iss(program);
+  REQUIRE(interp.parse(iss));
+
+  const Stats &stats = interp.getStats();
+  REQUIRE(stats.tokens == 30);
+  REQUIRE(stats.astnodes == 23); // 7 lists and 16 atoms
+  REQUIRE(stats.tokenize.runs == 1);
+  REQUIRE(stats.read.runs == 1);
+  REQUIRE(stats.read.wall >= 0);
+
+  REQUIRE_NOTHROW(interp.eval());
+  REQUIRE(stats.eval.runs == 1);
+  REQUIRE(stats.graphics.runs == 2);
+  REQUIRE(stats.primitives == 2);
+  REQUIRE(stats.maxdepth == 4); // begin, draw, point, a
+  REQUIRE(stats.envsize == interp.returnenv().size());
+  REQUIRE(stats.eval.wall >= stats.graphics.wall);
+
+  // a failed evaluation is still accounted for
+  interp.clearStats();
+  std::istringstream bad("(define a 2)");
+  REQUIRE(interp.parse(bad));
+  REQUIRE_THROWS_AS(interp.eval(), InterpreterSemanticError);
+  REQUIRE(interp.getStats().eval.runs == 1);
+
+  std::ostringstream text, json;
+  interp.getStats().print(text);
+  interp.getStats().printjson(json);
+  REQUIRE(text.str().find("eval") != std::string::npos);
+  REQUIRE(json.str().find("\"eval\": {\"wall_ms\": ") != std::string::npos);
+  REQUIRE(json.str().find("\"allocations_counted\": false") != std::string::npos);
+}
+
+TEST_CASE("Test builtin profile", "[interpreter]")
+{
+  std::string program = "(begin (define a 1) (define b (+ a a 1)) (point (+ a b) (* a b)))";
+
+  Interpreter interp;
+  std::istringstream off(program);
+  REQUIRE(interp.parse(off));
+  REQUIRE_NOTHROW(interp.eval());
+  REQUIRE(interp.getProfile().builtins.empty());
+
+  Interpreter profiled;
+  std::ostringstream report;
+  profiled.enableProfile(true, &report);
+
+  std::istringstream iss(program);
+  REQUIRE(profiled.parse(iss));
+  REQUIRE_NOTHROW(profiled.eval());
+
+  const Profile &profile = profiled.getProfile();
+  REQUIRE(profile.builtins.size() == 3);
+  REQUIRE(profile.builtins.at("+").calls == 2);
+  REQUIRE(profile.builtins.at("+").arguments == 5);
+  REQUIRE(profile.builtins.at("*").calls == 1);
+  REQUIRE(profile.builtins.at("point").calls == 1);
+
+  // point's inclusive time holds the + and * evaluated as its arguments
+  REQUIRE(profile.builtins.at("point").time >= profile.builtins.at("*").time);
+
+  REQUIRE(profile.lookups.at("a") == 4);
+  REQUIRE(profile.lookups.at("b") == 2);
+
+  // (profile-report) writes the profile, sorted
+  std::istringstream reportprogram("(profile-report)");
+  REQUIRE(profiled.parse(reportprogram));
+  REQUIRE(profiled.eval().head.type == NoneType);
+  REQUIRE(report.str().find("point") < report.str().find("*"));
+  REQUIRE(report.str().find("lookups") != std::string::npos);
+
+  std::istringstream bad("(profile-report 1)");
+  REQUIRE(profiled.parse(bad));
+  REQUIRE_THROWS_AS(profiled.eval(), InterpreterSemanticError);
+}
+
+TEST_CASE("Test failed evaluations roll back their defines", "[interpreter]")
+{
+  Interpreter interp;
+  std::size_t defaults = interp.returnenv().size();
+
+  std::istringstream first("(define a 1)");
+  REQUIRE(interp.parse(first));
+  REQUIRE_NOTHROW(interp.eval());
+
+  // b and c are defined before the error, they are undone but a is kept
+  std::istringstream failing("(begin (define b 2) (define c (+ a b)) (define d (+ c x)))");
+  REQUIRE(interp.parse(failing));
+  REQUIRE_THROWS_AS(interp.eval(), InterpreterSemanticError);
+
+  Environment env = interp.returnenv();
+  REQUIRE(env.size() == defaults + 1);
+  REQUIRE(env.check("a"));
+  REQUIRE_FALSE(env.check("b"));
+  REQUIRE_FALSE(env.check("c"));
+
+  // the undone symbols can be defined again
+  std::istringstream again("(begin (define b 3) (+ a b))");
+  REQUIRE(interp.parse(again));
+  Expression result = interp.eval();
+  REQUIRE(result.head.type == NumberType);
+  REQUIRE(result.head.value.num_value == 4);
+  REQUIRE(interp.returnenv().size() == defaults + 2);
+}
+
+TEST_CASE("Test the numeric fast path", "[interpreter]")
+{
+  std::string programs[] = {"(+ 1 2 3 4)",
+                            "(- 7)",
+                            "(/ (- 1 (* 3 7)) (+ 3 (- 8 2)))",
+                            "(begin (define x 3) (define y 7) (/ (* x (+ y 1 x)) (- y (+ x 11))))",
+                            "(begin (define x 1) (/ x 0))",
+                            "(begin (define x 2) (< (* x x) (+ x x 1)))",
+                            "(begin (define x 2) (= (/ 1 3) (/ x 6)))",
+                            "(>= (/ 10 4) 2)"};
+
+  for (const std::string &program : programs)
+  {
+    INFO(program);
+
+    // the profile takes the usual path, through the builtin procedures
+    Interpreter generic;
+    generic.enableProfile(true);
+    std::istringstream in(program);
+    REQUIRE(generic.parse(in));
+    Expression expected = generic.eval();
+
+    Interpreter interp;
+    interp.enableStats(true);
+    std::istringstream iss(program);
+    REQUIRE(interp.parse(iss));
+    Expression result = interp.eval();
+
+    REQUIRE(interp.getStats().numeric >= 1);
+    REQUIRE(result.head.type == expected.head.type);
+    if (result.head.type == NumberType)
+    {
+      // bit-identical, not merely equal
+      REQUIRE(std::memcmp(&result.head.value.num_value, &expected.head.value.num_value, sizeof(double)) == 0);
+    }
+    else
+    {
+      REQUIRE(result.head.value.bool_value == expected.head.value.bool_value);
+    }
+  }
+
+  // a symbol that is not a number falls back to the builtin, and its error
+  Interpreter interp;
+  interp.enableStats(true);
+  std::istringstream boolean("(begin (define b True) (+ 1 b))");
+  REQUIRE(interp.parse(boolean));
+  REQUIRE_THROWS_AS(interp.eval(), InterpreterSemanticError);
+  REQUIRE(interp.getStats().numeric == 0);
+
+  std::istringstream undefined("(* 2 z)");
+  REQUIRE(interp.parse(undefined));
+  REQUIRE_THROWS_AS(interp.eval(), InterpreterSemanticError);
+
+  std::istringstream point("(begin (define p (point 1 2)) (* 2 p))");
+  REQUIRE(interp.parse(point));
+  REQUIRE_THROWS_AS(interp.eval(), InterpreterSemanticError);
+
+  // a failing chain of nested calls falls back once, and the next
+  // evaluation takes the fast path again
+  std::istringstream chain("(begin (define b True) (< (+ 1 (* 2 (- 3 (/ 4 b)))) 5))");
+  REQUIRE(interp.parse(chain));
+  REQUIRE_THROWS_AS(interp.eval(), InterpreterSemanticError);
+  REQUIRE(interp.getStats().numeric == 0);
+
+  std::istringstream after("(< (+ 1 (* 2 (- 3 (/ 4 2)))) 5)");
+  REQUIRE(interp.parse(after));
+  Expression result = interp.eval();
+  REQUIRE(result.head.type == BooleanType);
+  REQUIRE(result.head.value.bool_value == true);
+  REQUIRE(interp.getStats().numeric == 1);
+}
+
+TEST_CASE("Test streaming reductions", "[interpreter]")
+{
+  // a sum of many arguments folded one at a time is bit-identical to add_proc
+  std::string program = "(+";
+  std::vector<Atom> args = {Expression(std::string("+")).head};
+  for (int i = 0; i < 1000; i++)
+  {
+    program += " (sin " + std::to_string(i) + ")";
+    args.push_back(Expression(std::sin(double(i))).head);
+  }
+  program += ")";
+  Expression sum = run(program);
+  Expression expected = add_proc(args);
+  REQUIRE(std::memcmp(&sum.head.value.num_value, &expected.head.value.num_value, sizeof(double)) == 0);
+
+  args[0] = Expression(std::string("*")).head;
+  program[1] = '*';
+  Expression product = run(program);
+  expected = mul_proc(args);
+  REQUIRE(std::memcmp(&product.head.value.num_value, &expected.head.value.num_value, sizeof(double)) == 0);
+
+  // and and or stop at the first argument that decides them
+  REQUIRE(run("(and True False (+ 1 True))") == Expression(false));
+  REQUIRE(run("(or False True (define a 1))") == Expression(true));
+  REQUIRE(run("(and True (< 1 2) (not False))") == Expression(true));
+  REQUIRE(run("(or False (> 1 2) False)") == Expression(false));
+
+  Interpreter interp;
+  std::ostringstream report;
+  interp.enableProfile(true, &report);
+  std::istringstream shortcircuit("(begin (or True (define a 1)) (and True True True))");
+  REQUIRE(interp.parse(shortcircuit));
+  REQUIRE(interp.eval() == Expression(true));
+  REQUIRE_FALSE(interp.returnenv().check("a"));
+  REQUIRE(interp.getProfile().builtins.at("or").arguments == 1);
+  REQUIRE(interp.getProfile().builtins.at("and").arguments == 3);
+
+  // the first argument of the wrong type raises the error of the procedure
+  std::string errors[][2] = {{"(+ 1 (sin 1) True (point 1 2))", "Invalid Type! + only works on Number arguments/atoms"},
+                             {"(* (sin 1) 2 False)", "Invalid Type! * only works on Number arguments/atoms"},
+                             {"(and True 1 False)", "Invalid Type! AND only works on Boolean arguments/atoms"},
+                             {"(or False (sin 1))", "Invalid Type! OR only works on Boolean arguments/atoms"},
+                             {"(or (sin 1))", "OR is m-ary. At least 2 arguments are required"}};
+  for (auto &error : errors)
+  {
+    INFO(error[0]);
+    std::istringstream iss(error[0]);
+    REQUIRE(interp.parse(iss));
+    try
+    {
+      interp.eval();
+      FAIL("no error raised");
+    }
+    catch (const InterpreterSemanticError &e)
+    {
+      REQUIRE(std::string(e.what()) == error[1]);
+    }
+  }
+}
+
+TEST_CASE("Test array values", "[interpreter]")
+{
+  Expression xs = run("(range 0 5)");
+  REQUIRE(xs.head.type == NumberArrayType);
+  REQUIRE(xs.head.value.array_value.data->x == std::vector<Number>({0, 1, 2, 3, 4}));
+  REQUIRE(run("(range 4 0 -1)").head.value.array_value.data->x == std::vector<Number>({4, 3, 2, 1}));
+  REQUIRE(run("(range 0 (/ 1 2) (/ 1 8))").head.value.array_value.data->x == std::vector<Number>({0, 0.125, 0.25, 0.375}));
+  REQUIRE(run("(range 0 5 -1)").head.value.array_value.size() == 0);
+  REQUIRE(formatarray(xs.head) == "(0 1 2 3 4)");
+
+  // sin and cos map a NumberArray element by element, bit-identical to sin
+  // and cos of each element
+  Expression sines = run("(sin (range -100 100))");
+  Expression cosines = run("(cos (range -100 100))");
+  REQUIRE(sines.head.type == NumberArrayType);
+  REQUIRE(cosines.head.value.array_value.size() == 200);
+  for (int i = -100; i < 100; i++)
+  {
+    INFO(i);
+    Number sine = run("(sin " + std::to_string(i) + ")").head.value.num_value;
+    Number cosine = run("(cos " + std::to_string(i) + ")").head.value.num_value;
+    REQUIRE(std::memcmp(&sines.head.value.array_value.data->x[i + 100], &sine, sizeof(Number)) == 0);
+    REQUIRE(std::memcmp(&cosines.head.value.array_value.data->x[i + 100], &cosine, sizeof(Number)) == 0);
+  }
+
+  // a Number is used for every point
+  Expression points = run("(points-from-range (range 0 3) 7)");
+  REQUIRE(points.head.type == PointArrayType);
+  REQUIRE(points.head.value.array_value.path == PathPoints);
+  REQUIRE(formatarray(points.head) == "((0,7)(1,7)(2,7))");
+
+  Expression polygon = run("(polygon (point 0 0) (point 2 0) (point 2 1))");
+  REQUIRE(polygon.head.value.array_value.path == PathClosed);
+  REQUIRE(run("(polyline (points-from-range (range 0 3) 7))").head.value.array_value.path == PathOpen);
+
+  // the transforms keep the path and map every point
+  REQUIRE(run("(translate (polygon (point 0 0) (point 2 0) (point 2 1)) 1 -1)") ==
+          pointarray({1, 3, 3}, {-1, -1, 0}, PathClosed));
+  REQUIRE(run("(scale (polyline (point 1 1) (point 2 3)) 2)") == pointarray({2, 4}, {2, 6}, PathOpen));
+  REQUIRE(run("(scale (polyline (point 1 1) (point 2 3)) 2 -1)") == pointarray({2, 4}, {-1, -3}, PathOpen));
+  Expression rotated = run("(rotate (points-from-range (range 2 3) 1) (/ pi 2) (point 1 1))");
+  REQUIRE(std::fabs(rotated.head.value.array_value.data->x[0] - 1) < 1e-15);
+  REQUIRE(std::fabs(rotated.head.value.array_value.data->y[0] - 2) < 1e-15);
+
+  // arrays are values: they can be defined, compared and folded as constants
+  for (int level = 0; level <= 3; level++)
+  {
+    INFO(level);
+    Interpreter interp;
+    interp.setOptLevel(level);
+    std::istringstream iss("(begin (define xs (range 0 4)) (define c (polyline (points-from-range xs (cos xs))))"
+                           " (scale (translate c 1 0) 2 1))");
+    REQUIRE(interp.parse(iss));
+    Expression result = interp.eval();
+    REQUIRE(result.head.type == PointArrayType);
+    REQUIRE(result.head.value.array_value.size() == 4);
+    REQUIRE(result.head.value.array_value.data->x == std::vector<Number>({2, 4, 6, 8}));
+  }
+
+  std::string errors[][2] = {
+      {"(range 0 1 0)", "Error (semantic). range has more than 16777216 elements"},
+      {"(range 0 True)", "Error (semantic). Invalid Type! range only works on Number arguments/atoms"},
+      {"(points-from-range 1 2)",
+       "Error (semantic). Invalid Type! points-from-range only works on NumberArray or Number arguments/atoms"},
+      {"(points-from-range (range 0 2) (range 0 3))",
+       "Error (semantic). points-from-range needs NumberArrays of the same size"},
+      {"(polygon (point 0 0) (point 1 1))", "Error (semantic). polygon takes a PointArray or at least 3 Points"},
+      {"(polyline (point 0 0) 1)",
+       "Error (semantic). Invalid Type! polyline only works on a PointArray or Point arguments/atoms"},
+      {"(translate (point 0 0) 1 1)",
+       "Error (semantic). Invalid Type! translate only works on a PointArray and Number arguments/atoms"},
+      {"(+ (range 0 2) 1)", "Invalid Type! + only works on Number arguments/atoms"}};
+  for (auto &error : errors)
+  {
+    INFO(error[0]);
+    Interpreter interp;
+    std::istringstream iss(error[0]);
+    REQUIRE(interp.parse(iss));
+    try
+    {
+      interp.eval();
+      FAIL("no error raised");
+    }
+    catch (const InterpreterSemanticError &e)
+    {
+      REQUIRE(std::string(e.what()) == error[1]);
+    }
+  }
+}
@@ -0,0 +1,120 @@
+#include "catch.hpp"
+
+#include <fstream>
+#include <sstream>
+#include <string>
+
+#include "environment.hpp"
+#include "interpreter.hpp"
+#include "interpreter_semantic_error.hpp"
+#include "memo_cache.hpp"
+#include "test_config.hpp"
+
+// the arguments of a unary call, the operator first
+static std::vector<Atom> unary(const std::string &op, double x)
+{
+  return {Expression(op).head, Expression(x).head};
+}
+
+TEST_CASE("Test the memo cache", "[memo_cache]")
+{
+  MemoCache cache(2);
+  REQUIRE(cache.capacity() == 2);
+  REQUIRE(cache.find(sin_proc, unary("sin", 1)) == nullptr);
+
+  cache.insert(sin_proc, unary("sin", 1), sin_proc(unary("sin", 1)));
+  cache.insert(sin_proc, unary("sin", 2), sin_proc(unary("sin", 2)));
+  REQUIRE(cache.size() == 2);
+  REQUIRE(*cache.find(sin_proc, unary("sin", 1)) == Expression(sin(1.)));
+  // the key includes the procedure
+  REQUIRE(cache.find(cos_proc, unary("cos", 1)) == nullptr);
+
+  // the clock hand passes over sin 1, found since it was inserted, and evicts sin 2
+  cache.insert(cos_proc, unary("cos", 1), cos_proc(unary("cos", 1)));
+  REQUIRE(cache.size() == 2);
+  REQUIRE(cache.evictions() == 1);
+  REQUIRE(cache.find(sin_proc, unary("sin", 2)) == nullptr);
+  REQUIRE(cache.find(sin_proc, unary("sin", 1)) != nullptr);
+  REQUIRE(*cache.find(cos_proc, unary("cos", 1)) == Expression(cos(1.)));
+  REQUIRE(cache.hits() == 3);
+  REQUIRE(cache.misses() == 3);
+
+  // copies do not share their entries
+  MemoCache copy = cache;
+  copy.clear();
+  REQUIRE(copy.find(sin_proc, unary("sin", 1)) == nullptr);
+  REQUIRE(cache.find(sin_proc, unary("sin", 1)) != nullptr);
+  copy = cache;
+  REQUIRE(copy.find(cos_proc, unary("cos", 1)) != nullptr);
+
+  MemoCache none(0);
+  none.insert(sin_proc, unary("sin", 1), Expression(0.));
+  REQUIRE(none.find(sin_proc, unary("sin", 1)) == nullptr);
+}
+
+TEST_CASE("Test memoized builtin calls", "[memo_cache]")
+{
+  REQUIRE(Environment::memoizable(sin_proc));
+  REQUIRE(Environment::memoizable(Environment::uncheckedproc("point")));
+  REQUIRE(!Environment::memoizable(add_proc));
+  REQUIRE(!Environment::memoizable(Environment::builtinproc("begin")));
+
+  Interpreter interp;
+  interp.enableStats(true);
+  interp.setMemoCapacity(16);
+  std::istringstream iss("(begin (define a (sin 1)) (+ a (sin 1) (cos 1)))");
+  REQUIRE(interp.parse(iss));
+  REQUIRE(interp.eval() == Expression(2 * sin(1.) + cos(1.)));
+  REQUIRE(interp.getStats().memohits == 1);
+  REQUIRE(interp.getStats().memomisses == 2);
+
+  // errors are raised every time, never cached
+  std::istringstream iss2("(sin True)");
+  REQUIRE(interp.parse(iss2));
+  REQUIRE_THROWS_AS(interp.eval(), InterpreterSemanticError);
+  REQUIRE_THROWS_AS(interp.eval(), InterpreterSemanticError);
+  REQUIRE(interp.getMemoCache().size() == 2);
+
+  // 0 and -0 are different keys: a result cached for one is never returned for the other
+  const char *signedzeros[][2] = {{"(begin (define a (arctan 0 -1)) (arctan (* -1 0) -1))", "-3.14159"},
+                                  {"(begin (define a (sin 0)) (/ 1 (sin (* -1 0))))", "-inf"}};
+  for (auto &program : signedzeros)
+  {
+    INFO(program[0]);
+    for (std::size_t capacity = 0; capacity <= 64; capacity += 64)
+    {
+      Interpreter memoized;
+      memoized.setMemoCapacity(capacity);
+      std::istringstream in(program[0]);
+      REQUIRE(memoized.parse(in));
+      std::ostringstream result;
+      result << memoized.eval().head.value.num_value;
+      REQUIRE(result.str() == program[1]);
+    }
+  }
+
+  // a tiny cache evicts constantly, without changing the results
+  const char *files[] = {"test4.slp", "test5.slp", "test_car.slp", "test_arc.slp", "test_line.slp"};
+  for (const char *file : files)
+  {
+    INFO(file);
+    std::string fname = TEST_FILE_DIR + "/" + file;
+    Expression results[2];
+    std::vector<Atom> drawn[2];
+    for (int i = 0; i < 2; i++)
+    {
+      Interpreter memoized;
+      memoized.setMemoCapacity(2 * i);
+      std::ifstream ifs(fname);
+      REQUIRE(memoized.parse(ifs));
+      results[i] = memoized.eval();
+      drawn[i] = memoized.getGraphicsatoms();
+    }
+    REQUIRE(results[0] == results[1]);
+    REQUIRE(drawn[0].size() == drawn[1].size());
+    for (std::size_t i = 0; i < drawn[0].size(); i++)
+    {
+      REQUIRE(Expression(drawn[0][i]) == Expression(drawn[1][i]));
+    }
+  }
+}
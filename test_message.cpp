@@ -3,6 +3,7 @@
 #include <QtWidgets>
 
 #include "message_widget.hpp"
+#include "message_log_model.hpp"
 
 class TestMessage : public QObject {
   Q_OBJECT
@@ -12,6 +13,9 @@ private slots:
 
   void initTestCase();
   void testConstructor();
+  void testMessages();
+  void testLogIsBounded();
+  void testBurst();
   
 private:
 
@@ -38,6 +42,89 @@ void TestMessage::testConstructor() {
   QCOMPARE(messageEdit->text(), QString(""));
 }
 
+void TestMessage::testMessages() {
+
+  MessageWidget widget;
+  QLineEdit *edit = widget.findChild<QLineEdit *>();
+  QVERIFY(edit);
+
+  // the line edit and the log are updated on the next frame
+  MessageLogModel *log = widget.messageLog();
+  widget.info("(1)");
+  QCOMPARE(edit->text(), QString(""));
+  QCOMPARE(log->rowCount(), 0);
+  QTRY_COMPARE(edit->text(), QString("(1)"));
+
+  widget.error("Error: bad");
+  QTRY_COMPARE(edit->text(), QString("Error: bad"));
+  QCOMPARE(edit->selectedText(), QString("Error: bad"));
+  QCOMPARE(edit->palette().highlight().color(), QColor(Qt::red));
+  widget.info("(2)");
+  QTRY_COMPARE(edit->text(), QString("(2)"));
+  QCOMPARE(edit->selectedText(), QString(""));
+
+  QCOMPARE(log->rowCount(), 3);
+  QCOMPARE(log->data(log->index(0)).toString(), QString("(1)"));
+  QCOMPARE(log->data(log->index(1), Qt::ForegroundRole).value<QBrush>().color(), QColor(Qt::red));
+  QVERIFY(!log->data(log->index(2), Qt::ForegroundRole).isValid());
+
+  // messages of the same frame only show the last one
+  widget.info("(3)");
+  widget.error("Error: worse");
+  widget.info("(4)");
+  QTRY_COMPARE(log->rowCount(), 6);
+  QCOMPARE(edit->text(), QString("(4)"));
+  QCOMPARE(edit->selectedText(), QString(""));
+}
+
+void TestMessage::testLogIsBounded() {
+
+  MessageLogModel log(3);
+  QSignalSpy inserted(&log, SIGNAL(rowsInserted(QModelIndex, int, int)));
+  QSignalSpy removed(&log, SIGNAL(rowsRemoved(QModelIndex, int, int)));
+
+  log.append("a", false);
+  log.append("b", false);
+  QCOMPARE(log.rowCount(), 0);
+  log.publish();
+  QCOMPARE(log.rowCount(), 2);
+  QCOMPARE(inserted.count(), 1);
+
+  // the oldest messages are dropped, and announced as removed
+  log.append("c", false);
+  log.append("d", true);
+  log.publish();
+  QCOMPARE(log.rowCount(), 3);
+  QCOMPARE(removed.count(), 1);
+  QCOMPARE(log.data(log.index(0)).toString(), QString("b"));
+  QCOMPARE(log.data(log.index(2)).toString(), QString("d"));
+
+  // messages overwritten before being published are not shown
+  log.append("e", false);
+  log.append("f", false);
+  QVERIFY(!log.data(log.index(0)).isValid());
+  log.publish();
+  QCOMPARE(log.data(log.index(0)).toString(), QString("d"));
+  QCOMPARE(log.total(), qint64(6));
+}
+
+void TestMessage::testBurst() {
+
+  MessageWidget widget(nullptr, 1000);
+  QLineEdit *edit = widget.findChild<QLineEdit *>();
+
+  QElapsedTimer timer;
+  timer.start();
+  for (int i = 0; i < 100000; i++) {
+    widget.info(QString::number(i));
+  }
+  QTRY_COMPARE(widget.messageLog()->rowCount(), 1000);
+  QVERIFY2(timer.elapsed() < 5000, "Expected a burst of messages not to stall.");
+
+  // the line edit was set once, with the last message
+  QCOMPARE(edit->text(), QString("99999"));
+  QCOMPARE(widget.messageLog()->data(widget.messageLog()->index(0)).toString(), QString("99000"));
+}
 
 QTEST_MAIN(TestMessage)
 #include "test_message.moc"
@@ -0,0 +1,98 @@
+#include "catch.hpp"
+
+#include <cmath>
+#include <limits>
+#include <sstream>
+#include <string>
+
+#include "interpreter.hpp"
+#include "nanbox.hpp"
+
+// boxes exp with heap and unboxes it again
+static Expression roundtrip(BoxHeap &heap, const Expression &exp)
+{
+  Boxed boxed;
+  REQUIRE(heap.box(exp, boxed));
+  REQUIRE(boxtype(boxed) == exp.head.type);
+  return heap.unbox(boxed);
+}
+
+TEST_CASE("Test NaN-boxed numbers", "[nanbox]")
+{
+  double numbers[] = {0.0, -0.0, 1.0, -2.5, 1e300, -1e-300, std::numeric_limits<double>::denorm_min(),
+                      std::numeric_limits<double>::infinity(), -std::numeric_limits<double>::infinity()};
+
+  for (double num : numbers)
+  {
+    Boxed boxed = boxnumber(num);
+    REQUIRE(isnumber(boxed));
+    REQUIRE(boxtype(boxed) == NumberType);
+    REQUIRE(std::memcmp(&boxed, &num, sizeof(num)) == 0);
+    REQUIRE(unboxnumber(boxed) == num);
+  }
+
+  // every NaN, including negative ones, is the canonical NaN
+  Boxed nan = boxnumber(-std::numeric_limits<double>::quiet_NaN());
+  REQUIRE(nan == BOX_NAN);
+  REQUIRE(isnumber(nan));
+  REQUIRE(std::isnan(unboxnumber(nan)));
+
+  // the other values are never numbers
+  REQUIRE_FALSE(isnumber(boxnone()));
+  REQUIRE_FALSE(isnumber(boxboolean(false)));
+  REQUIRE(boxtype(boxnone()) == NoneType);
+  REQUIRE(boxtype(boxboolean(true)) == BooleanType);
+  REQUIRE(unboxboolean(boxboolean(true)));
+  REQUIRE_FALSE(unboxboolean(boxboolean(false)));
+  REQUIRE(hastag(boxboolean(true), BoxBoolean));
+  REQUIRE_FALSE(hastag(boxboolean(true), BoxNone));
+  REQUIRE(boxtype(boxtagged(static_cast<BoxTag>(7), 0)) == NullType);
+}
+
+TEST_CASE("Test conversion between Expressions and boxed values", "[nanbox]")
+{
+  BoxHeap heap;
+
+  Expression values[] = {Expression(), Expression(true), Expression(false), Expression(3.25), Expression(std::string("abc")),
+                         Expression(std::make_tuple(1.0, 2.0)),
+                         Expression(std::make_tuple(1.0, 2.0), std::make_tuple(3.0, 4.0)),
+                         Expression(std::make_tuple(0.0, 0.0), std::make_tuple(1.0, 0.0), 1.5)};
+  for (const Expression &exp : values)
+  {
+    REQUIRE(identical(roundtrip(heap, exp), exp));
+  }
+  REQUIRE(heap.objects() == 3);
+
+  // symbols are interned
+  Boxed a, b;
+  REQUIRE(heap.box(Expression(std::string("abc")), a));
+  REQUIRE(heap.box(Expression(std::string("xyz")), b));
+  REQUIRE(a == heap.boxsymbol("abc"));
+  REQUIRE(a != b);
+  REQUIRE(heap.symbol(static_cast<std::uint32_t>(unboxpayload(b))) == "xyz");
+
+  // objects keep their address as the heap grows
+  Boxed point = heap.boxpoint(Point{5, 6});
+  for (int i = 0; i < 10000; i++)
+  {
+    heap.boxpoint(Point{double(i), double(i)});
+  }
+  REQUIRE(heap.unbox(point) == Expression(std::make_tuple(5.0, 6.0)));
+
+  // lists, operators and keywords are not values
+  Interpreter interp;
+  std::istringstream program("(+ 1 2)");
+  REQUIRE(interp.parse(program));
+  Expression call = interp.returnast();
+  Boxed boxed;
+  REQUIRE_FALSE(heap.box(call, boxed));
+  REQUIRE_FALSE(heap.box(call.tail[0], boxed));
+  Atom op;
+  REQUIRE(token_to_atom("not", op));
+  REQUIRE_FALSE(heap.box(Expression(op), boxed));
+
+  heap.clear();
+  REQUIRE(heap.objects() == 0);
+  REQUIRE(heap.boxsymbol("xyz") == heap.boxsymbol("xyz"));
+  REQUIRE(unboxpayload(heap.boxsymbol("xyz")) == 0);
+}
@@ -0,0 +1,260 @@
+#include "catch.hpp"
+
+#include <fstream>
+#include <sstream>
+#include <string>
+
+#include "interpreter.hpp"
+#include "interpreter_semantic_error.hpp"
+#include "optimizer.hpp"
+#include "test_config.hpp"
+
+// parses program at the optimization level, returns the AST
+static Expression optimized(const std::string &program, int level)
+{
+  Interpreter interp;
+  interp.setOptLevel(level);
+  std::istringstream iss(program);
+  REQUIRE(interp.parse(iss));
+  return interp.returnast();
+}
+
+// evaluates a file at the optimization level, returns the result and what was drawn
+static std::pair<Expression, std::vector<Atom>> runfile(const std::string &fname, int level)
+{
+  Interpreter interp;
+  interp.setOptLevel(level);
+  std::ifstream ifs(fname);
+  REQUIRE(interp.parse(ifs));
+  Expression result = interp.eval();
+  return std::make_pair(result, interp.getGraphicsatoms());
+}
+
+TEST_CASE("Test constant folding", "[optimizer]")
+{
+  Expression ast = optimized("(+ 1 (* 2 3) (- 4))", 1);
+  REQUIRE(ast.tail.empty());
+  REQUIRE(ast == Expression(3.0));
+
+  // pi is a constant, symbols defined by the program are not
+  ast = optimized("(begin (define a (* 2 pi)) (+ a (/ 6 2)))", 1);
+  REQUIRE(ast.tail[1].tail[2] == Expression(2 * atan2(0, -1)));
+  REQUIRE(ast.tail[2].tail[0].head.value.sym_value == "+");
+  REQUIRE(ast.tail[2].tail[2] == Expression(3.0));
+
+  // graphics builtins fold to their atom
+  ast = optimized("(draw (line (point 0 0) (point (/ 10 2) 1)))", 1);
+  REQUIRE(ast.tail[1] == Expression(std::make_tuple(0., 0.), std::make_tuple(5., 1.)));
+
+  // level 0 leaves the AST as read
+  ast = optimized("(+ 1 2)", 0);
+  REQUIRE(ast.tail.size() == 3);
+
+  Interpreter interp;
+  interp.enableStats(true);
+  interp.setOptLevel(1);
+  std::istringstream iss("(begin (define a (+ 1 2)) (* 2 pi) (+ a 1) (if (< 1 2) (sin 0) 1))");
+  REQUIRE(interp.parse(iss));
+  REQUIRE(interp.getStats().folded == 4);
+  REQUIRE(interp.eval() == Expression(0.0));
+}
+
+TEST_CASE("Test constant folding keeps errors", "[optimizer]")
+{
+  std::vector<std::string> programs = {"(- 1 1 2)", "(+ 1 True)", "(not 1)", "(begin (define a 1) (log10 True))",
+                                       "(point 1)"};
+  for (auto s : programs)
+  {
+    Interpreter interp;
+    interp.setOptLevel(1);
+    std::istringstream iss(s);
+    REQUIRE(interp.parse(iss));
+    REQUIRE_THROWS_AS(interp.eval(), InterpreterSemanticError);
+  }
+}
+
+TEST_CASE("Test constant folding does not change results", "[optimizer]")
+{
+  const char *files[] = {"test2.slp", "test3.slp", "test4.slp", "test5.slp", "test_car.slp",
+                         "test_arc.slp", "test_line.slp", "test_point.slp", "test_crlf.slp"};
+  for (const char *file : files)
+  {
+    std::string fname = TEST_FILE_DIR + "/" + file;
+    std::pair<Expression, std::vector<Atom>> plain = runfile(fname, 0);
+    for (int level = 1; level <= 3; level++)
+    {
+      std::pair<Expression, std::vector<Atom>> folded = runfile(fname, level);
+
+      REQUIRE(plain.first == folded.first);
+      REQUIRE(plain.second.size() == folded.second.size());
+      for (std::size_t i = 0; i < plain.second.size(); i++)
+      {
+        REQUIRE(Expression(plain.second[i]) == Expression(folded.second[i]));
+      }
+    }
+  }
+}
+
+TEST_CASE("Test dead branch elimination", "[optimizer]")
+{
+  Interpreter interp;
+  interp.enableStats(true);
+  interp.setOptLevel(3);
+  std::istringstream iss(
+      "(begin (define debug False) (define n 3) (if debug (draw (point 0 0)) (if (< n 5) (* n 2) 0)))");
+  REQUIRE(interp.parse(iss));
+  Expression ast = interp.returnast();
+  REQUIRE(ast.tail.size() == 4);
+  REQUIRE(ast.tail[3] == Expression(6.));
+  REQUIRE(interp.getStats().eliminated == 2);
+  REQUIRE(interp.getStats().folded == 3); // (point 0 0) is folded before the if is removed
+  REQUIRE(interp.eval() == Expression(6.));
+  REQUIRE(interp.getGraphicsatoms().empty());
+
+  // a define in a branch may not be evaluated, symbols defined before the program are unknown
+  std::istringstream iss2("(begin (if (< 0 n) (define a True) (define a False)) (if a 1 2))");
+  REQUIRE(interp.parse(iss2));
+  REQUIRE(interp.returnast().tail[2].head.value.sym_value == "if");
+  REQUIRE(interp.returnast().tail[1].tail[1].tail[2].head.type == SymbolType);
+  REQUIRE(interp.eval() == Expression(1.));
+
+  // the discarded literals and symbols of a begin are removed
+  ast = optimized("(begin 1 x (define y 2) pi y)", 3);
+  REQUIRE(ast.tail.size() == 3);
+  REQUIRE(ast.tail[1].tail[1].head.value.sym_value == "y");
+  REQUIRE(ast.tail[2] == Expression(2.));
+
+  // a symbol bound to a constant evaluates to it, whatever its tail
+  ast = optimized("(begin (define f 1) (f (draw (point 0 0))))", 3);
+  REQUIRE(ast.tail[2] == Expression(1.));
+
+  std::vector<std::string> programs = {"(if True (+ 1 True) 2)", "(begin (define a 1) (define a True) (if a 1 2))",
+                                       "(if 1 2 3)", "(if True 1)", "(begin (define pi 3) (if pi 1 2))",
+                                       "(begin (define c True) (if c (begin) 1))"};
+  for (auto s : programs)
+  {
+    INFO(s);
+    Interpreter failing;
+    failing.setOptLevel(3);
+    std::istringstream in(s);
+    REQUIRE(failing.parse(in));
+    REQUIRE_THROWS_AS(failing.eval(), InterpreterSemanticError);
+  }
+}
+
+TEST_CASE("Test static type checking", "[optimizer]")
+{
+  Interpreter interp;
+  interp.enableStats(true);
+  interp.setOptLevel(2);
+  std::istringstream iss("(begin (define a (sin 0)) (define b (+ a 1)) (if (< a b) (point a b) (point b a)))");
+  REQUIRE(interp.parse(iss));
+  REQUIRE(interp.getStats().folded == 1);
+  REQUIRE(interp.getStats().checked == 4);
+  REQUIRE(interp.returnast().tail[2].tail[2].checked);
+  REQUIRE(interp.eval() == Expression(std::make_tuple(0., 1.)));
+
+  // symbols defined before the program are of unknown type
+  std::istringstream iss2("(+ b 1)");
+  REQUIRE(interp.parse(iss2));
+  REQUIRE(!interp.returnast().checked);
+  REQUIRE(interp.eval() == Expression(2.));
+
+  // the unchecked builtins compute what the checked ones do
+  std::vector<std::string> calls = {"(not t)", "(and t f t)", "(or f f)", "(< x y)", "(<= x y)", "(> x y)",
+                                    "(>= x y)", "(= x x)", "(+ x y x)", "(- x)", "(- x y)", "(* x y y)",
+                                    "(/ x y)", "(log10 y)", "(pow x y)", "(point x y)",
+                                    "(line (point x y) (point y x))", "(arc (point x y) (point y x) y)",
+                                    "(sin x)", "(cos x)", "(arctan x y)"};
+  for (auto s : calls)
+  {
+    INFO(s);
+    std::string program = "(begin (define x 3) (define y 2) (define t True) (define f False) " + s + ")";
+    Expression results[2];
+    for (int level = 0; level <= 2; level += 2)
+    {
+      Interpreter checked;
+      checked.setOptLevel(level);
+      std::istringstream in(program);
+      REQUIRE(checked.parse(in));
+      REQUIRE(checked.returnast().tail[5].checked == (level == 2));
+      results[level / 2] = checked.eval();
+    }
+    REQUIRE(results[0] == results[1]);
+  }
+}
+
+TEST_CASE("Test type checking reports errors up front", "[optimizer]")
+{
+  std::vector<std::string> programs = {"(begin (define a 1) (draw (point a a)) (+ a True))",
+                                       "(begin (define a (< 1 2)) (if a 1 2) (log10 a))",
+                                       "(begin (define a 1) (define a 2))",
+                                       "(begin (define pi 3) 1)",
+                                       "(begin (define p (point 0 0)) (if p 1 2))",
+                                       "(not (draw (point 0 0)))",
+                                       "(begin (define a 1) (begin))",
+                                       "(begin (define a 1) (or a True))"};
+  for (auto s : programs)
+  {
+    INFO(s);
+    std::string error;
+    {
+      Interpreter interp;
+      std::istringstream iss(s);
+      REQUIRE(interp.parse(iss));
+      REQUIRE_THROWS_AS(interp.eval(), InterpreterSemanticError);
+      try
+      {
+        interp.eval();
+      }
+      catch (const InterpreterSemanticError &e)
+      {
+        error = e.what();
+      }
+    }
+
+    Interpreter interp;
+    interp.enableStats(true);
+    interp.setOptLevel(2);
+    std::istringstream iss(s);
+    REQUIRE(interp.parse(iss));
+    try
+    {
+      interp.eval();
+      FAIL("no error raised");
+    }
+    catch (const InterpreterSemanticError &e)
+    {
+      REQUIRE(error == e.what());
+    }
+    // nothing was evaluated
+    REQUIRE(interp.getStats().maxdepth == 0);
+    REQUIRE(interp.getGraphicsatoms().empty());
+    REQUIRE(interp.returnenv().size() == Interpreter().returnenv().size());
+  }
+
+  // errors in a branch or depending on symbols defined before are left to eval
+  Interpreter interp;
+  interp.enableStats(true);
+  interp.setOptLevel(2);
+  std::istringstream iss("(begin (define a True) (if a 1 (+ a 1)))");
+  REQUIRE(interp.parse(iss));
+  REQUIRE(interp.eval() == Expression(1.));
+  std::istringstream iss2("(+ a 1)");
+  REQUIRE(interp.parse(iss2));
+  REQUIRE_THROWS_AS(interp.eval(), InterpreterSemanticError);
+  REQUIRE(interp.getStats().maxdepth > 0);
+
+  // and and or may stop before an argument raising an error or defining a symbol
+  for (int level = 2; level <= 3; level++)
+  {
+    Interpreter shortcircuit;
+    shortcircuit.setOptLevel(level);
+    std::istringstream iss3("(begin (and False (+ 1 True)) (or True (define b 1)))");
+    REQUIRE(shortcircuit.parse(iss3));
+    REQUIRE(shortcircuit.eval() == Expression(true));
+    std::istringstream iss4("(begin (or True (define b 1)) (+ b 1))");
+    REQUIRE(shortcircuit.parse(iss4));
+    REQUIRE_THROWS_AS(shortcircuit.eval(), InterpreterSemanticError);
+  }
+}
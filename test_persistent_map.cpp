@@ -0,0 +1,129 @@
+#include "catch.hpp"
+
+#include <map>
+#include <random>
+#include <sstream>
+#include <string>
+
+#include "interpreter.hpp"
+#include "interpreter_semantic_error.hpp"
+#include "persistent_map.hpp"
+
+// every key collides, so the maps only use the collision lists
+struct ConstantHash
+{
+  std::size_t operator()(const std::string &) const
+  {
+    return 42;
+  }
+};
+
+// true if map holds exactly the mappings of expected
+template <typename Map>
+static bool same(const Map &map, const std::map<std::string, int> &expected)
+{
+  if (map.size() != expected.size())
+  {
+    return false;
+  }
+  for (const auto &mapping : expected)
+  {
+    const int *value = map.find(mapping.first);
+    if (value == nullptr || *value != mapping.second)
+    {
+      return false;
+    }
+  }
+  std::size_t visited = 0;
+  map.foreach([&](const std::string &, const int &) { visited++; });
+  return visited == expected.size();
+}
+
+template <typename Map>
+static void randomoperations(unsigned keys)
+{
+  std::mt19937 random(7);
+  Map map;
+  std::map<std::string, int> expected;
+
+  // copies taken along the way must keep their mappings
+  std::vector<std::pair<Map, std::map<std::string, int>>> versions;
+
+  for (int i = 0; i < 4000; i++)
+  {
+    std::string key = "k" + std::to_string(random() % keys);
+    if (random() % 3)
+    {
+      bool inserted = expected.insert(std::make_pair(key, i)).second;
+      REQUIRE(map.insert(key, i) == inserted);
+    }
+    else
+    {
+      bool erased = expected.erase(key) == 1;
+      REQUIRE(map.erase(key) == erased);
+    }
+    if (i % 500 == 0)
+    {
+      versions.push_back(std::make_pair(map, expected));
+    }
+  }
+
+  REQUIRE(same(map, expected));
+  for (const auto &version : versions)
+  {
+    REQUIRE(same(version.first, version.second));
+  }
+  REQUIRE(map.find("absent") == nullptr);
+}
+
+TEST_CASE("Test persistent map against std::map", "[persistent map]")
+{
+  randomoperations<PersistentMap<int>>(1000);
+}
+
+TEST_CASE("Test persistent map with colliding hashes", "[persistent map]")
+{
+  randomoperations<PersistentMap<int, ConstantHash>>(50);
+
+  PersistentMap<int, ConstantHash> map;
+  REQUIRE(map.insert("a", 1));
+  REQUIRE(map.insert("b", 2));
+  REQUIRE_FALSE(map.insert("a", 3));
+  REQUIRE(*map.find("a") == 1);
+  REQUIRE(map.erase("a"));
+  REQUIRE(map.find("a") == nullptr);
+  REQUIRE(*map.find("b") == 2);
+  REQUIRE(map.erase("b"));
+  REQUIRE(map.empty());
+}
+
+TEST_CASE("Test forked interpreters share their prelude", "[persistent map]")
+{
+  Interpreter prelude;
+  std::istringstream program("(begin (define a 1) (define b (+ a 1)))");
+  REQUIRE(prelude.parse(program));
+  prelude.eval();
+
+  Interpreter first = prelude.fork();
+  Interpreter second = prelude.fork();
+
+  std::istringstream firstprogram("(define c (+ a b 10))");
+  REQUIRE(first.parse(firstprogram));
+  REQUIRE(first.eval().head.value.num_value == 13);
+
+  std::istringstream secondprogram("(define c (* a b 10))");
+  REQUIRE(second.parse(secondprogram));
+  REQUIRE(second.eval().head.value.num_value == 20);
+
+  // each fork only sees its own defines
+  REQUIRE(first.returnenv().searchExp("c").head.value.num_value == 13);
+  REQUIRE(second.returnenv().searchExp("c").head.value.num_value == 20);
+  REQUIRE_FALSE(prelude.returnenv().check("c"));
+
+  // a failed evaluation in a fork rolls back without touching the prelude
+  std::istringstream failing("(begin (define d 1) (define e (+ d x)))");
+  REQUIRE(first.parse(failing));
+  REQUIRE_THROWS_AS(first.eval(), InterpreterSemanticError);
+  REQUIRE_FALSE(first.returnenv().check("d"));
+  REQUIRE(prelude.returnenv().size() == first.returnenv().size() - 1);
+}
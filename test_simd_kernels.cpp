@@ -0,0 +1,150 @@
+#include "catch.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <limits>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "interpreter.hpp"
+#include "interpreter_semantic_error.hpp"
+#include "simd_kernels.hpp"
+
+// true if a and b have the same bits
+static bool samebits(double a, double b)
+{
+  return std::memcmp(&a, &b, sizeof(double)) == 0;
+}
+
+TEST_CASE("Test pairwise sums and products", "[simd_kernels]")
+{
+  SimdLevel supported = simdsupported();
+  REQUIRE(simdlevel() == supported);
+
+  std::vector<double> values;
+  for (int i = 0; i < 10007; i++)
+  {
+    values.push_back(std::sin(i) * 1000);
+  }
+
+  REQUIRE(pairwisesum(values.data(), 0) == 0);
+  REQUIRE(pairwiseproduct(values.data(), 0) == 1);
+  double small[] = {1, 2, 3, 4, 5};
+  REQUIRE(pairwisesum(small, 5) == 15);
+  REQUIRE(pairwiseproduct(small, 5) == 120);
+
+  // every level gives the bits of the scalar kernels, whatever the length
+  for (std::size_t n : {1, 15, 16, 17, 256, 257, 1000, 10007})
+  {
+    INFO(n);
+    std::size_t factors = std::min<std::size_t>(n, 100); // no overflow
+    setsimdlevel(SimdScalar);
+    double sum = pairwisesum(values.data(), n);
+    double product = pairwiseproduct(values.data() + 1, factors);
+
+    for (int level = SimdSSE2; level <= supported; level++)
+    {
+      REQUIRE(setsimdlevel(static_cast<SimdLevel>(level)) == level);
+      REQUIRE(samebits(pairwisesum(values.data(), n), sum));
+      REQUIRE(samebits(pairwiseproduct(values.data() + 1, factors), product));
+    }
+  }
+  setsimdlevel(supported);
+
+  // the error of a long sum stays far below the error of the sequential sum
+  std::vector<double> tenths(1000000, 0.1);
+  double sequential = 0;
+  for (double x : tenths)
+  {
+    sequential += x;
+  }
+  double pairwise = pairwisesum(tenths.data(), tenths.size());
+  REQUIRE(std::fabs(pairwise - 100000) < 1e-9);
+  REQUIRE(std::fabs(pairwise - 100000) < std::fabs(sequential - 100000));
+}
+
+TEST_CASE("Test batch sines and cosines", "[simd_kernels]")
+{
+  SimdLevel supported = simdsupported();
+
+  std::vector<double> angles = {0.0, -0.0, 1e-300, 0.5, -0.5, 1, 2, 3, 4, 5, 6, 7, -7, 100, -1000, 123456.789, 1e6,
+                                2e6, 1e300, std::numeric_limits<double>::infinity(),
+                                std::numeric_limits<double>::quiet_NaN()};
+  for (int i = -1000; i <= 1000; i++)
+  {
+    angles.push_back(i * 0.0123);
+  }
+
+  std::vector<double> sines(angles.size()), cosines(angles.size());
+  setsimdlevel(SimdScalar);
+  batchsincos(angles.data(), sines.data(), cosines.data(), angles.size());
+
+  for (std::size_t i = 0; i < angles.size(); i++)
+  {
+    INFO(angles[i]);
+    if (std::isnan(std::sin(angles[i])))
+    {
+      REQUIRE(std::isnan(sines[i]));
+      REQUIRE(std::isnan(cosines[i]));
+      continue;
+    }
+    REQUIRE(std::fabs(sines[i] - std::sin(angles[i])) <= 2e-16);
+    REQUIRE(std::fabs(cosines[i] - std::cos(angles[i])) <= 2e-16);
+  }
+  REQUIRE(sines[1] == 0);
+  REQUIRE(cosines[0] == 1);
+
+  // every level gives the bits of the scalar kernel
+  for (int level = SimdSSE2; level <= supported; level++)
+  {
+    setsimdlevel(static_cast<SimdLevel>(level));
+    std::vector<double> s(angles.size()), c(angles.size());
+    batchsincos(angles.data(), s.data(), c.data(), angles.size());
+    for (std::size_t i = 0; i < angles.size(); i++)
+    {
+      INFO(angles[i]);
+      REQUIRE((samebits(s[i], sines[i]) || std::isnan(s[i])));
+      REQUIRE((samebits(c[i], cosines[i]) || std::isnan(c[i])));
+    }
+  }
+  setsimdlevel(supported);
+}
+
+TEST_CASE("Test vectorized arithmetic", "[simd_kernels]")
+{
+  std::string program = "(begin (define x 3) (+";
+  for (int i = 0; i < 1000; i++)
+  {
+    program += " (/ " + std::to_string(i) + " x)";
+  }
+  program += "))";
+
+  Interpreter sequential, vectorized;
+  vectorized.setVectorize(true);
+  std::istringstream in(program), iss(program);
+  REQUIRE(sequential.parse(in));
+  REQUIRE(vectorized.parse(iss));
+
+  double expected = 0;
+  for (int i = 0; i < 1000; i++)
+  {
+    expected += i / 3.;
+  }
+  Expression result = sequential.eval();
+  REQUIRE(samebits(result.head.value.num_value, expected));
+
+  // the pairwise sum is as close to the exact sum, 166500
+  Expression sum = vectorized.eval();
+  REQUIRE(sum.head.type == NumberType);
+  REQUIRE(std::fabs(sum.head.value.num_value - 166500) <= std::fabs(expected - 166500));
+
+  // a wide call that is not all numbers is evaluated as usual
+  std::istringstream bad("(* 2 2 2 2 2 2 2 2 2 2 2 2 2 2 2 2 2 2 2 2 2 2 2 2 2 2 2 2 2 2 2 2 2 True)");
+  REQUIRE(vectorized.parse(bad));
+  REQUIRE_THROWS_AS(vectorized.eval(), InterpreterSemanticError);
+  std::istringstream wide("(* 2 2 2 2 2 2 2 2 2 2 2 2 2 2 2 2 2 2 2 2 2 2 2 2 2 2 2 2 2 2 2 2 2 2)");
+  REQUIRE(vectorized.parse(wide));
+  REQUIRE(vectorized.eval() == Expression(std::ldexp(1.0, 34)));
+}
@@ -0,0 +1,99 @@
+#include "catch.hpp"
+
+#include <sstream>
+#include <string>
+
+#include "interpreter.hpp"
+#include "trace.hpp"
+
+// occurrences of text in str
+static std::size_t count(const std::string &str, const std::string &text)
+{
+  std::size_t n = 0;
+  for (std::size_t i = str.find(text); i != std::string::npos; i = str.find(text, i + 1))
+  {
+    n++;
+  }
+  return n;
+}
+
+// traces parsing and evaluating program
+static std::string trace(const std::string &program, const TraceOptions &options)
+{
+  tracestart(options);
+
+  Interpreter interp;
+  std::istringstream iss(program);
+  REQUIRE(interp.parse(iss));
+  REQUIRE_NOTHROW(interp.eval());
+
+  tracestop();
+
+  std::ostringstream out;
+  REQUIRE(tracewrite(out));
+  return out.str();
+}
+
+TEST_CASE("Test tracing records the interpreter's phases", "[trace]")
+{
+  std::string program = "(begin (define a 1) (if (< a 2) (draw (point a a)) (+ 1 2)) (+ a 1 2) (+ a 3))";
+
+  std::string json = trace(program, TraceOptions());
+
+  REQUIRE(json.compare(0, 16, "{\"traceEvents\": ") == 0);
+  REQUIRE(count(json, "\"name\": \"tokenize\"") == 2);
+  REQUIRE(count(json, "\"name\": \"read_from_tokens\"") == 2);
+  REQUIRE(count(json, "\"name\": \"eval\"") == 2);
+  REQUIRE(count(json, "\"name\": \"begin\"") == 2);
+  REQUIRE(count(json, "\"name\": \"define\"") == 2);
+  REQUIRE(count(json, "\"name\": \"if\"") == 2);
+  REQUIRE(count(json, "\"name\": \"draw\"") == 2);
+  REQUIRE(count(json, "\"name\": \"+\"") == 4);
+  REQUIRE(count(json, "\"name\": \"point\"") == 2);
+
+  // every begin has its end
+  REQUIRE(count(json, "\"ph\": \"B\"") == count(json, "\"ph\": \"E\""));
+  REQUIRE(traceeventcount() == 2 * count(json, "\"ph\": \"B\""));
+}
+
+TEST_CASE("Test trace sampling and depth limits", "[trace]")
+{
+  std::string program = "(begin (+ 1 2) (+ 1 2) (+ 1 2) (+ 1 2) (+ 1 2) (+ 1 2))";
+
+  // one builtin call in three is recorded
+  TraceOptions sampled;
+  sampled.sampleevery = 3;
+  std::string json = trace(program, sampled);
+  REQUIRE(count(json, "\"name\": \"+\"") == 4);
+  REQUIRE(count(json, "\"name\": \"begin\"") == 2);
+
+  // nothing deeper than eval is recorded
+  TraceOptions shallow;
+  shallow.maxdepth = 1;
+  json = trace(program, shallow);
+  REQUIRE(count(json, "\"name\": \"eval\"") == 2);
+  REQUIRE(count(json, "\"name\": \"begin\"") == 0);
+  REQUIRE(count(json, "\"name\": \"+\"") == 0);
+
+  // past the event limit, the 7 later scopes are dropped but the trace stays balanced
+  TraceOptions limited;
+  limited.maxevents = 3;
+  json = trace(program, limited);
+  REQUIRE(count(json, "\"ph\": \"B\"") == 3);
+  REQUIRE(count(json, "\"ph\": \"E\"") == 3);
+  REQUIRE(json.find("\"dropped_events\": 7") != std::string::npos);
+}
+
+TEST_CASE("Test nothing is traced while tracing is stopped", "[trace]")
+{
+  tracestart();
+  tracestop();
+
+  Interpreter interp;
+  std::istringstream iss("(+ 1 2)");
+  REQUIRE(interp.parse(iss));
+  REQUIRE_NOTHROW(interp.eval());
+
+  REQUIRE_FALSE(tracing());
+  REQUIRE(traceeventcount() == 0);
+}
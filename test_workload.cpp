@@ -0,0 +1,89 @@
+#include "catch.hpp"
+
+#include <sstream>
+#include <string>
+
+#include "interpreter.hpp"
+#include "interpreter_semantic_error.hpp"
+#include "workload_generator.hpp"
+
+static std::string generate(const WorkloadOptions &options)
+{
+  std::ostringstream out;
+  std::uint64_t bytes = generateworkload(out, options);
+  REQUIRE(bytes == out.str().size());
+  return out.str();
+}
+
+// parses and evaluates a program, requiring both to succeed
+static Expression evaluate(const std::string &program, Interpreter &interp)
+{
+  std::istringstream in(program);
+  REQUIRE(interp.parse(in));
+
+  Expression result;
+  REQUIRE_NOTHROW(result = interp.eval());
+  return result;
+}
+
+TEST_CASE("Test every generated workload evaluates", "[workload]")
+{
+  const char *kinds[] = {"nesting", "begin", "defines", "add", "scene"};
+
+  for (const char *name : kinds)
+  {
+    WorkloadOptions options;
+    REQUIRE(parseworkloadkind(name, options.kind));
+    options.size = 50;
+
+    for (std::uint32_t seed = 1; seed <= 3; seed++)
+    {
+      options.seed = seed;
+      Interpreter interp;
+      evaluate(generate(options), interp);
+    }
+  }
+
+  WorkloadKind kind;
+  REQUIRE_FALSE(parseworkloadkind("unknown", kind));
+}
+
+TEST_CASE("Test generated workloads are reproducible", "[workload]")
+{
+  WorkloadOptions options;
+  options.kind = DefinesWorkload;
+  options.size = 100;
+
+  std::string program = generate(options);
+  REQUIRE(generate(options) == program);
+
+  options.seed = 2;
+  REQUIRE(generate(options) != program);
+}
+
+TEST_CASE("Test workload size knobs", "[workload]")
+{
+  WorkloadOptions options;
+  options.kind = WideAddWorkload;
+  options.size = 10;
+
+  // the result of an add workload is its operands' sum
+  std::string program = generate(options);
+  Interpreter interp;
+  Expression result = evaluate(program, interp);
+  REQUIRE(result.head.type == NumberType);
+
+  // a byte target overrides the element count
+  options.bytes = 100000;
+  std::string large = generate(options);
+  REQUIRE(large.size() >= 100000);
+  REQUIRE(large.size() < 100100);
+
+  // a scene draws the 12 primitives of the car for each car
+  options.kind = SceneWorkload;
+  options.bytes = 0;
+  options.size = 4;
+  Interpreter scene;
+  evaluate(generate(options), scene);
+  REQUIRE(scene.getGraphicsatoms().size() == 4 * 12);
+}
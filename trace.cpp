@@ -0,0 +1,217 @@
+#include "trace.hpp"
+
+// system includes
+#include <chrono>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <vector>
+
+std::atomic<bool> traceenabled(false);
+
+struct TraceEvent
+{
+  const char *name;
+  const char *category;
+  char phase; // 'B' or 'E'
+  std::uint64_t timestamp; // nanoseconds since tracestart
+};
+
+// The events of one thread, only ever written by that thread
+struct TraceBuffer
+{
+  unsigned id;
+  std::vector<TraceEvent> events;
+  std::set<std::string> names; // copies of the dynamic names, for the life of the trace
+  std::uint64_t recorded = 0; // begin events
+  std::uint64_t dropped = 0;
+  unsigned depth = 0;
+  unsigned sample = 0;
+  std::uint64_t generation = 0; // the tracestart this buffer was cleared for
+};
+
+namespace
+{
+// the buffers of every thread that ever traced, guarded by registrymutex;
+// they are never freed, so events outlive the threads that recorded them
+std::mutex registrymutex;
+std::vector<std::unique_ptr<TraceBuffer>> registry;
+
+TraceOptions options;
+std::chrono::steady_clock::time_point origin;
+std::atomic<std::uint64_t> generation(0);
+
+thread_local TraceBuffer *threadbuffer = nullptr;
+
+std::uint64_t now()
+{
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - origin).count();
+}
+
+TraceBuffer *currentbuffer()
+{
+  if (threadbuffer == nullptr)
+  {
+    std::lock_guard<std::mutex> lock(registrymutex);
+    registry.emplace_back(new TraceBuffer);
+    threadbuffer = registry.back().get();
+    threadbuffer->id = registry.size();
+  }
+
+  // a buffer is cleared lazily by its own thread after a new tracestart
+  std::uint64_t current = generation.load(std::memory_order_acquire);
+  if (threadbuffer->generation != current)
+  {
+    threadbuffer->events.clear();
+    threadbuffer->names.clear();
+    threadbuffer->recorded = 0;
+    threadbuffer->dropped = 0;
+    threadbuffer->depth = 0;
+    threadbuffer->sample = 0;
+    threadbuffer->generation = current;
+  }
+  return threadbuffer;
+}
+
+void writestring(std::ostream &out, const char *text)
+{
+  out << '"';
+  for (const char *c = text; *c; c++)
+  {
+    if (*c == '"' || *c == '\\')
+    {
+      out << '\\' << *c;
+    }
+    else if (static_cast<unsigned char>(*c) < 0x20)
+    {
+      out << ' ';
+    }
+    else
+    {
+      out << *c;
+    }
+  }
+  out << '"';
+}
+} // namespace
+
+void tracestart(const TraceOptions &traceoptions)
+{
+  traceenabled.store(false);
+  {
+    std::lock_guard<std::mutex> lock(registrymutex);
+    options = traceoptions;
+    if (options.sampleevery == 0)
+    {
+      options.sampleevery = 1;
+    }
+    origin = std::chrono::steady_clock::now();
+  }
+  generation.fetch_add(1, std::memory_order_release);
+  traceenabled.store(true);
+}
+
+void tracestop()
+{
+  traceenabled.store(false);
+}
+
+std::uint64_t traceeventcount()
+{
+  std::lock_guard<std::mutex> lock(registrymutex);
+  std::uint64_t count = 0;
+  for (const std::unique_ptr<TraceBuffer> &buffer : registry)
+  {
+    if (buffer->generation == generation.load())
+    {
+      count += buffer->events.size();
+    }
+  }
+  return count;
+}
+
+bool tracewrite(std::ostream &out)
+{
+  std::lock_guard<std::mutex> lock(registrymutex);
+
+  out << "{\"traceEvents\": [";
+  bool first = true;
+  std::uint64_t dropped = 0;
+
+  for (const std::unique_ptr<TraceBuffer> &buffer : registry)
+  {
+    if (buffer->generation != generation.load())
+    {
+      continue; // nothing recorded by this thread since the last tracestart
+    }
+    dropped += buffer->dropped;
+
+    for (const TraceEvent &event : buffer->events)
+    {
+      out << (first ? "\n" : ",\n") << "{\"name\": ";
+      writestring(out, event.name);
+      out << ", \"cat\": ";
+      writestring(out, event.category);
+      // timestamps are in microseconds
+      out << ", \"ph\": \"" << event.phase << "\", \"ts\": " << event.timestamp / 1000 << "."
+          << (event.timestamp / 100) % 10 << (event.timestamp / 10) % 10 << event.timestamp % 10
+          << ", \"pid\": 1, \"tid\": " << buffer->id << "}";
+      first = false;
+    }
+  }
+
+  out << "\n], \"displayTimeUnit\": \"ms\", \"otherData\": {\"dropped_events\": " << dropped << "}}\n";
+  out.flush();
+  return static_cast<bool>(out);
+}
+
+bool tracewrite(const std::string &path)
+{
+  std::ofstream out(path);
+  return out && tracewrite(out);
+}
+
+void TraceScope::begin(const char *name, const std::string *dynamicname, const char *category, bool sampled)
+{
+  buffer = currentbuffer();
+  buffer->depth++;
+
+  recorded = buffer->depth <= options.maxdepth && (!sampled || buffer->sample++ % options.sampleevery == 0);
+  if (!recorded)
+  {
+    return;
+  }
+
+  if (buffer->recorded >= options.maxevents)
+  {
+    buffer->dropped++;
+    recorded = false;
+    return;
+  }
+
+  if (dynamicname != nullptr)
+  {
+    name = buffer->names.insert(*dynamicname).first->c_str();
+  }
+  this->name = name;
+  this->category = category;
+
+  buffer->recorded++;
+  buffer->events.push_back(TraceEvent{name, category, 'B', now()});
+}
+
+void TraceScope::end()
+{
+  if (buffer->generation != generation.load(std::memory_order_relaxed))
+  {
+    return; // the trace was restarted since the scope began
+  }
+
+  // an end is always recorded after its begin, even past maxevents
+  if (recorded)
+  {
+    buffer->events.push_back(TraceEvent{name, category, 'E', now()});
+  }
+  buffer->depth--;
+}
@@ -0,0 +1,97 @@
+#ifndef TRACE_HPP
+#define TRACE_HPP
+
+// system includes
+#include <atomic>
+#include <cstdint>
+#include <ostream>
+#include <string>
+
+// Tracing of the interpreter's execution as Chrome trace_event JSON
+// (open the file in chrome://tracing or ui.perfetto.dev).
+//
+// While tracing, every TraceScope records a begin event when constructed and
+// an end event when destroyed, into a buffer owned by the current thread, so
+// recording takes no lock. With tracing off a TraceScope costs one flag test.
+
+struct TraceOptions
+{
+  // scopes nested deeper than this are not recorded
+  unsigned maxdepth = 64;
+
+  // only one in this many sampled scopes (builtin calls) is recorded
+  unsigned sampleevery = 1;
+
+  // begin events recorded per thread at most, later scopes are dropped
+  std::uint64_t maxevents = 1 << 22;
+};
+
+// clears the recorded events and starts recording
+void tracestart(const TraceOptions &options = TraceOptions());
+
+// stops recording, the recorded events are kept until the next tracestart
+void tracestop();
+
+// writes the events recorded by every thread as a trace_event JSON object,
+// returns false if the stream failed; recording threads must be stopped
+bool tracewrite(std::ostream &out);
+
+// writes the trace to the file at path
+bool tracewrite(const std::string &path);
+
+// number of events recorded since tracestart, on every thread
+std::uint64_t traceeventcount();
+
+extern std::atomic<bool> traceenabled;
+
+inline bool tracing()
+{
+  return traceenabled.load(std::memory_order_relaxed);
+}
+
+struct TraceBuffer;
+
+// Records a begin event for name now and the matching end event on destruction
+class TraceScope
+{
+public:
+  // name and category must outlive the trace (string literals)
+  TraceScope(const char *name, const char *category, bool sampled = false) : buffer(nullptr)
+  {
+    if (tracing())
+    {
+      begin(name, nullptr, category, sampled);
+    }
+  }
+
+  // the name is copied into the trace when the scope is recorded
+  TraceScope(const std::string &name, const char *category, bool sampled = false) : buffer(nullptr)
+  {
+    if (tracing())
+    {
+      begin(nullptr, &name, category, sampled);
+    }
+  }
+
+  ~TraceScope()
+  {
+    if (buffer != nullptr)
+    {
+      end();
+    }
+  }
+
+private:
+  TraceScope(const TraceScope &);
+  TraceScope &operator=(const TraceScope &);
+
+  void begin(const char *name, const std::string *dynamicname, const char *category, bool sampled);
+  void end();
+
+  TraceBuffer *buffer;
+  const char *name;
+  const char *category;
+  bool recorded;
+};
+
+#endif
@@ -164,6 +164,34 @@ TEST_CASE("Testing certain methods within the environment (also for coverage tes
     REQUIRE_THROWS_AS(interp.returnenv().searchExp("a"), InterpreterSemanticError);
 }
 
+TEST_CASE("Testing the builtin layer shared by every environment", "[Environment]")
+{
+    Environment env;
+    const std::size_t builtins = env.size();
+
+    REQUIRE(builtins == 33);
+    REQUIRE(env.check("begin"));
+    REQUIRE(env.check("points-from-range"));
+    REQUIRE(env.check("profile-report"));
+    REQUIRE(env.searchProc("+") == &add_proc);
+    REQUIRE(env.searchExp("pi").head.value.num_value == atan2(0, -1));
+    REQUIRE(env.searchExp("define").head.type == SymbolType);
+    REQUIRE_THROWS_AS(env.searchProc("pi"), InterpreterSemanticError);
+
+    // user mappings never replace builtins, and clearing only removes them
+    env.insertexp("pi", Expression(3.0));
+    env.insertexp("a", Expression(1.0));
+    REQUIRE(env.searchExp("pi").head.value.num_value == atan2(0, -1));
+    REQUIRE(env.size() == builtins + 1);
+
+    Environment copy = env;
+    env.clearmap();
+    REQUIRE(env.size() == builtins);
+    REQUIRE_FALSE(env.check("a"));
+    REQUIRE(env.check("sin"));
+    REQUIRE(copy.searchExp("a").head.value.num_value == 1);
+}
+
 TEST_CASE("Test Type Inference 2", "[types]")
 {
 
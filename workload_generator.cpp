@@ -0,0 +1,288 @@
+#include "workload_generator.hpp"
+
+// system includes
+#include <random>
+#include <vector>
+
+// bytes buffered before being written to the output stream
+#define WORKLOAD_BUFFER_SIZE 65536
+
+namespace
+{
+
+// Buffers the generated text and counts the bytes written
+class WorkloadWriter
+{
+public:
+  WorkloadWriter(std::ostream &out) : out(out), written(0)
+  {
+    buffer.reserve(WORKLOAD_BUFFER_SIZE);
+  }
+
+  ~WorkloadWriter()
+  {
+    flush();
+  }
+
+  WorkloadWriter &operator<<(const std::string &text)
+  {
+    buffer += text;
+    written += text.size();
+    if (buffer.size() >= WORKLOAD_BUFFER_SIZE)
+    {
+      flush();
+    }
+    return *this;
+  }
+
+  WorkloadWriter &operator<<(char c)
+  {
+    return *this << std::string(1, c);
+  }
+
+  void flush()
+  {
+    out.write(buffer.data(), buffer.size());
+    buffer.clear();
+  }
+
+  std::uint64_t bytes() const
+  {
+    return written;
+  }
+
+private:
+  std::ostream &out;
+  std::string buffer;
+  std::uint64_t written;
+};
+
+class Generator
+{
+public:
+  Generator(std::ostream &out, const WorkloadOptions &options)
+      : out(out), options(options), random(options.seed)
+  {
+  }
+
+  std::uint64_t generate()
+  {
+    switch (options.kind)
+    {
+    case NestingWorkload:
+      nesting();
+      break;
+    case WideBeginWorkload:
+      widebegin();
+      break;
+    case DefinesWorkload:
+      defines();
+      break;
+    case WideAddWorkload:
+      wideadd();
+      break;
+    case SceneWorkload:
+      scene();
+      break;
+    }
+    out << '\n';
+    out.flush();
+    return out.bytes();
+  }
+
+private:
+  // true while elements remain to be generated, given count of them were
+  bool more(std::uint64_t count)
+  {
+    if (options.bytes != 0)
+    {
+      return out.bytes() < options.bytes;
+    }
+    return count < options.size;
+  }
+
+  int integer(int low, int high)
+  {
+    return std::uniform_int_distribution<int>(low, high)(random);
+  }
+
+  std::string number()
+  {
+    return std::to_string(integer(-100, 100));
+  }
+
+  // a random numeric expression at most depth levels deep
+  std::string expression(unsigned depth)
+  {
+    if (depth == 0 || integer(0, 3) == 0)
+    {
+      return number();
+    }
+
+    switch (integer(0, 6))
+    {
+    case 0:
+      return "(+ " + expression(depth - 1) + " " + expression(depth - 1) + " " + expression(depth - 1) + ")";
+    case 1:
+      return "(* " + expression(depth - 1) + " " + expression(depth - 1) + ")";
+    case 2:
+      return "(- " + expression(depth - 1) + " " + expression(depth - 1) + ")";
+    case 3:
+      return "(- " + expression(depth - 1) + ")";
+    case 4:
+      return "(/ " + expression(depth - 1) + " " + expression(depth - 1) + ")";
+    case 5:
+      return "(" + std::string(integer(0, 1) ? "sin " : "cos ") + expression(depth - 1) + ")";
+    default:
+      return "(if (< " + expression(depth - 1) + " " + expression(depth - 1) + ") " + expression(depth - 1) + " " +
+             expression(depth - 1) + ")";
+    }
+  }
+
+  void nesting()
+  {
+    // the closing part of every open level, one byte each
+    std::vector<char> closers;
+
+    for (std::uint64_t i = 0; more(i); i++)
+    {
+      switch (integer(0, 3))
+      {
+      case 0:
+        out << "(+ " << number() << ' ';
+        closers.push_back(')');
+        break;
+      case 1:
+        out << "(- " << number() << ' ';
+        closers.push_back(')');
+        break;
+      case 2:
+        out << "(* 1 ";
+        closers.push_back(')');
+        break;
+      default:
+        out << "(if (< " << number() << ' ' << number() << ") ";
+        closers.push_back('i');
+        break;
+      }
+    }
+
+    out << number();
+    while (!closers.empty())
+    {
+      out << (closers.back() == 'i' ? " 0)" : ")");
+      closers.pop_back();
+    }
+  }
+
+  void widebegin()
+  {
+    out << "(begin";
+    for (std::uint64_t i = 0; more(i); i++)
+    {
+      out << "\n  " << expression(options.depth);
+    }
+    out << "\n  0)";
+  }
+
+  void defines()
+  {
+    out << "(begin";
+    std::uint64_t i = 0;
+    for (; more(i); i++)
+    {
+      std::string value = expression(options.depth);
+      if (i > 0) // refer to up to two earlier symbols
+      {
+        value = "(+ " + value + " v" + std::to_string(random() % i) + " v" + std::to_string(random() % i) + ")";
+      }
+      out << "\n  (define v" << std::to_string(i) << ' ' << value << ')';
+    }
+    out << "\n  " << (i > 0 ? "v" + std::to_string(i - 1) : std::string("0")) << ')';
+  }
+
+  void wideadd()
+  {
+    out << "(+ 0";
+    for (std::uint64_t i = 0; more(i); i++)
+    {
+      out << ' ' << number();
+    }
+    out << ')';
+  }
+
+  // a point of the car translated by the car's offset
+  std::string point(int x, int y, int dx, int dy)
+  {
+    return "(point " + std::to_string(x + dx) + " " + std::to_string(y + dy) + ")";
+  }
+
+  void scene()
+  {
+    out << "(begin";
+    for (std::uint64_t i = 0; more(i); i++)
+    {
+      int dx = integer(-100, 100) * 200;
+      int dy = integer(-100, 100) * 100;
+      std::string n = std::to_string(i);
+
+      out << "\n (define front_wheel" << n << " (arc " << point(-50, 10, dx, dy) << ' ' << point(-50, 0, dx, dy)
+          << " (* 2 pi)))";
+      out << "\n (define back_wheel" << n << " (arc " << point(50, 10, dx, dy) << ' ' << point(50, 0, dx, dy)
+          << " (* 2 pi)))";
+      out << "\n (draw front_wheel" << n << " back_wheel" << n << ")";
+      out << "\n (draw (line " << point(-36, 10, dx, dy) << ' ' << point(36, 10, dx, dy) << "))";
+      out << "\n (draw (arc " << point(-50, 10, dx, dy) << ' ' << point(-36, 10, dx, dy) << " pi))";
+      out << "\n (draw (arc " << point(50, 10, dx, dy) << ' ' << point(36, 10, dx, dy) << " (- pi)))";
+      out << "\n (draw (line " << point(64, 10, dx, dy) << ' ' << point(80, 10, dx, dy) << "))";
+      out << "\n (draw (line " << point(-64, 10, dx, dy) << ' ' << point(-80, 10, dx, dy) << "))";
+      out << "\n (draw (arc " << point(30, 10, dx, dy) << ' ' << point(80, 10, dx, dy) << " (/ pi 2))";
+      out << "\n  (line " << point(30, -40, dx, dy) << ' ' << point(-20, -40, dx, dy) << ")";
+      out << "\n  (line " << point(-20, -40, dx, dy) << ' ' << point(-40, -20, dx, dy) << ")";
+      out << "\n  (line " << point(-80, -15, dx, dy) << ' ' << point(-40, -20, dx, dy) << ")";
+      out << "\n  (arc " << point(-80, -3, dx, dy) << ' ' << point(-80, -15, dx, dy) << " pi))";
+    }
+    out << "\n 0)";
+  }
+
+  WorkloadWriter out;
+  WorkloadOptions options;
+  std::mt19937 random;
+};
+
+} // namespace
+
+std::uint64_t generateworkload(std::ostream &out, const WorkloadOptions &options)
+{
+  Generator generator(out, options);
+  return generator.generate();
+}
+
+bool parseworkloadkind(const std::string &name, WorkloadKind &kind)
+{
+  if (name == "nesting")
+  {
+    kind = NestingWorkload;
+  }
+  else if (name == "begin")
+  {
+    kind = WideBeginWorkload;
+  }
+  else if (name == "defines")
+  {
+    kind = DefinesWorkload;
+  }
+  else if (name == "add")
+  {
+    kind = WideAddWorkload;
+  }
+  else if (name == "scene")
+  {
+    kind = SceneWorkload;
+  }
+  else
+  {
+    return false;
+  }
+  return true;
+}
@@ -0,0 +1,46 @@
+#ifndef WORKLOAD_GENERATOR_HPP
+#define WORKLOAD_GENERATOR_HPP
+
+// system includes
+#include <cstdint>
+#include <ostream>
+#include <string>
+
+// The shapes of synthetic programs, each stressing one part of the interpreter
+enum WorkloadKind
+{
+  NestingWorkload,   // one expression nested size levels deep
+  WideBeginWorkload, // a begin of size random expressions
+  DefinesWorkload,   // size defines, each using earlier symbols
+  WideAddWorkload,   // a single + with size operands
+  SceneWorkload      // size cars like tests/test_car.slp, scattered over the plane
+};
+
+struct WorkloadOptions
+{
+  WorkloadKind kind = WideBeginWorkload;
+
+  // the same seed and knobs always generate the same program
+  std::uint32_t seed = 1;
+
+  // number of elements (levels, expressions, defines, operands or cars)
+  std::uint64_t size = 1000;
+
+  // when not 0, elements are added until the program is at least this many bytes long,
+  // size is then ignored
+  std::uint64_t bytes = 0;
+
+  // depth of the random expressions used as elements
+  unsigned depth = 3;
+};
+
+// Writes a slisp program to out as it is generated, so programs of any length
+// can be produced in constant memory (nesting keeps one byte per level).
+// Every generated program is a single expression that evaluates without error.
+// Returns the number of bytes written.
+std::uint64_t generateworkload(std::ostream &out, const WorkloadOptions &options);
+
+// reads a kind from its name: nesting, begin, defines, add or scene
+bool parseworkloadkind(const std::string &name, WorkloadKind &kind);
+
+#endif